@@ -4,25 +4,35 @@
 
 #include "appcontroller.h"
 #include "crypto/crypto.h"
+#include "diagnostics/pipelinetrace.h"
 #include "client/session/actions.h"
+#include "client/session/sessiondrain.h"
+#include "client/session/sessionmanager.h"
 
 #include <QClipboard>
+#include <QCoreApplication>
 #include <QGuiApplication>
 #include <QFileInfo>
 #include <QDir>
 #include <QStandardPaths>
-#include <QRandomGenerator>
 #include <QUrlQuery>
 #include <QDateTime>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
 #include <QImage>
 #include <QBuffer>
+#include <QPointer>
 #include <qrencode.h>
 
+#include <utility>
+
 AppController::AppController(QObject *parent)
     : QObject(parent)
-    , m_settings("askhatovich", "putinqa")
     , m_serverWorkload(new ServerWorkload(this))
+    , m_identityCache(m_settings)
+    , m_journal(m_settings)
+    , m_serverSelector(new ServerSelector(this))
     , m_freezeTimer(new QTimer(this))
     , m_expirationTimer(new QTimer(this))
 {
@@ -46,25 +56,31 @@ AppController::AppController(QObject *parent)
 
     m_freezeTimer->setInterval(1000);
     QObject::connect(m_freezeTimer, &QTimer::timeout, this, [this]() {
-        if (m_freezeRemaining > 0) {
-            m_freezeRemaining--;
-            emit freezeRemainingChanged();
-        }
-        if (m_freezeRemaining <= 0) m_freezeTimer->stop();
+        emit freezeRemainingChanged();
+        if (freezeRemaining() <= 0) m_freezeTimer->stop();
     });
 
     m_expirationTimer->setInterval(1000);
     QObject::connect(m_expirationTimer, &QTimer::timeout, this, [this]() {
-        if (m_sessionExpirationIn > 0) {
-            m_sessionExpirationIn--;
-            emit sessionExpirationInChanged();
-        }
+        emit sessionExpirationInChanged();
+        publishTransferStats();
     });
+
+    QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                     this, &AppController::writeDiagnostics);
+
+    // Once the caller had a chance to start something itself (--send). A
+    // transfer cut short by a crash goes first and takes the place of the
+    // pre-authorization.
+    QTimer::singleShot(0, this, &AppController::resumeFromJournal);
+    QTimer::singleShot(0, this, &AppController::preAuthorize);
 }
 
 void AppController::loadSettings()
 {
     m_serverUrl = m_settings.value("server/url", "https://pip.dotcpp.ru").toString();
+    m_serverPool = m_settings.value("server/pool").toStringList();
+    updateServerList();
     m_userName = m_settings.value("user/name", "").toString();
 
     m_language = m_settings.value("app/language", "").toString();
@@ -111,6 +127,17 @@ void AppController::loadSettings()
     m_proxyPort = static_cast<quint16>(m_settings.value("proxy/port", 0).toUInt());
 
     m_autoDropFreeze = m_settings.value("session/auto_drop_freeze", false).toBool();
+    m_compression = m_settings.value("transfer/compression", false).toBool();
+    m_compressionLevel = m_settings.value("transfer/compression_level", ChunkCodec::DEFAULT_LEVEL).toInt();
+    m_preferAes = m_settings.value("crypto/prefer_aes", false).toBool();
+    m_counterNonces = m_settings.value("crypto/counter_nonces", false).toBool();
+    m_rememberIdentity = m_settings.value("identity/remember", true).toBool();
+    m_lastMaxChunkSize = m_settings.value("transfer/last_max_chunk_size", DEFAULT_MAX_CHUNK_SIZE).toLongLong();
+    m_preAuthorize = m_settings.value("network/pre_authorize", false).toBool();
+    m_journalEnabled = m_settings.value("transfer/journal", true).toBool();
+    setTraceFile(m_settings.value("diagnostics/trace_file", "").toString());
+    m_statsFile = m_settings.value("diagnostics/stats_file", "").toString();
+    m_eventsFile = m_settings.value("diagnostics/events_file", "").toString();
     applyProxy();
 
     emit userNameChanged();
@@ -135,6 +162,69 @@ void AppController::applyProxy()
     QNetworkProxy::setApplicationProxy(proxy);
 }
 
+void AppController::setTraceFile(const QString &path)
+{
+    m_traceFile = path;
+    PipelineTrace::setEnabled(!m_traceFile.isEmpty());
+}
+
+void AppController::setStatsFile(const QString &path)
+{
+    m_statsFile = path;
+}
+
+void AppController::setEventsFile(const QString &path)
+{
+    m_eventsFile = path;
+}
+
+Session *AppController::startOfflineSession(bool isSender)
+{
+    resetSessionState();
+    m_isSender = isSender;
+    emit isSenderChanged();
+
+    if (m_session) m_session->deleteLater();
+    m_session = new Session(QUrl(m_serverUrl), QSharedPointer<QNetworkCookieJar>::create(), this);
+    m_session->setOffline(true);
+    connectSessionSignals();
+    setScreen(isSender ? "sender" : "receiver");
+    return m_session;
+}
+
+void AppController::writeDiagnostics()
+{
+    if (!m_traceFile.isEmpty() && PipelineTrace::writeChromeJson(m_traceFile)) {
+        qInfo() << "Pipeline trace written to" << m_traceFile;
+    }
+
+    // Stats live in the session; once it completes the file written then
+    // is kept and the aboutToQuit call leaves it alone.
+    if (m_statsFile.isEmpty() || !m_session) return;
+    QFile file(m_statsFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot write transfer stats to" << m_statsFile;
+        return;
+    }
+    file.write(transferStatsJson().toUtf8());
+    qInfo() << "Transfer stats written to" << m_statsFile;
+}
+
+void AppController::publishTransferStats()
+{
+    if (!m_session) return;
+    m_stats["transfer"] = m_session->stats().toVariantMap();
+    emit statsChanged();
+}
+
+QString AppController::transferStatsJson() const
+{
+    if (!m_session) return {};
+    QJsonObject root = m_session->stats().toJson();
+    root["role"] = m_isSender ? QStringLiteral("sender") : QStringLiteral("receiver");
+    return QString::fromUtf8(QJsonDocument(root).toJson(QJsonDocument::Indented));
+}
+
 void AppController::setScreen(const QString &screen)
 {
     if (m_screen == screen) return;
@@ -142,6 +232,38 @@ void AppController::setScreen(const QString &screen)
     m_screen = screen;
     emit screenChanged();
     if (inSession() != wasInSession) emit inSessionChanged();
+    updateCountdowns();
+}
+
+void AppController::updateCountdowns()
+{
+    // Both only repaint the session screens
+    const bool shown = !m_background && inSession();
+    if (shown && m_frozen && freezeRemaining() > 0) {
+        if (!m_freezeTimer->isActive()) m_freezeTimer->start();
+    } else {
+        m_freezeTimer->stop();
+    }
+    if (shown && sessionExpirationIn() > 0) {
+        if (!m_expirationTimer->isActive()) m_expirationTimer->start();
+    } else {
+        m_expirationTimer->stop();
+    }
+}
+
+void AppController::setBackground(bool background)
+{
+    if (m_background == background) return;
+    m_background = background;
+    m_serverWorkload->setBackground(background);
+    m_serverSelector->setPaused(background);
+    updateCountdowns();
+    if (!background) {
+        // Catch up on what the stopped timers did not repaint
+        emit freezeRemainingChanged();
+        emit sessionExpirationInChanged();
+        publishTransferStats();
+    }
 }
 
 void AppController::setError(const QString &msg)
@@ -157,6 +279,8 @@ void AppController::startSend()
     m_isSender = true;
     m_pendingRole = "sender";
     emit isSenderChanged();
+    // Connects while the file dialog is open
+    SessionManager::instance().warmUp(QUrl(m_serverUrl));
 }
 
 void AppController::selectFile(const QUrl &fileUrl)
@@ -165,22 +289,186 @@ void AppController::selectFile(const QUrl &fileUrl)
     QFileInfo fi(m_filePath);
     if (!fi.exists() || !fi.isFile()) {
         setError("File not found: " + m_filePath);
+        emit sendDropped(m_filePath, "File not found");
         return;
     }
 
+    m_archiveEntries.clear();
     m_fileName = fi.fileName();
     m_fileSize = fi.size();
     emit fileNameChanged();
     emit fileSizeChanged();
+    beginSending();
+}
+
+void AppController::selectFiles(const QList<QUrl> &fileUrls)
+{
+    if (fileUrls.size() == 1) {
+        selectFile(fileUrls.first());
+        return;
+    }
+
+    QStringList paths;
+    for (const QUrl &url : fileUrls) paths << url.toLocalFile();
+    if (paths.isEmpty()) return;
+
+    // Named after the folder they were picked from
+    const QString parent = QFileInfo(paths.first()).absoluteDir().dirName();
+    selectArchive(paths, parent.isEmpty() ? QStringLiteral("files") : parent);
+}
+
+void AppController::selectFolder(const QUrl &folderUrl)
+{
+    const QString path = folderUrl.toLocalFile();
+    const QString name = QDir(path).dirName();
+    selectArchive({path}, name.isEmpty() ? QStringLiteral("folder") : name);
+}
 
-    m_activeServer = m_serverUrl;
+void AppController::selectArchive(const QStringList &roots, const QString &name)
+{
+    for (const QString &root : roots) {
+        if (!QFileInfo::exists(root)) {
+            setError("File not found: " + root);
+            return;
+        }
+    }
+
+    // Walked once here; TarSource streams exactly these entries, so the size
+    // announced in set_file_info holds even if the folder changes meanwhile
+    m_filePath.clear();
+    m_archiveEntries = TarSource::collect(roots);
+    m_fileName = name + ".tar";
+    m_fileSize = TarSource::archiveSize(m_archiveEntries);
+    emit fileNameChanged();
+    emit fileSizeChanged();
+    beginSending();
+}
+
+void AppController::beginSending()
+{
+    // The least loaded, closest of the configured servers
+    m_triedServers.clear();
+    const QUrl server = m_serverSelector->best();
+    m_activeServer = server.isEmpty() ? m_serverUrl : server.toString();
     emit activeServerChanged();
     m_serverWorkload->onServerHostUpdated(QUrl(m_activeServer));
 
     setScreen("connecting");
+    m_crypto = senderCrypto(m_archiveEntries.isEmpty());
+    startSpeculativeSeal();
+    // Back-to-back sends keep the identity: the server released it when
+    // the previous session completed
+    if (m_auth && !m_preAuthorizing && m_auth->isAuthorized() && m_auth->getUrl() == QUrl(m_activeServer)) {
+        proceedAfterAuth();
+        return;
+    }
     authorize();
 }
 
+ChunkCrypto AppController::senderCrypto(bool journaled) const
+{
+    ChunkCrypto crypto;
+    crypto.key = Crypto::generateKey();
+    // AES-GCM only where this CPU accelerates it; receivers need it too
+    crypto.cipher = m_preferAes && Crypto::isAvailable(Crypto::Cipher::Aes256Gcm)
+        ? Crypto::Cipher::Aes256Gcm : Crypto::Cipher::XChaCha20Poly1305;
+    crypto.nonceMode = m_counterNonces ? Crypto::NonceMode::Counter : Crypto::NonceMode::Random;
+    crypto.codec.setMethod(m_compression ? ChunkCodec::Method::Zstd : ChunkCodec::Method::None,
+                           m_compressionLevel);
+    crypto.digest = m_journalEnabled && journaled;
+    return crypto;
+}
+
+void AppController::startSpeculativeSeal()
+{
+    if (m_upload) return;
+
+    // Read and seal the first window while auth, create, the WS connect and
+    // start_init are under way. The server's chunk size is not known yet:
+    // the last one seen is assumed, and ChunkUpload::start() starts over if
+    // it differs.
+    QIODevice *file = openUploadFile();
+    if (!file) return;  // onSessionInitialized() reports it
+    m_upload = new ChunkUpload(file, m_crypto);
+    connectUploadSignals();
+    m_upload->preseal(m_lastMaxChunkSize - m_crypto.overhead());
+}
+
+QIODevice *AppController::openUploadFile()
+{
+    QIODevice *file = nullptr;
+    if (m_archiveEntries.isEmpty()) {
+        file = new QFile(m_filePath, this);
+    } else {
+        file = new TarSource(m_archiveEntries, this);
+    }
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+
+void AppController::connectUploadSignals()
+{
+    QObject::connect(m_upload, &ChunkUpload::sending, this, &AppController::journalChunkSent);
+    QObject::connect(m_upload, &ChunkUpload::finished, this, [this]() {
+        m_uploadFinished = true;
+        emit uploadFinishedChanged();
+        // The link is free from here on; set up the next queued send
+        prepareNextSend();
+    });
+    // Paced by a slow receiver: the next queued send need not wait for it
+    QObject::connect(m_upload, &ChunkUpload::stalled, this, [this]() {
+        prepareNextSend();
+        handOffSend();
+    });
+    QObject::connect(m_upload, &ChunkUpload::failed, this, [this](const QString &reason) {
+        setError(reason);
+        terminateSession();
+    });
+    if (m_session) m_upload->setSession(m_session);
+}
+
+void AppController::dropUpload()
+{
+    if (!m_upload) return;
+    QObject::disconnect(m_upload, nullptr, this, nullptr);
+    m_upload->cancel();
+    m_upload->deleteLater();
+    m_upload = nullptr;
+}
+
+void AppController::enqueueFiles(const QList<QUrl> &fileUrls)
+{
+    QStringList paths;
+    for (const QUrl &url : fileUrls) {
+        const QString path = url.toLocalFile();
+        if (!QFileInfo(path).isFile()) {
+            setError("File not found: " + path);
+            emit sendDropped(path, "File not found");
+            continue;
+        }
+        paths << path;
+    }
+    if (paths.isEmpty()) return;
+
+    // Idle: the first one starts at once, from a clean state
+    const bool idle = m_screen == "entry" || m_screen == "complete";
+    if (idle) restart();
+    for (const QString &path : std::as_const(paths)) m_sendQueue.enqueue(path);
+    emit sendQueueChanged();
+
+    if (idle) {
+        const QString first = m_sendQueue.dequeue();
+        emit sendQueueChanged();
+        startSend();
+        selectFile(QUrl::fromLocalFile(first));
+        return;
+    }
+    prepareNextSend();
+}
+
 void AppController::startReceive(const QString &link)
 {
     m_isSender = false;
@@ -194,19 +482,50 @@ void AppController::startReceive(const QString &link)
     m_pendingSessionId = query.queryItemValue("id");
     QString keyStr = query.queryItemValue("key");
     QString encryption = query.queryItemValue("encryption");
+    QString compression = query.queryItemValue("compression");
+    QString nonce = query.queryItemValue("nonce");
+    QString archive = query.queryItemValue("archive");
 
     if (m_pendingSessionId.isEmpty() || keyStr.isEmpty()) {
         setError("Invalid link: missing session ID or key");
         return;
     }
 
-    if (encryption != "xchacha20-poly1305") {
+    bool knownCipher = false;
+    m_crypto.cipher = Crypto::cipherFromName(encryption, &knownCipher);
+    if (!knownCipher) {
         setError("Unsupported encryption: " + encryption);
         return;
     }
+    if (!Crypto::isAvailable(m_crypto.cipher)) {
+        setError("This CPU cannot decrypt " + encryption + ", ask the sender to turn off AES");
+        return;
+    }
+
+    bool knownNonce = false;
+    m_crypto.nonceMode = Crypto::nonceModeFromName(nonce, &knownNonce);
+    if (!knownNonce) {
+        setError("Unsupported nonce mode: " + nonce);
+        return;
+    }
+
+    bool knownCompression = false;
+    const ChunkCodec::Method method = ChunkCodec::methodFromName(compression, &knownCompression);
+    if (!knownCompression || !ChunkCodec::isAvailable(method)) {
+        setError("Unsupported compression: " + compression);
+        return;
+    }
+    m_crypto.codec.setMethod(method);
+
+    if (!archive.isEmpty() && archive != "tar") {
+        setError("Unsupported archive format: " + archive);
+        return;
+    }
+    m_receivingArchive = archive == "tar";
+    emit receivingArchiveChanged();
 
-    m_encryptionKey = Crypto::base64UrlToKey(keyStr);
-    if (m_encryptionKey.isEmpty()) {
+    m_crypto.key = Crypto::base64UrlToKey(keyStr);
+    if (m_crypto.key.isEmpty()) {
         setError("Invalid encryption key");
         return;
     }
@@ -228,18 +547,134 @@ void AppController::startReceive(const QString &link)
 
 void AppController::authorize()
 {
+    if (adoptPreAuthorization()) return;
+
     if (m_auth) m_auth->deleteLater();
-    m_auth = new Authorization(this);
-    m_auth->setUrl(QUrl(m_activeServer));
-    m_auth->setName(m_userName);
+    m_auth = createAuthorization(QUrl(m_activeServer));
+    connectAuthSignals();
+    m_auth->connect();
+}
+
+Authorization *AppController::createAuthorization(const QUrl &server)
+{
+    auto *auth = new Authorization(this);
+    auth->setUrl(server);
+    auth->setName(m_userName);
+
+    // The cached identity carries the name it was made with; a renamed user
+    // gets a fresh one rather than a session under the old name
+    if (m_rememberIdentity) {
+        const IdentityCache::Entry cached = m_identityCache.load(server);
+        if (cached.isValid() && cached.name == m_userName) auth->restore(cached.id, cached.cookies);
+    }
+    return auth;
+}
 
+void AppController::connectAuthSignals()
+{
     QObject::connect(m_auth, &Authorization::authorized, this, &AppController::onAuthorized);
     QObject::connect(m_auth, &Authorization::captchaRequired, this, &AppController::onCaptchaRequired);
     QObject::connect(m_auth, &Authorization::error, this, &AppController::onAuthError);
+    QObject::connect(m_auth, &Authorization::serverFull, this, &AppController::onServerFull);
+}
+
+void AppController::updateServerList()
+{
+    QList<QUrl> servers{QUrl(m_serverUrl)};
+    for (const QString &server : std::as_const(m_serverPool)) servers << QUrl(server.trimmed());
+    m_serverSelector->setServers(servers);
+}
 
+void AppController::onServerFull()
+{
+    if (!failOver()) onAuthError("Server is full, try again later");
+}
+
+bool AppController::failOver()
+{
+    // A receiver's link names its server; only a new send can move
+    if (!m_isSender) return false;
+
+    const QUrl full(m_activeServer);
+    m_serverSelector->markFull(full);
+    m_triedServers << full;
+    const QUrl next = m_serverSelector->best(m_triedServers);
+    if (next.isEmpty()) return false;
+
+    qInfo() << m_activeServer << "is full, trying" << next;
+    if (m_session) {
+        m_session->deleteLater();
+        m_session = nullptr;
+    }
+    // Identities are per server
+    if (m_auth) {
+        m_auth->deleteLater();
+        m_auth = nullptr;
+    }
+    m_activeServer = next.toString();
+    emit activeServerChanged();
+    m_serverWorkload->onServerHostUpdated(next);
+    authorize();
+    return true;
+}
+
+void AppController::preAuthorize()
+{
+    const QUrl server = m_serverSelector->best();
+    if (!m_preAuthorize || m_screen != "entry" || m_auth || server.isEmpty()) return;
+
+    m_auth = createAuthorization(server);
+    m_preAuthorizing = true;
+    // Not cached yet: the server drops it within a minute unless a session
+    // takes it, and a stale entry costs the next start a round trip
+    QObject::connect(m_auth, &Authorization::authorized, this, [this]() {
+        m_preAuthClock.start();
+        m_serverSelector->clearFull(m_auth->getUrl());
+        emit myClientIdChanged();
+    });
+    // Nobody asked for anything yet: no captcha, no error on screen
+    auto drop = [this]() {
+        m_preAuthorizing = false;
+        m_auth->deleteLater();
+        m_auth = nullptr;
+    };
+    QObject::connect(m_auth, &Authorization::captchaRequired, this, drop);
+    QObject::connect(m_auth, &Authorization::error, this, drop);
+    QObject::connect(m_auth, &Authorization::serverFull, this, drop);
     m_auth->connect();
 }
 
+bool AppController::adoptPreAuthorization()
+{
+    if (!m_auth || !m_preAuthorizing) return false;
+    m_preAuthorizing = false;
+    QObject::disconnect(m_auth, nullptr, this, nullptr);
+
+    // The server drops identities that have no WebSocket for a minute
+    const bool fresh = !m_auth->isAuthorized() || m_preAuthClock.elapsed() < PRE_AUTH_MAX_AGE_SECS * 1000;
+    if (m_auth->getUrl() != QUrl(m_activeServer) || !fresh) return false;
+
+    connectAuthSignals();
+    if (m_auth->isAuthorized()) onAuthorized();
+    return true;
+}
+
+void AppController::rememberIdentity()
+{
+    if (!m_rememberIdentity || !m_auth || m_auth->getId().isEmpty()) return;
+
+    IdentityCache::Entry entry;
+    entry.id = m_auth->getId();
+    entry.name = m_userName;
+    entry.cookies = m_auth->getCookies();
+    m_identityCache.store(m_auth->getUrl(), entry);
+}
+
+void AppController::forgetIdentity()
+{
+    if (m_rememberIdentity) m_identityCache.remove(QUrl(m_activeServer));
+}
+
 void AppController::solveCaptcha(const QString &answer)
 {
     if (!m_auth) return;
@@ -265,9 +700,12 @@ void AppController::openSettings()
 
 void AppController::saveSettings(const QString &url, const QString &name, const QString &language,
                                   const QString &proxyType, const QString &proxyHost, quint16 proxyPort,
-                                  bool autoDropFreeze)
+                                  bool autoDropFreeze, bool compression, bool preferAes)
 {
-    m_serverUrl = url;
+    if (m_serverUrl != url) {
+        m_serverUrl = url;
+        updateServerList();
+    }
     bool nameChanged = (m_userName != name);
     m_userName = name;
     m_settings.setValue("server/url", m_serverUrl);
@@ -298,6 +736,7 @@ void AppController::saveSettings(const QString &url, const QString &name, const
         emit userNameChanged();
 
         m_session->sendJsonMessage(Action::NewName(m_userName).json());
+        rememberIdentity();
 
         if (m_isSender) {
             m_senderName = m_userName;
@@ -328,6 +767,18 @@ void AppController::saveSettings(const QString &url, const QString &name, const
         emit autoDropFreezeChanged();
     }
 
+    if (m_compression != compression) {
+        m_compression = compression;
+        m_settings.setValue("transfer/compression", m_compression);
+        emit compressionChanged();
+    }
+
+    if (m_preferAes != preferAes) {
+        m_preferAes = preferAes;
+        m_settings.setValue("crypto/prefer_aes", m_preferAes);
+        emit preferAesChanged();
+    }
+
     m_serverWorkload->onServerHostUpdated(QUrl(m_serverUrl));
     setScreen(m_screenBeforeSettings.isEmpty() ? "entry" : m_screenBeforeSettings);
 }
@@ -350,13 +801,7 @@ void AppController::terminateSession()
 {
     if (m_session) {
         m_terminateRequested = true;
-        m_waitingForChunkAccepted = false;
-        m_canSendChunk = false;
-        if (m_uploadFile) {
-            m_uploadFile->close();
-            delete m_uploadFile;
-            m_uploadFile = nullptr;
-        }
+        if (m_upload) m_upload->cancel();
         m_session->sendJsonMessage(Action::TerminateSession().json());
     }
 }
@@ -368,15 +813,11 @@ void AppController::leaveSession()
 
     QUrl url(m_activeServer);
     url.setPath("/api/me/leave");
+    forgetIdentity();
 
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setTransferTimeout(10000);
-    manager->setCookieJar(m_session->getCookieJar().data());
-    m_session->getCookieJar()->setParent(nullptr);
-
-    auto *reply = manager->post(QNetworkRequest(url), QByteArray());
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager]() {
-        manager->deleteLater();
+    auto *reply = SessionManager::instance().post(QNetworkRequest(url), m_session->getCookieJar(), QByteArray());
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        reply->deleteLater();
         restart();
     });
 }
@@ -394,6 +835,7 @@ void AppController::changeName(const QString &name)
         emit userNameChanged();
 
         m_session->sendJsonMessage(Action::NewName(m_userName).json());
+        rememberIdentity();
 
         if (m_isSender) {
             m_senderName = m_userName;
@@ -429,16 +871,24 @@ void AppController::restart()
         m_auth->deleteLater();
         m_auth = nullptr;
     }
+    m_preAuthorizing = false;
     resetSessionState();
     setScreen("entry");
+    preAuthorize();
 }
 
 void AppController::resetSessionState()
 {
+    // Never got as far as a link: whoever handed the file over stops
+    // waiting for one
+    if (m_isSender && !m_filePath.isEmpty() && m_shareLink.isEmpty()) {
+        emit sendDropped(m_filePath, m_errorMsg.isEmpty() ? QStringLiteral("Cancelled") : m_errorMsg);
+    }
     m_screenBeforeSettings.clear();
-    m_encryptionKey.clear();
+    m_crypto = ChunkCrypto();
     m_shareLink.clear(); emit shareLinkChanged();
     m_filePath.clear();
+    m_archiveEntries.clear();
     m_fileName.clear(); emit fileNameChanged();
     m_fileSize = 0; emit fileSizeChanged();
     m_progress = 0; emit progressChanged();
@@ -447,30 +897,31 @@ void AppController::resetSessionState()
     m_bufferUsed = 0; emit bufferUsedChanged();
     m_bufferMax = 10; emit bufferMaxChanged();
     m_frozen = true; emit frozenChanged();
-    m_freezeRemaining = 0; emit freezeRemainingChanged();
-    m_sessionExpirationIn = 0; emit sessionExpirationInChanged();
+    m_freezeDeadline = QDeadlineTimer(); emit freezeRemainingChanged();
+    m_expirationDeadline = QDeadlineTimer(); emit sessionExpirationInChanged();
     m_senderName.clear(); emit senderNameChanged();
     m_senderOnline = false; emit senderOnlineChanged();
     m_receivers.clear(); emit receiversChanged();
     m_completeStatus.clear(); emit completeStatusChanged();
     m_hasDownloadedFile = false; emit hasDownloadedFileChanged();
+    m_receivingArchive = false; emit receivingArchiveChanged();
     m_captchaImage.clear(); emit captchaImageChanged();
     m_captchaAnswerLength = 0; emit captchaAnswerLengthChanged();
-    m_chunksConfirmed = 0; emit chunksConfirmedChanged();
-    m_highestKnownChunk = 0; emit highestKnownChunkChanged();
-    m_pendingConfirms = 0;
+    dropDownload();
+    m_highestKnownChunk = 0;
+    emit chunksConfirmedChanged();
+    emit highestKnownChunkChanged();
+    m_sessionStarted = false;
+    m_resumeEntry = TransferJournal::Entry();
+    m_sentCheckNext = 0;
+    removeJournal();
+    m_stats.remove("transfer"); emit statsChanged();
     setError("");
 
-    if (m_uploadFile) {
-        m_uploadFile->close();
-        delete m_uploadFile;
-        m_uploadFile = nullptr;
-    }
-    m_waitingForChunkAccepted = false;
-    m_canSendChunk = true;
-    cleanupDownloadTmpFile();
-    m_downloadQueue.clear();
-    m_activeDownloads = 0;
+    dropUpload();
+    discardPreparedSend();
+    m_handingOff = false;
+    clearSendQueue("Cancelled");
     m_receiverChunksDone.clear();
     m_pendingSessionId.clear();
     m_pendingRole.clear();
@@ -536,6 +987,10 @@ QVariantMap AppController::translations() const
     static const QVariantMap en = {
         {"appSlogan", "Streaming file transfer with end-to-end encryption"},
         {"sendFile", "Send file"},
+        {"sendFolder", "or send a folder"},
+        {"queueMore", "Send more files after this one"},
+        {"queued", "queued"},
+        {"queueFilesTitle", "Select files to send next"},
         {"receiveFile", "Receive file"},
         {"pasteLink", "Paste the share link:"},
         {"join", "Join"},
@@ -565,6 +1020,9 @@ QVariantMap AppController::translations() const
         {"sessionExpiresIn", "Session expires in"},
         {"transferComplete", "Transfer complete!"},
         {"sessionTimedOut", "Session timed out"},
+        {"transferTruncated", "Transfer incomplete: the last part of the file never arrived"},
+        {"transferExtractFailed", "The received files could not be unpacked"},
+        {"transferCorrupt", "Transfer failed: a part of the file could not be decrypted"},
         {"senderDisconnected", "Sender disconnected"},
         {"noReceiversJoined", "No receivers joined"},
         {"sessionTerminated", "Session terminated"},
@@ -578,6 +1036,8 @@ QVariantMap AppController::translations() const
         {"connectingToServer", "Connecting to server..."},
         {"selectFileTitle", "Select a file to send"},
         {"saveFileTitle", "Save received file"},
+        {"selectFolderTitle", "Select a folder to send"},
+        {"saveFolderTitle", "Choose where to save the received files"},
         {"chunks", "Chunks"},
         {"secondsShort", "s"},
         {"noConnection", "No connection"},
@@ -587,11 +1047,19 @@ QVariantMap AppController::translations() const
         {"proxyPort", "Port"},
         {"autoDropFreezeLabel", "Auto-start transfer"},
         {"autoDropFreezeHint", "Drops the initial wait on the first chunk a receiver confirms, and treats a lone leave as a success"},
+        {"compressionLabel", "Compress transfers"},
+        {"compressionHint", "zstd before encryption, skipped for data that does not shrink. Receivers need a version with compression support"},
+        {"preferAesLabel", "Use AES-256-GCM"},
+        {"preferAesHint", "Faster than XChaCha20 on this CPU. Receivers need a version with AES support and a CPU with AES instructions"},
         {"kickedStatus", "You were removed from the session"},
     };
     static const QVariantMap ru = {
         {"appSlogan", QString::fromUtf8("Потоковая передача файлов со сквозным шифрованием")},
         {"sendFile", QString::fromUtf8("Отправить файл")},
+        {"sendFolder", QString::fromUtf8("или отправить папку")},
+        {"queueMore", QString::fromUtf8("Отправить ещё файлы следом")},
+        {"queued", QString::fromUtf8("в очереди")},
+        {"queueFilesTitle", QString::fromUtf8("Выберите файлы для отправки следом")},
         {"receiveFile", QString::fromUtf8("Получить файл")},
         {"pasteLink", QString::fromUtf8("Вставьте ссылку:")},
         {"join", QString::fromUtf8("Подключиться")},
@@ -621,6 +1089,9 @@ QVariantMap AppController::translations() const
         {"sessionExpiresIn", QString::fromUtf8("Сессия истекает через")},
         {"transferComplete", QString::fromUtf8("Передача завершена!")},
         {"sessionTimedOut", QString::fromUtf8("Время сессии истекло")},
+        {"transferTruncated", QString::fromUtf8("Передача не завершена: конец файла не получен")},
+        {"transferExtractFailed", QString::fromUtf8("Не удалось распаковать полученные файлы")},
+        {"transferCorrupt", QString::fromUtf8("Передача прервана: часть файла не удалось расшифровать")},
         {"senderDisconnected", QString::fromUtf8("Отправитель отключился")},
         {"noReceiversJoined", QString::fromUtf8("Получатели не подключились")},
         {"sessionTerminated", QString::fromUtf8("Сессия завершена")},
@@ -634,11 +1105,17 @@ QVariantMap AppController::translations() const
         {"connectingToServer", QString::fromUtf8("Подключение к серверу...")},
         {"selectFileTitle", QString::fromUtf8("Выберите файл для отправки")},
         {"saveFileTitle", QString::fromUtf8("Сохранить полученный файл")},
+        {"selectFolderTitle", QString::fromUtf8("Выберите папку для отправки")},
+        {"saveFolderTitle", QString::fromUtf8("Куда сохранить полученные файлы")},
         {"chunks", QString::fromUtf8("Чанки")},
         {"secondsShort", QString::fromUtf8("с")},
         {"noConnection", QString::fromUtf8("Нет соединения")},
         {"autoDropFreezeLabel", QString::fromUtf8("Автостарт передачи")},
         {"autoDropFreezeHint", QString::fromUtf8("Снимает стартовое ожидание на первом принятом чанке, уход одинокого получателя считается успехом")},
+        {"compressionLabel", QString::fromUtf8("Сжимать передачу")},
+        {"compressionHint", QString::fromUtf8("zstd перед шифрованием, несжимаемые данные передаются как есть. Получателю нужна версия с поддержкой сжатия")},
+        {"preferAesLabel", QString::fromUtf8("Шифровать AES-256-GCM")},
+        {"preferAesHint", QString::fromUtf8("Быстрее XChaCha20 на этом процессоре. Получателю нужна версия с поддержкой AES и процессор с AES-инструкциями")},
         {"kickedStatus", QString::fromUtf8("Вы были удалены из сессии")},
         {"proxyLabel", QString::fromUtf8("Прокси")},
         {"proxyNone", QString::fromUtf8("Выкл")},
@@ -648,96 +1125,62 @@ QVariantMap AppController::translations() const
     return m_language == "ru" ? ru : en;
 }
 
-void AppController::openDownloadTmpFile()
+void AppController::openDownload()
 {
     QString tmpDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    m_downloadTmpPath = QDir(tmpDir).filePath(
-        QStringLiteral("putinqa_%1.tmp").arg(QRandomGenerator::global()->generate64(), 0, 16));
-    m_downloadTmpFile = new QFile(m_downloadTmpPath, this);
-    if (!m_downloadTmpFile->open(QIODevice::WriteOnly)) {
-        qWarning() << "Cannot create tmp file:" << m_downloadTmpPath;
-        setError("Cannot create temporary file");
+    // A journaled file has to outlive a reboot, and the temp folder may not
+    if (m_journalEnabled && !m_receivingArchive) {
+        tmpDir = QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath("partial");
+        QDir().mkpath(tmpDir);
     }
+    m_download = new ChunkDownload(m_crypto);
+    connectDownloadSignals();
+    QString error;
+    if (!m_download->create(tmpDir, m_receivingArchive, &error)) setError(error);
 }
 
-void AppController::flushChunksToDisk(qint64 index, const QByteArray &data)
+void AppController::connectDownloadSignals()
 {
-    if (!m_downloadTmpFile || !m_downloadTmpFile->isOpen()) return;
-
-    // If this chunk is the next sequential one, write it and drain buffer
-    if (index == m_nextWriteIndex) {
-        m_downloadTmpFile->write(data);
-        m_nextWriteIndex++;
-
-        // Flush any buffered chunks that are now sequential
-        while (m_chunkBuffer.contains(m_nextWriteIndex)) {
-            m_downloadTmpFile->write(m_chunkBuffer.take(m_nextWriteIndex));
-            m_nextWriteIndex++;
-        }
-    } else {
-        // Out of order — buffer in memory
-        m_chunkBuffer.insert(index, data);
-    }
+    QObject::connect(m_download, &ChunkDownload::chunksConfirmedChanged,
+                     this, &AppController::chunksConfirmedChanged);
+    QObject::connect(m_download, &ChunkDownload::highestKnownChunkChanged,
+                     this, &AppController::highestKnownChunkChanged);
+    QObject::connect(m_download, &ChunkDownload::error, this, &AppController::setError);
+    QObject::connect(m_download, &ChunkDownload::finished, this, &AppController::onSessionComplete);
+    if (m_session) m_download->setSession(m_session, myClientId());
 }
 
-void AppController::cleanupDownloadTmpFile()
+void AppController::dropDownload()
 {
-    if (m_downloadTmpFile) {
-        m_downloadTmpFile->close();
-        QFile::remove(m_downloadTmpPath);
-        delete m_downloadTmpFile;
-        m_downloadTmpFile = nullptr;
-    }
-    m_downloadTmpPath.clear();
-    m_chunkBuffer.clear();
-    m_writtenChunks.clear();
-    m_nextWriteIndex = 1;
+    if (!m_download) return;
+    QObject::disconnect(m_download, nullptr, this, nullptr);
+    m_download->discard();
+    m_download->deleteLater();
+    m_download = nullptr;
 }
 
 QUrl AppController::suggestedSavePath() const
 {
     QString dir = QStandardPaths::writableLocation(QStandardPaths::DownloadLocation);
     if (dir.isEmpty()) dir = QDir::homePath();
+    // Archives are saved into a folder, see saveReceivedFile
+    if (m_receivingArchive) return QUrl::fromLocalFile(dir);
     return QUrl::fromLocalFile(QDir(dir).filePath(m_fileName.isEmpty() ? "download" : m_fileName));
 }
 
 void AppController::saveReceivedFile(const QUrl &path)
 {
-    QString filePath = path.toLocalFile();
-
-    if (m_downloadTmpFile) {
-        m_downloadTmpFile->close();
-    }
-
-    // Try rename (instant if same filesystem), fall back to copy
-    if (QFile::rename(m_downloadTmpPath, filePath)) {
-        qInfo() << "File moved to" << filePath;
-    } else {
-        // Cross-filesystem: copy + remove
-        if (QFile::copy(m_downloadTmpPath, filePath)) {
-            QFile::remove(m_downloadTmpPath);
-            qInfo() << "File copied to" << filePath;
-        } else {
-            setError("Cannot save to: " + filePath);
-            // Reopen tmp file in case user retries with different path
-            if (m_downloadTmpFile)
-                m_downloadTmpFile->open(QIODevice::Append);
-            return;
-        }
-    }
-
-    // Tmp file moved/copied — clear reference without deleting
-    if (m_downloadTmpFile) {
-        delete m_downloadTmpFile;
-        m_downloadTmpFile = nullptr;
-    }
-    m_downloadTmpPath.clear();
+    if (!m_download) return;
+    QString error;
+    if (!m_download->saveTo(path.toLocalFile(), &error)) setError(error);
 }
 
 // --- Auth callbacks ---
 
 void AppController::onAuthorized()
 {
+    // It had room for an identity after all
+    m_serverSelector->clearFull(m_auth->getUrl());
     emit myClientIdChanged();
     proceedAfterAuth();
 }
@@ -753,6 +1196,7 @@ void AppController::onCaptchaRequired(const QString &imageBase64, int answerLeng
 
 void AppController::onAuthError(const QString &reason)
 {
+    if (m_isSender && !m_filePath.isEmpty()) emit sendDropped(m_filePath, reason);
     setError(reason);
     setScreen("entry");
 }
@@ -770,9 +1214,10 @@ void AppController::startSenderSession()
 {
     if (m_session) m_session->deleteLater();
     m_session = new Session(m_auth->getUrl(), m_auth->getCookieJar(), this);
+    m_session->setEventRecording(m_eventsFile);
     connectSessionSignals();
 
-    m_encryptionKey = Crypto::generateKey();
+    // Key, cipher and codec were chosen in beginSending()
     m_session->create(m_autoDropFreeze);
 }
 
@@ -780,6 +1225,7 @@ void AppController::startReceiverSession()
 {
     if (m_session) m_session->deleteLater();
     m_session = new Session(m_auth->getUrl(), m_auth->getCookieJar(), this);
+    m_session->setEventRecording(m_eventsFile);
     connectSessionSignals();
 
     m_session->join(m_pendingSessionId);
@@ -787,16 +1233,16 @@ void AppController::startReceiverSession()
 
 void AppController::connectSessionSignals()
 {
+    // Only an identity in a session is kept alive by the server, so only
+    // that one is worth caching
+    QObject::connect(m_session, &Session::joined, this, &AppController::rememberIdentity);
     QObject::connect(m_session, &Session::complete, this, &AppController::onSessionComplete);
     QObject::connect(m_session, &Session::webSocketConnection, this, &AppController::onWsConnection);
-    QObject::connect(m_session, &Session::chunkDataReceived, this, &AppController::onChunkDataReceived);
-    QObject::connect(m_session, &Session::chunkDownloadFailed, this, &AppController::onChunkDownloadFailed);
 
     auto *state = m_session->state();
     QObject::connect(state, &SessionState::sessionInitialized, this, &AppController::onSessionInitialized);
     QObject::connect(state, &SessionState::newChunkEvent, this, &AppController::onNewChunkEvent);
     QObject::connect(state, &SessionState::chunkRemovedEvent, this, &AppController::onChunkRemovedEvent);
-    QObject::connect(state, &SessionState::newChunkAllowedEvent, this, &AppController::onNewChunkAllowed);
     QObject::connect(state, &SessionState::freezeDroppedEvent, this, &AppController::onFreezeDropped);
     QObject::connect(state, &SessionState::uploadFinishedEvent, this, &AppController::onUploadFinishedEvent);
     QObject::connect(state, &SessionState::fileInfoEvent, this, &AppController::onFileInfoEvent);
@@ -807,6 +1253,10 @@ void AppController::connectSessionSignals()
     QObject::connect(state, &SessionState::onlineEvent, this, &AppController::onOnlineEvent);
     QObject::connect(state, &SessionState::nameChangedEvent, this, &AppController::onNameChangedEvent);
     QObject::connect(state, &SessionState::chunkDownloadFinishedEvent, this, &AppController::onChunkDownloadFinished);
+
+    // The chunks themselves are the transfer's
+    if (m_upload) m_upload->setSession(m_session);
+    if (m_download) m_download->setSession(m_session, myClientId());
 }
 
 // --- Session callbacks ---
@@ -814,41 +1264,81 @@ void AppController::connectSessionSignals()
 void AppController::onSessionComplete(const QString &status)
 {
     if (m_screen == "complete") return; // already handled
+    // No room for another session there; nothing was sent yet
+    if (status == "error_503" && m_screen == "connecting" && failOver()) return;
 
+    // The server may call it done, but the sender's last chunk never came
+    // or the archive did not unpack to its end
     m_completeStatus = status;
+    if (!m_isSender && status == "ok" && m_download) {
+        if (m_download->missingLastChunk()) {
+            m_completeStatus = QStringLiteral("truncated");
+        } else if (m_download->archiveIncomplete()) {
+            m_completeStatus = QStringLiteral("extract_failed");
+        }
+    }
     emit completeStatusChanged();
+    if (m_isSender && !m_filePath.isEmpty() && m_shareLink.isEmpty()) {
+        emit sendDropped(m_filePath, "Session ended with " + m_completeStatus);
+    }
+    m_resumeEntry = TransferJournal::Entry();
+    removeJournal();
 
-    if (!m_isSender && status == "ok" && !m_writtenChunks.isEmpty()) {
+    if (!m_isSender && m_completeStatus == "ok" && m_download && m_download->hasData()) {
         m_hasDownloadedFile = true;
         emit hasDownloadedFileChanged();
     }
 
     m_expirationTimer->stop();
     m_freezeTimer->stop();
+    publishTransferStats();
+    writeDiagnostics();
 
     // Receiver: delay leave so sender sees the checkmark for a few seconds
     if (!m_isSender && m_session) {
         auto cookieJar = m_session->getCookieJar();
         QString serverUrl = m_activeServer;
-        int delayMs = (status == "ok") ? 5000 : 0;
+        int delayMs = (m_completeStatus == "ok") ? 5000 : 0;
+        forgetIdentity();
         QTimer::singleShot(delayMs, this, [cookieJar, serverUrl]() {
             QUrl url(serverUrl);
             url.setPath("/api/me/leave");
-            auto *manager = new QNetworkAccessManager();
-            manager->setTransferTimeout(10000);
-            manager->setCookieJar(cookieJar.data());
-            cookieJar->setParent(nullptr);
-            auto *reply = manager->post(QNetworkRequest(url), QByteArray());
-            QObject::connect(reply, &QNetworkReply::finished, manager, &QObject::deleteLater);
+            auto *reply = SessionManager::instance().post(QNetworkRequest(url), cookieJar, QByteArray());
+            QObject::connect(reply, &QNetworkReply::finished, reply, &QObject::deleteLater);
         });
     }
 
     // Disconnect from server — session is done from our side
+    if (m_session && m_handingOff) {
+        // Its upload or its freeze still goes on; the identity is in use
+        // until the drain ends
+        QObject::disconnect(m_session, nullptr, this, nullptr);
+        QObject::disconnect(m_session->state(), nullptr, this, nullptr);
+        if (m_auth) QObject::disconnect(m_auth, nullptr, this, nullptr);
+        QObject::disconnect(m_upload, nullptr, this, nullptr);
+        new SessionDrain(m_session, std::exchange(m_auth, nullptr), std::exchange(m_upload, nullptr),
+                         m_fileName, m_freezeDeadline, &SessionManager::instance());
+        forgetIdentity();
+        m_session = nullptr;
+    }
+    m_handingOff = false;
+    // Nothing more goes out
+    dropUpload();
     if (m_session) {
         m_session->deleteLater();
         m_session = nullptr;
     }
 
+    if (m_isSender && !m_sendQueue.isEmpty()) {
+        if (m_completeStatus == "ok") {
+            advanceSendQueue();
+            return;
+        }
+        // A failed or terminated transfer stops the queue
+        discardPreparedSend();
+        clearSendQueue("An earlier send in the queue ended with " + m_completeStatus);
+    }
+
     setScreen("complete");
 }
 
@@ -878,24 +1368,30 @@ void AppController::onSessionInitialized()
     m_bufferMax = state.getLimits().maxChunkQueue;
     emit bufferMaxChanged();
 
-    constexpr int CRYPTO_OVERHEAD = 40;
-    m_maxChunkPayload = state.getLimits().maxChunkSize - CRYPTO_OVERHEAD;
+    m_maxChunkPayload = state.getLimits().maxChunkSize - m_crypto.overhead();
+    if (state.getLimits().maxChunkSize != m_lastMaxChunkSize) {
+        // The guess for the next speculative seal
+        m_lastMaxChunkSize = state.getLimits().maxChunkSize;
+        m_settings.setValue("transfer/last_max_chunk_size", m_lastMaxChunkSize);
+    }
 
     m_frozen = state.getInitialFreeze()->value;
     emit frozenChanged();
 
-    m_sessionExpirationIn = static_cast<int>(
-        state.getExpireTimestamp()->value - QDateTime::currentSecsSinceEpoch());
+    m_expirationDeadline = QDeadlineTimer(
+        (state.getExpireTimestamp()->value - QDateTime::currentSecsSinceEpoch()) * 1000);
     emit sessionExpirationInChanged();
-    m_expirationTimer->start();
 
-    m_freezeRemaining = static_cast<int>(state.getLimits().maxInitialFreeze);
-    emit freezeRemainingChanged();
-    if (m_frozen) m_freezeTimer->start();
+    // After a reconnect the freeze has been running since the first one
+    if (!m_sessionStarted) {
+        m_freezeDeadline = QDeadlineTimer(state.getLimits().maxInitialFreeze * 1000);
+        emit freezeRemainingChanged();
+    }
+    updateCountdowns();
 
     // Sender info
-    m_senderName = state.getSender()->name;
-    m_senderOnline = state.getSender()->isOnline;
+    m_senderName = state.getSender()->value.name;
+    m_senderOnline = state.getSender()->value.isOnline;
     emit senderNameChanged();
     emit senderOnlineChanged();
 
@@ -916,162 +1412,387 @@ void AppController::onSessionInitialized()
 
     updateReceiversList();
 
+    // The WS reconnected and the server sent a fresh snapshot: the
+    // transfer carries on from it by itself, the screen catches up
+    if (m_sessionStarted) {
+        if (m_isSender) resumeSender();
+        return;
+    }
+    m_sessionStarted = true;
+
+    // Rejoined after a restart
+    if (m_resumeEntry.isValid()) {
+        continueFromJournal();
+        return;
+    }
+
     if (m_isSender) {
         buildShareLink();
 
         m_session->sendJsonMessage(
             Action::SetFileInfo(m_fileName, m_fileSize).json());
 
-        m_uploadFile = new QFile(m_filePath, this);
-        if (!m_uploadFile->open(QIODevice::ReadOnly)) {
-            setError("Cannot open file");
-            return;
+        // A prepared or speculative send brings its upload, with the first
+        // chunks presealed
+        if (!m_upload) {
+            QIODevice *file = openUploadFile();
+            if (!file) {
+                setError("Cannot open file");
+                return;
+            }
+            m_upload = new ChunkUpload(file, m_crypto);
+            connectUploadSignals();
         }
 
         setScreen("sender");
-        uploadNextChunk();
+        writeJournal();
+        if (!m_upload->start(m_maxChunkPayload)) setError("Cannot open file");
     } else {
         setScreen("receiver");
-        openDownloadTmpFile();
+        openDownload();
+        writeJournal();
+        m_download->start();
+    }
+}
 
-        const auto &chunks = state.getChunks()->value;
-        for (auto it = chunks.begin(); it != chunks.end(); ++it) {
-            if (it.value().index > m_highestKnownChunk)
-                m_highestKnownChunk = it.value().index;
-            m_downloadQueue.enqueue(it.value().index);
-        }
+void AppController::resumeSender()
+{
+    // Still checking the file after a restart; finishSenderResume() takes
+    // the latest snapshot
+    if (m_sentCheckNext > 0) return;
+
+    // The ChunkUpload resumes from the same snapshot by itself
+    const auto &state = m_session->getState();
+    const qint64 serverLast = state.getLastUploadedChunk()->value;
+    if (serverLast > m_highestKnownChunk) {
+        m_highestKnownChunk = serverLast;
         emit highestKnownChunkChanged();
-        processDownloadQueue();
+    }
+    m_bufferUsed = state.getChunks()->value.size();
+    emit bufferUsedChanged();
+
+    if (state.getFileInfo()->name.isEmpty()) {
+        m_session->sendJsonMessage(Action::SetFileInfo(m_fileName, m_fileSize).json());
+    }
+
+    if (m_uploadFinished) {
+        if (!state.getUploadFinished()->value) {
+            // The server echoes it; onUploadFinishedEvent() completes from there
+            m_session->sendJsonMessage(Action::UploadFinished().json());
+        } else if (!m_frozen) {
+            // Both happened while we were away
+            onSessionComplete("ok");
+        }
     }
 }
 
-// --- Upload logic ---
+// --- Transfer journal ---
 
-void AppController::uploadNextChunk()
+void AppController::writeJournal()
 {
-    if (!m_uploadFile || !m_session || m_waitingForChunkAccepted) return;
+    // Archives are read and unpacked as a stream: neither side can seek
+    // back into one
+    const bool archive = m_isSender ? !m_archiveEntries.isEmpty() : m_receivingArchive;
+    if (!m_journalEnabled || archive || !m_auth || !m_session) return;
+
+    TransferJournal::Entry entry;
+    entry.server = m_activeServer;
+    entry.sessionId = m_session->getId();
+    entry.sender = m_isSender;
+    entry.clientId = m_auth->getId();
+    entry.cookies = m_auth->getCookies();
+    entry.key = m_crypto.key;
+    entry.cipher = static_cast<int>(m_crypto.cipher);
+    entry.nonceMode = static_cast<int>(m_crypto.nonceMode);
+    entry.compression = static_cast<int>(m_crypto.codec.method());
+    entry.compressionLevel = m_crypto.codec.level();
+    entry.fileName = m_fileName;
+    entry.fileSize = m_fileSize;
+    entry.chunkPayload = m_maxChunkPayload;
+    entry.filePath = m_filePath;
+    if (m_isSender) entry.fileMtime = QFileInfo(m_filePath).lastModified().toMSecsSinceEpoch();
+    if (m_download) entry.tmpPath = m_download->tmpPath();
+    if (!m_journal.store(entry)) return;
+    m_journalEntry = entry;
+    m_journalStored = entry.sentChunks;
+    m_journaled = true;
+    if (m_download) m_download->setHoldConfirms(true);
+}
 
-    if (m_uploadFile->atEnd()) {
-        m_session->sendJsonMessage(Action::UploadFinished().json());
-        m_uploadFinished = true;
-        emit uploadFinishedChanged();
-        m_uploadFile->close();
-        delete m_uploadFile;
-        m_uploadFile = nullptr;
+void AppController::journalChunkSent(const SealedChunk &chunk)
+{
+    // Sent again after a reconnect: counted the first time
+    if (!m_journaled || !m_isSender || chunk.index <= m_journalEntry.sentChunks) return;
+    m_journalEntry.sentChunks = chunk.index;
+    m_journalEntry.sentDigest = TransferJournal::chainDigest(m_journalEntry.sentDigest, chunk.plainDigest);
+    m_journalEntry.sealedDigest = chunk.sealedDigest;
+    // In counter mode on disk before the chunk is on the wire: a journal
+    // that lags could have a resume seal other bytes under this chunk's
+    // nonce. Random nonces never repeat, so there a resume just carries on
+    // from the server's last chunk and the journal may trail behind.
+    const bool counter = m_crypto.nonceMode == Crypto::NonceMode::Counter;
+    if (!counter && chunk.index - m_journalStored < JOURNAL_LAG_CHUNKS) return;
+    if (!m_journal.store(m_journalEntry)) {
+        removeJournal();
         return;
     }
-
-    QByteArray raw = m_uploadFile->read(m_maxChunkPayload);
-    QByteArray encrypted = Crypto::encrypt(raw, m_encryptionKey);
-    m_session->sendBinaryMessage(encrypted);
-    m_waitingForChunkAccepted = true;
+    m_journalStored = chunk.index;
 }
 
-void AppController::onNewChunkEvent(qint64 index, qint64 size)
+void AppController::removeJournal()
 {
-    Q_UNUSED(size)
+    if (!m_journaled) return;
+    m_journal.remove();
+    m_journaled = false;
+}
 
-    if (m_isSender) {
-        if (index > m_highestKnownChunk) {
-            m_highestKnownChunk = index;
-            emit highestKnownChunkChanged();
-        }
+void AppController::resumeFromJournal()
+{
+    if (!m_journalEnabled || m_screen != "entry" || m_auth) return;
+    const TransferJournal::Entry entry = m_journal.load();
+    if (!entry.isValid()) return;
 
-        if (!m_session) return;
+    qInfo() << "Resuming the" << (entry.sender ? "upload" : "download") << "of" << entry.fileName
+            << "in session" << entry.sessionId;
+    // Whatever happens next, the entry has had its chance
+    m_journaled = true;
 
-        m_bufferUsed = m_session->getState().getChunks()->value.size();
-        emit bufferUsedChanged();
+    m_isSender = entry.sender;
+    m_pendingRole = entry.sender ? "sender" : "receiver";
+    emit isSenderChanged();
+    m_activeServer = entry.server;
+    emit activeServerChanged();
+    m_serverWorkload->onServerHostUpdated(QUrl(m_activeServer));
 
-        if (m_waitingForChunkAccepted) {
-            m_waitingForChunkAccepted = false;
+    m_crypto.key = entry.key;
+    m_crypto.cipher = static_cast<Crypto::Cipher>(entry.cipher);
+    m_crypto.nonceMode = static_cast<Crypto::NonceMode>(entry.nonceMode);
+    // The level of the chunks already sent, not the one set now
+    m_crypto.codec.setMethod(static_cast<ChunkCodec::Method>(entry.compression), entry.compressionLevel);
+    m_crypto.digest = true;  // journaled, so never an archive
+    m_fileName = entry.fileName;
+    m_fileSize = entry.fileSize;
+    emit fileNameChanged();
+    emit fileSizeChanged();
 
-            if (m_bufferUsed >= m_bufferMax) {
-                m_canSendChunk = false;
-            } else {
-                QTimer::singleShot(0, this, &AppController::uploadNextChunk);
-            }
+    if (entry.sender) {
+        m_filePath = entry.filePath;
+        auto *file = new QFile(m_filePath, this);
+        const QFileInfo info(m_filePath);
+        if (info.size() != entry.fileSize || info.lastModified().toMSecsSinceEpoch() != entry.fileMtime
+            || !file->open(QIODevice::ReadOnly)) {
+            delete file;
+            abandonJournal("The file being sent has changed or is gone");
+            return;
         }
+        // Nothing goes out before finishSenderResume()
+        m_upload = new ChunkUpload(file, m_crypto);
+        connectUploadSignals();
     } else {
-        if (index > m_highestKnownChunk) {
-            m_highestKnownChunk = index;
-            emit highestKnownChunkChanged();
+        m_download = new ChunkDownload(m_crypto);
+        connectDownloadSignals();
+        QString error;
+        if (!m_download->reopen(entry.tmpPath, entry.fileSize, entry.chunkPayload, &error)) {
+            abandonJournal(error);
+            return;
         }
-        m_downloadQueue.enqueue(index);
-        processDownloadQueue();
+        m_download->setHoldConfirms(true);
     }
+    m_resumeEntry = entry;
+    setScreen("connecting");
+
+    m_auth = new Authorization(this);
+    m_auth->setUrl(QUrl(entry.server));
+    m_auth->setName(m_userName);
+    m_auth->restore(entry.clientId, entry.cookies);
+    // A fresh identity is no use: only the one in the session can rejoin it
+    const QString gone = QStringLiteral("The interrupted transfer is no longer on the server");
+    QObject::connect(m_auth, &Authorization::authorized, this, &AppController::onJournalAuthorized);
+    QObject::connect(m_auth, &Authorization::captchaRequired, this, [this, gone]() { abandonJournal(gone); });
+    QObject::connect(m_auth, &Authorization::error, this, [this, gone]() { abandonJournal(gone); });
+    QObject::connect(m_auth, &Authorization::serverFull, this, [this, gone]() { abandonJournal(gone); });
+    m_auth->connect();
+
+    // The server forgets a client a minute after its WebSocket is gone and
+    // then may say nothing at all
+    QTimer::singleShot(RESUME_TIMEOUT_SECS * 1000, this, [this, gone]() {
+        if (m_resumeEntry.isValid()) abandonJournal(gone);
+    });
 }
 
-void AppController::onChunkRemovedEvent()
+void AppController::onJournalAuthorized()
 {
-    if (m_isSender && m_session) {
-        m_bufferUsed = m_session->getState().getChunks()->value.size();
-        emit bufferUsedChanged();
+    if (!m_auth->isRestored()) {
+        abandonJournal("The interrupted transfer is no longer on the server");
+        return;
     }
+    emit myClientIdChanged();
+
+    if (m_session) m_session->deleteLater();
+    m_session = new Session(m_auth->getUrl(), m_auth->getCookieJar(), this);
+    m_session->setEventRecording(m_eventsFile);
+    connectSessionSignals();
+    m_session->resume(m_resumeEntry.sessionId, m_resumeEntry.sender);
 }
 
-void AppController::onNewChunkAllowed(bool status)
+void AppController::continueFromJournal()
 {
-    if (m_isSender && status && !m_canSendChunk && m_session) {
-        m_canSendChunk = true;
-        QTimer::singleShot(0, this, &AppController::uploadNextChunk);
+    const TransferJournal::Entry entry = m_resumeEntry;
+    m_resumeEntry = TransferJournal::Entry();
+
+    // The offsets are in whole chunks of the old size
+    if (m_maxChunkPayload != entry.chunkPayload) {
+        abandonJournal("The server's chunk size has changed");
+        return;
     }
-}
+    const auto &state = m_session->getState();
+    const qint64 serverLast = state.getLastUploadedChunk()->value;
 
-// --- Download logic ---
+    if (m_isSender) {
+        buildShareLink();
+        // Nothing goes out until the chunks sent before the restart are
+        // known to come from the same bytes
+        m_journalEntry = entry;
+        m_journalStored = entry.sentChunks;
+        m_sentCheckNext = 1;
+        m_sentCheckDigest.clear();
+        checkSentPrefix();
+        return;
+    }
 
-void AppController::processDownloadQueue()
-{
-    while (m_activeDownloads < MAX_PARALLEL_DOWNLOADS && !m_downloadQueue.isEmpty() && m_session) {
-        qint64 index = m_downloadQueue.dequeue();
-        if (m_writtenChunks.contains(index)) continue;
+    // Confirms wait for the disk, so chunks the server dropped are on it.
+    // Written ones still in its buffer may not have been synced before a
+    // power loss: the file is cut back to the first of them and they are
+    // fetched again.
+    const auto &chunks = state.getChunks()->value;
+    qint64 next = m_download->nextIndex();
+    chunks.forEach([&next](const SessionStateStructures::Chunk &chunk) {
+        if (chunk.index < next) next = chunk.index;
+    });
+    m_download->rewindTo(next, entry.chunkPayload);
+    // The next chunk to write was dropped from the server, yet it is not
+    // in the file
+    if (serverLast >= next && !chunks.contains(next)) {
+        abandonJournal("Chunks received before the restart are no longer on the server");
+        return;
+    }
+    setScreen("receiver");
+    m_download->start();
+}
 
-        m_activeDownloads++;
-        m_session->downloadChunkHttp(index);
+void AppController::checkSentPrefix()
+{
+    // Cancelled, or a resume abandoned meanwhile
+    if (m_sentCheckNext == 0 || !m_upload || !m_upload->file() || !m_session) return;
+
+    // With random nonces the journal may trail the server: the chunks it
+    // has beyond the journal are hashed on into the chain
+    const qint64 sent = m_journalEntry.sentChunks;
+    const qint64 serverLast = m_session->getState().getLastUploadedChunk()->value;
+    const qint64 end = m_crypto.nonceMode == Crypto::NonceMode::Counter ? sent : qMax(sent, serverLast);
+
+    // A few chunks per event loop pass, so the WebSocket keeps answering
+    for (int i = 0; i < SENT_CHECK_CHUNKS_PER_PASS && m_sentCheckNext <= end; ++i) {
+        const QByteArray raw = m_upload->file()->read(m_maxChunkPayload);
+        m_sentCheckDigest = TransferJournal::chainDigest(m_sentCheckDigest, TransferJournal::digest(raw));
+        if (m_sentCheckNext == sent && m_sentCheckDigest != m_journalEntry.sentDigest) {
+            abandonJournal("The file being sent has changed");
+            return;
+        }
+        ++m_sentCheckNext;
+    }
+    if (m_sentCheckNext <= end) {
+        QTimer::singleShot(0, this, &AppController::checkSentPrefix);
+        return;
     }
+    m_sentCheckNext = 0;
+    m_journalEntry.sentChunks = end;
+    m_journalEntry.sentDigest = m_sentCheckDigest;
+    finishSenderResume();
 }
 
-void AppController::onChunkDataReceived(qint64 index, const QByteArray &data)
+void AppController::finishSenderResume()
 {
-    QByteArray decrypted = Crypto::decrypt(data, m_encryptionKey);
-    if (decrypted.isEmpty()) {
-        qWarning() << "Failed to decrypt chunk" << index;
-        m_activeDownloads--;
-        processDownloadQueue();
+    const auto &state = m_session->getState();
+    const qint64 serverLast = state.getLastUploadedChunk()->value;
+    const qint64 sent = m_journalEntry.sentChunks;
+
+    // In counter mode the journal is written before each chunk goes out,
+    // so the server has all of them or all but the last. With random nonces
+    // it trails behind: the server may have more, which were read from the
+    // same file (its size and mtime are checked) and are not sent again.
+    const bool counter = m_crypto.nonceMode == Crypto::NonceMode::Counter;
+    if (serverLast < sent - 1 || (counter && serverLast > sent)) {
+        abandonJournal("The journal does not match the server");
+        return;
+    }
+    QIODevice *file = m_upload->file();
+    if (!file->seek(serverLast * m_maxChunkPayload)) {
+        abandonJournal("Cannot read the file being sent");
         return;
     }
+    qint64 readIndex = serverLast;
+    SealedChunk resend;
+    if (counter && serverLast < sent) {
+        // Sent but not stored: it goes out again, and its nonce is fixed by
+        // the index, so it must be the very same ciphertext. Sealed here
+        // rather than on a worker: nothing goes out before it.
+        const QByteArray raw = file->read(m_maxChunkPayload);
+        resend = m_upload->crypto().seal(raw, sent, file->atEnd());
+        if (resend.sealedDigest != m_journalEntry.sealedDigest) {
+            abandonJournal("The last chunk sent cannot be sealed the same way again");
+            return;
+        }
+        readIndex = sent;
+    }
+    m_highestKnownChunk = serverLast;
+    emit highestKnownChunkChanged();
+    if (state.getUploadFinished()->value) {
+        m_uploadFinished = true;
+        emit uploadFinishedChanged();
+    }
+    setScreen("sender");
+    resumeSender();
+    if (!m_uploadFinished) m_upload->startAt(m_maxChunkPayload, readIndex, resend);
+}
 
-    m_writtenChunks.insert(index);
-    flushChunksToDisk(index, decrypted);
+void AppController::abandonJournal(const QString &reason)
+{
+    qWarning() << "Cannot resume the interrupted transfer:" << reason;
+    // Drops the journal and the receiver's temporary file with the rest
+    restart();
+    setError(reason);
+}
 
-    m_session->sendJsonMessage(Action::ConfirmChunk(index).json());
-    m_chunksConfirmed++;
-    m_pendingConfirms++;
-    emit chunksConfirmedChanged();
+// --- Upload logic ---
 
-    m_activeDownloads--;
-    processDownloadQueue();
+void AppController::onNewChunkEvent(qint64 index, qint64 size)
+{
+    Q_UNUSED(size)
+    // The ChunkUpload and ChunkDownload follow the chunks themselves; the
+    // sender's screen shows the server's buffer
+    if (!m_isSender || !m_session) return;
+    if (index > m_highestKnownChunk) {
+        m_highestKnownChunk = index;
+        emit highestKnownChunkChanged();
+    }
+    m_bufferUsed = m_session->getState().getChunks()->value.size();
+    emit bufferUsedChanged();
 }
 
-void AppController::onChunkDownloadFailed(qint64 index, const QString &error)
+void AppController::onChunkRemovedEvent()
 {
-    qWarning() << "Chunk" << index << "download failed:" << error;
-    m_activeDownloads--;
-    // Re-enqueue for retry (unless 404 = removed)
-    if (!error.contains("404")) {
-        m_downloadQueue.enqueue(index);
+    if (m_isSender && m_session) {
+        m_bufferUsed = m_session->getState().getChunks()->value.size();
+        emit bufferUsedChanged();
     }
-    processDownloadQueue();
 }
 
+// --- Download logic ---
+
 void AppController::onChunkDownloadFinished(const QString &receiverId, qint64 index)
 {
-    Q_UNUSED(index)
-    // Server acknowledged our confirm_chunk
-    if (m_auth && receiverId == m_auth->getId() && m_pendingConfirms > 0) {
-        m_pendingConfirms--;
-        checkReceiverDone();
-    }
-
+    PipelineTrace::instant(PipelineTrace::Stage::DownloadFinished, index);
     // Track per-receiver download progress
     if (m_isSender) {
         m_receiverChunksDone[receiverId]++;
@@ -1079,19 +1800,6 @@ void AppController::onChunkDownloadFinished(const QString &receiverId, qint64 in
     updateReceiversList();
 }
 
-void AppController::checkReceiverDone()
-{
-    if (m_uploadFinished && !m_writtenChunks.isEmpty() &&
-        m_chunksConfirmed > 0 && m_chunksConfirmed >= m_highestKnownChunk &&
-        m_pendingConfirms == 0) {
-        m_hasDownloadedFile = true;
-        emit hasDownloadedFileChanged();
-        // All chunks downloaded, decrypted, confirmed, and acknowledged.
-        // Receiver's job is done — complete immediately.
-        onSessionComplete("ok");
-    }
-}
-
 // --- State event handlers ---
 
 void AppController::onFreezeDropped()
@@ -1114,12 +1822,15 @@ void AppController::onUploadFinishedEvent()
         // If freeze still active — wait, complete when freeze drops.
         if (!m_frozen) {
             onSessionComplete("ok");
+        } else {
+            // onFreezeDropped() will complete the session, unless the next
+            // queued send is ready to take over
+            handOffSend();
         }
-        // else: onFreezeDropped() will complete the session
     } else {
+        // The ChunkDownload completes once it has every chunk
         m_uploadFinished = true;
         emit uploadFinishedChanged();
-        checkReceiverDone();
     }
 }
 
@@ -1170,7 +1881,7 @@ void AppController::onReceiverRemovedEvent(const QString &id)
 void AppController::onOnlineEvent(const QString &id, bool online)
 {
     // Update sender
-    if (m_session && m_session->getState().getSender()->id == id) {
+    if (m_session && m_session->getState().getSender()->value.id == id) {
         m_senderOnline = online;
         emit senderOnlineChanged();
         return;
@@ -1194,7 +1905,7 @@ void AppController::onOnlineEvent(const QString &id, bool online)
 
 void AppController::onNameChangedEvent(const QString &id, const QString &name)
 {
-    if (m_session && m_session->getState().getSender()->id == id) {
+    if (m_session && m_session->getState().getSender()->value.id == id) {
         m_senderName = name;
         emit senderNameChanged();
     }
@@ -1206,15 +1917,16 @@ void AppController::updateReceiversList()
     if (!m_session) return;
 
     m_receivers.clear();
-    const auto &map = m_session->getState().getReceivers()->value;
-    for (auto it = map.begin(); it != map.end(); ++it) {
+    const auto &table = m_session->getState().getReceivers()->value;
+    m_receivers.reserve(table.size());
+    for (const auto &member : table) {
         QVariantMap r;
-        r["id"] = it.value()->id;
-        r["name"] = it.value()->name;
-        r["isOnline"] = it.value()->isOnline;
-        r["currentChunk"] = it.value()->currentChunk.index;
+        r["id"] = member.id;
+        r["name"] = member.name;
+        r["isOnline"] = member.isOnline;
+        r["currentChunk"] = member.currentChunk.index;
         bool done = m_uploadFinished && m_highestKnownChunk > 0 &&
-                    m_receiverChunksDone.value(it.value()->id, 0) >= m_highestKnownChunk;
+                    m_receiverChunksDone.value(member.id, 0) >= m_highestKnownChunk;
         r["done"] = done;
         m_receivers.append(r);
     }
@@ -1223,12 +1935,197 @@ void AppController::updateReceiversList()
 
 void AppController::buildShareLink()
 {
-    if (!m_session || m_session->getId().isEmpty() || m_encryptionKey.isEmpty()) return;
-
-    m_shareLink = QStringLiteral("%1/#id=%2&encryption=xchacha20-poly1305&key=%3")
-                      .arg(m_serverUrl, m_session->getId(),
-                           Crypto::keyToBase64Url(m_encryptionKey));
+    if (!m_session || m_session->getId().isEmpty() || m_crypto.key.isEmpty()) return;
+
+    // Receivers that predate compression ignore the parameter and would save
+    // the framed chunks as is, which is why compression is off by default
+    const QString compression = m_crypto.codec.method() == ChunkCodec::Method::None
+        ? QString() : "&compression=" + ChunkCodec::methodName(m_crypto.codec.method());
+    const QString nonce = m_crypto.nonceMode == Crypto::NonceMode::Random
+        ? QString() : "&nonce=" + Crypto::nonceModeName(m_crypto.nonceMode);
+    // Older receivers ignore it and save the .tar as a regular file
+    const QString archive = m_archiveEntries.isEmpty() ? QString() : QStringLiteral("&archive=tar");
+    const QString link = QStringLiteral("%1/#id=%2&encryption=%3%4%5%6&key=%7")
+                             .arg(m_activeServer, m_session->getId(), Crypto::cipherName(m_crypto.cipher), nonce,
+                                  compression, archive, Crypto::keyToBase64Url(m_crypto.key));
+    if (link == m_shareLink) return;
+    m_shareLink = link;
     emit shareLinkChanged();
+    if (!m_filePath.isEmpty()) emit sendLinkReady(m_filePath, m_shareLink);
+}
+
+void AppController::clearSendQueue(const QString &reason)
+{
+    if (m_sendQueue.isEmpty()) return;
+    for (const QString &path : std::as_const(m_sendQueue)) emit sendDropped(path, reason);
+    m_sendQueue.clear();
+    emit sendQueueChanged();
+}
+
+void AppController::prepareNextSend()
+{
+    // Only once the current upload is done or paced by a slow receiver, so
+    // the two never compete for the link
+    const bool stalled = m_upload && m_upload->isStalled() && receiversPresent();
+    if (!m_isSender || !m_session || !(m_uploadFinished || stalled) || m_sendQueue.isEmpty()
+        || m_prepared.auth) return;
+
+    m_prepared.filePath = m_sendQueue.head();
+    m_prepared.age.start();
+    m_prepared.auth = new Authorization(this);
+    m_prepared.auth->setUrl(QUrl(m_activeServer));
+    m_prepared.auth->setName(m_userName);
+    QObject::connect(m_prepared.auth, &Authorization::authorized, this, &AppController::onPreparedAuthorized);
+    // A captcha needs the user; the next send is then set up after completion
+    QObject::connect(m_prepared.auth, &Authorization::captchaRequired, this, &AppController::discardPreparedSend);
+    QObject::connect(m_prepared.auth, &Authorization::error, this, &AppController::discardPreparedSend);
+    QObject::connect(m_prepared.auth, &Authorization::serverFull, this, &AppController::discardPreparedSend);
+    m_prepared.auth->connect();
+}
+
+void AppController::onPreparedAuthorized()
+{
+    PreparedSend &next = m_prepared;
+    // Not recorded with --record-events: it would overwrite the recording
+    // of the transfer that is still draining
+    next.session = new Session(next.auth->getUrl(), next.auth->getCookieJar(), this);
+    next.crypto = senderCrypto(true);
+
+    QObject::connect(next.session->state(), &SessionState::sessionInitialized,
+                     this, &AppController::onPreparedSessionInitialized);
+    QObject::connect(next.session, &Session::complete, this, &AppController::discardPreparedSend);
+    QObject::connect(next.session, &Session::webSocketConnection, this, &AppController::onPreparedWsConnection);
+    next.session->create(m_autoDropFreeze);
+}
+
+void AppController::onPreparedSessionInitialized()
+{
+    PreparedSend &next = m_prepared;
+    if (next.initialized) return;
+    next.initialized = true;
+
+    auto *file = new QFile(next.filePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        discardPreparedSend();
+        return;
+    }
+
+    // Read the first chunks now and seal them on the crypto workers, so the
+    // new session starts sending at once
+    const auto &limits = next.session->getState().getLimits();
+    next.upload = new ChunkUpload(file, next.crypto);
+    next.upload->setSession(next.session);
+    next.upload->preseal(limits.maxChunkSize - next.crypto.overhead(),
+                         static_cast<int>(qMin<qint64>(ChunkUpload::PRESEAL_CHUNKS, limits.maxChunkQueue)));
+    handOffSend();
+}
+
+void AppController::onPreparedWsConnection(bool connected, bool serverClosed)
+{
+    Q_UNUSED(serverClosed);
+    if (!connected) discardPreparedSend();
+}
+
+void AppController::discardPreparedSend()
+{
+    if (m_prepared.session) {
+        Session *session = m_prepared.session;
+        QObject::disconnect(session, nullptr, this, nullptr);
+        QObject::disconnect(session->state(), nullptr, this, nullptr);
+        // Ends it on the server now rather than at the session timeout
+        session->forceQuit();
+        QTimer::singleShot(5000, session, &QObject::deleteLater);
+    }
+    if (m_prepared.auth) {
+        QObject::disconnect(m_prepared.auth, nullptr, this, nullptr);
+        m_prepared.auth->deleteLater();
+    }
+    if (m_prepared.upload) {
+        m_prepared.upload->cancel();
+        m_prepared.upload->deleteLater();
+    }
+    m_prepared = PreparedSend();
+}
+
+void AppController::advanceSendQueue()
+{
+    const QString filePath = m_sendQueue.dequeue();
+    const QQueue<QString> rest = std::exchange(m_sendQueue, {});
+    PreparedSend next = m_prepared;
+    m_prepared = PreparedSend();  // taken over here, not discarded by the reset
+
+    resetSessionState();
+    m_sendQueue = rest;
+    emit sendQueueChanged();
+    m_isSender = true;
+    m_pendingRole = "sender";
+    emit isSenderChanged();
+
+    // Once its freeze has run out, the session would not keep chunks for
+    // receivers who are only now getting the link
+    const bool usable = next.session && next.filePath == filePath
+        && m_serverSelector->contains(next.auth->getUrl())
+        && (!next.initialized || next.session->getState().getInitialFreeze()->value);
+    if (!usable) {
+        m_prepared = next;
+        discardPreparedSend();
+        selectFile(QUrl::fromLocalFile(filePath));
+        return;
+    }
+
+    if (m_auth) m_auth->deleteLater();
+    m_auth = next.auth;
+    QObject::disconnect(m_auth, nullptr, this, nullptr);
+    rememberIdentity();
+    emit myClientIdChanged();
+
+    m_session = next.session;
+    QObject::disconnect(m_session, nullptr, this, nullptr);
+    QObject::disconnect(m_session->state(), nullptr, this, nullptr);
+    connectSessionSignals();
+
+    m_activeServer = next.auth->getUrl().toString();
+    emit activeServerChanged();
+    m_serverWorkload->onServerHostUpdated(QUrl(m_activeServer));
+
+    m_crypto = next.crypto;
+
+    const QFileInfo fi(filePath);
+    m_filePath = filePath;
+    m_fileName = fi.fileName();
+    m_fileSize = fi.size();
+    emit fileNameChanged();
+    emit fileSizeChanged();
+    // Its presealed chunks, and those still on a worker, come with it
+    m_upload = next.upload;
+    if (m_upload) connectUploadSignals();
+
+    if (!next.initialized) {
+        setScreen("connecting");  // onSessionInitialized() follows start_init
+        return;
+    }
+    onSessionInitialized();
+    // The freeze has been counting down since the session was created
+    m_freezeDeadline = QDeadlineTimer(qMax<qint64>(0, m_freezeDeadline.remainingTime() - next.age.elapsed()));
+    emit freezeRemainingChanged();
+}
+
+void AppController::handOffSend()
+{
+    // A send may wait a long time: for its freeze once uploaded, which keeps
+    // the link open for receivers who have not joined yet, or for the
+    // slowest receiver when the server's buffer is full. The next queued
+    // send need not wait with it: the session and its ChunkUpload go to a
+    // SessionDrain that carries on until then, and the prepared one is
+    // promoted now.
+    if (!m_isSender || !m_session || !m_upload || m_sendQueue.isEmpty() || !m_prepared.initialized) return;
+    const bool uploaded = m_session->getState().getUploadFinished()->value;
+    if (uploaded ? !m_frozen : !(m_upload->isStalled() && receiversPresent())) return;
+    qInfo().noquote() << "Handing off" << m_fileName
+                      << (uploaded ? "to wait out its freeze" : "to finish sending in the background");
+    m_handingOff = true;
+    onSessionComplete("ok");
 }
 
 void AppController::onServerWorkloadUpdated(const ServerWorkloadInfo &info)
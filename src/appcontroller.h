@@ -12,13 +12,26 @@
 #include <QMap>
 #include <QTimer>
 #include <QQueue>
+#include <QSet>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
 #include <QUrl>
 #include <QLocale>
 #include <QNetworkProxy>
+#include <QPointer>
 
 #include "client/authorization.h"
+#include "client/identitycache.h"
+#include "client/serverselector.h"
 #include "client/serverworkload.h"
+#include "client/session/chunkdownload.h"
+#include "client/session/chunkupload.h"
 #include "client/session/session.h"
+#include "crypto/crypto.h"
+#include "transfer/chunkcodec.h"
+#include "transfer/chunkcrypto.h"
+#include "transfer/tarsource.h"
+#include "transfer/transferjournal.h"
 
 class AppController : public QObject
 {
@@ -54,6 +67,8 @@ class AppController : public QObject
     Q_PROPERTY(int chunksConfirmed READ chunksConfirmed NOTIFY chunksConfirmedChanged)
     Q_PROPERTY(int highestKnownChunk READ highestKnownChunk NOTIFY highestKnownChunkChanged)
     Q_PROPERTY(QUrl suggestedSavePath READ suggestedSavePath NOTIFY fileNameChanged)
+    Q_PROPERTY(bool receivingArchive READ receivingArchive NOTIFY receivingArchiveChanged)
+    Q_PROPERTY(int queuedCount READ queuedCount NOTIFY sendQueueChanged)
     Q_PROPERTY(bool receiversPresent READ receiversPresent NOTIFY receiversChanged)
     Q_PROPERTY(QString myClientId READ myClientId NOTIFY myClientIdChanged)
     Q_PROPERTY(QString language READ language NOTIFY languageChanged)
@@ -62,6 +77,10 @@ class AppController : public QObject
     Q_PROPERTY(QString proxyHost READ proxyHost NOTIFY proxyChanged)
     Q_PROPERTY(quint16 proxyPort READ proxyPort NOTIFY proxyChanged)
     Q_PROPERTY(bool autoDropFreeze READ autoDropFreeze NOTIFY autoDropFreezeChanged)
+    Q_PROPERTY(bool compression READ compression NOTIFY compressionChanged)
+    Q_PROPERTY(bool compressionAvailable READ compressionAvailable CONSTANT)
+    Q_PROPERTY(bool preferAes READ preferAes NOTIFY preferAesChanged)
+    Q_PROPERTY(bool aesAvailable READ aesAvailable CONSTANT)
 
 public:
     explicit AppController(QObject *parent = nullptr);
@@ -84,8 +103,8 @@ public:
     int bufferMax() const { return m_bufferMax; }
     bool isSender() const { return m_isSender; }
     bool frozen() const { return m_frozen; }
-    int freezeRemaining() const { return m_freezeRemaining; }
-    int sessionExpirationIn() const { return m_sessionExpirationIn; }
+    int freezeRemaining() const { return secondsLeft(m_freezeDeadline); }
+    int sessionExpirationIn() const { return secondsLeft(m_expirationDeadline); }
     QString senderName() const { return m_senderName; }
     bool senderOnline() const { return m_senderOnline; }
     QVariantList receivers() const { return m_receivers; }
@@ -94,9 +113,11 @@ public:
     QString completeStatus() const { return m_completeStatus; }
     bool hasDownloadedFile() const { return m_hasDownloadedFile; }
     QVariantMap stats() const { return m_stats; }
-    int chunksConfirmed() const { return m_chunksConfirmed; }
-    int highestKnownChunk() const { return m_highestKnownChunk; }
+    int chunksConfirmed() const { return m_download ? m_download->chunksConfirmed() : 0; }
+    int highestKnownChunk() const { return m_download ? m_download->highestKnownChunk() : m_highestKnownChunk; }
     QUrl suggestedSavePath() const;
+    bool receivingArchive() const { return m_receivingArchive; }
+    int queuedCount() const { return m_sendQueue.size(); }
     bool receiversPresent() const { return !m_receivers.isEmpty(); }
     QString myClientId() const { return m_auth ? m_auth->getId() : QString(); }
     QString language() const { return m_language; }
@@ -105,16 +126,42 @@ public:
     QString proxyHost() const { return m_proxyHost; }
     quint16 proxyPort() const { return m_proxyPort; }
     bool autoDropFreeze() const { return m_autoDropFreeze; }
+    bool compression() const { return m_compression; }
+    bool compressionAvailable() const { return ChunkCodec::isAvailable(ChunkCodec::Method::Zstd); }
+    bool preferAes() const { return m_preferAes; }
+    bool aesAvailable() const { return Crypto::isAvailable(Crypto::Cipher::Aes256Gcm); }
+
+    // Enables per-chunk pipeline tracing; the Chrome trace JSON is written
+    // to `path` when a session completes and on exit. Empty disables it.
+    void setTraceFile(const QString &path);
+    // Writes the current transfer's stats (full histograms) as JSON to
+    // `path` when the session completes or on exit. Empty disables it.
+    void setStatsFile(const QString &path);
+    // Records the raw WebSocket events of every session to `path` for
+    // putinqa-replay. Each new session overwrites it. Empty disables it.
+    void setEventsFile(const QString &path);
+
+    // Tools only: replaces the session with an offline one (no network
+    // I/O) wired to the usual handlers, so recorded events can be fed in
+    // with Session::replayEvent().
+    Session *startOfflineSession(bool isSender);
 
     Q_INVOKABLE void startSend();
     Q_INVOKABLE void selectFile(const QUrl &fileUrl);
+    // Several files or a folder go out as one tar archive, see TarSource
+    Q_INVOKABLE void selectFiles(const QList<QUrl> &fileUrls);
+    Q_INVOKABLE void selectFolder(const QUrl &folderUrl);
+    // Files sent one after another, each in its own session; the next
+    // session is set up while the current one drains. Starts the first
+    // file right away when idle.
+    Q_INVOKABLE void enqueueFiles(const QList<QUrl> &fileUrls);
     Q_INVOKABLE void startReceive(const QString &link);
     Q_INVOKABLE void solveCaptcha(const QString &answer);
     Q_INVOKABLE void copyShareLink();
     Q_INVOKABLE void openSettings();
     Q_INVOKABLE void saveSettings(const QString &url, const QString &name, const QString &language,
                                       const QString &proxyType, const QString &proxyHost, quint16 proxyPort,
-                                      bool autoDropFreeze);
+                                      bool autoDropFreeze, bool compression, bool preferAes);
     Q_INVOKABLE void dropFreeze();
     Q_INVOKABLE void kickReceiver(const QString &id);
     Q_INVOKABLE void terminateSession();
@@ -125,6 +172,11 @@ public:
     Q_INVOKABLE void minimizeToTray();
     Q_INVOKABLE QString formatBytes(qint64 bytes) const;
     Q_INVOKABLE QString qrDataUrl() const;
+    Q_INVOKABLE QString transferStatsJson() const;
+
+    // Window hidden (tray) or minimized: polls back off and the UI-only
+    // timers stop until it is shown again
+    void setBackground(bool background);
 
 signals:
     void screenChanged();
@@ -134,6 +186,10 @@ signals:
     void serverUrlChanged();
     void errorMsgChanged();
     void shareLinkChanged();
+    // A file given to send has its share link, or will not be sent at all
+    // (for --send, see main.cpp)
+    void sendLinkReady(const QString &filePath, const QString &link);
+    void sendDropped(const QString &filePath, const QString &reason);
     void fileNameChanged();
     void fileSizeChanged();
     void progressChanged();
@@ -152,6 +208,8 @@ signals:
     void captchaAnswerLengthChanged();
     void completeStatusChanged();
     void hasDownloadedFileChanged();
+    void receivingArchiveChanged();
+    void sendQueueChanged();
     void statsChanged();
     void chunksConfirmedChanged();
     void highestKnownChunkChanged();
@@ -160,6 +218,8 @@ signals:
 
     void proxyChanged();
     void autoDropFreezeChanged();
+    void compressionChanged();
+    void preferAesChanged();
     void showWindowRequested();
     void trayRequested();
 
@@ -172,7 +232,6 @@ private slots:
     void onSessionInitialized();
     void onNewChunkEvent(qint64 index, qint64 size);
     void onChunkRemovedEvent();
-    void onNewChunkAllowed(bool status);
     void onFreezeDropped();
     void onUploadFinishedEvent();
     void onFileInfoEvent(const QString &name, qint64 size);
@@ -182,8 +241,6 @@ private slots:
     void onReceiverRemovedEvent(const QString &id);
     void onOnlineEvent(const QString &id, bool online);
     void onNameChangedEvent(const QString &id, const QString &name);
-    void onChunkDataReceived(qint64 index, const QByteArray &data);
-    void onChunkDownloadFailed(qint64 index, const QString &error);
     void onChunkDownloadFinished(const QString &receiverId, qint64 index);
     void onServerWorkloadUpdated(const ServerWorkloadInfo &info);
 
@@ -192,19 +249,56 @@ private:
     void setError(const QString &msg);
     void loadSettings();
     void authorize();
+    Authorization *createAuthorization(const QUrl &server);
+    void connectAuthSignals();
+    void updateServerList();
+    void onServerFull();
+    bool failOver();
+    void preAuthorize();
+    bool adoptPreAuthorization();
+    void rememberIdentity();
+    void forgetIdentity();
     void proceedAfterAuth();
     void startSenderSession();
     void startReceiverSession();
     void connectSessionSignals();
-    void uploadNextChunk();
-    void processDownloadQueue();
-    void checkReceiverDone();
+    void resumeSender();
+    void resumeFromJournal();
+    void onJournalAuthorized();
+    void continueFromJournal();
+    void checkSentPrefix();
+    void finishSenderResume();
+    void abandonJournal(const QString &reason);
+    void writeJournal();
+    void removeJournal();
+    void selectArchive(const QStringList &roots, const QString &name);
+    void beginSending();
+    // A new key, with the cipher, nonces and compression from the settings
+    ChunkCrypto senderCrypto(bool journaled) const;
+    void startSpeculativeSeal();
+    QIODevice *openUploadFile();
+    void connectUploadSignals();
+    void dropUpload();
+    void openDownload();
+    void connectDownloadSignals();
+    void dropDownload();
     void updateReceiversList();
     void buildShareLink();
+    void clearSendQueue(const QString &reason);
     void resetSessionState();
     void applyProxy();
+    void publishTransferStats();
+    void updateCountdowns();
+    void writeDiagnostics();
+    void prepareNextSend();
+    void onPreparedAuthorized();
+    void onPreparedSessionInitialized();
+    void onPreparedWsConnection(bool connected, bool serverClosed);
+    void discardPreparedSend();
+    void advanceSendQueue();
+    void handOffSend();
 
-    QSettings m_settings;
+    QSettings m_settings;  // the application's: main() sets its names
     QString m_serverUrl;
     QString m_activeServer;
     QString m_userName;
@@ -213,6 +307,16 @@ private:
     QString m_proxyHost;
     quint16 m_proxyPort = 0;
     bool m_autoDropFreeze = false;
+    bool m_compression = false;
+    int m_compressionLevel = ChunkCodec::DEFAULT_LEVEL;
+    bool m_preferAes = false;
+    bool m_counterNonces = false;
+    bool m_rememberIdentity = true;
+    bool m_preAuthorize = false;
+    bool m_journalEnabled = true;
+    QString m_traceFile;
+    QString m_statsFile;
+    QString m_eventsFile;
 
     QString m_screen = "entry";
     QString m_screenBeforeSettings;
@@ -222,10 +326,29 @@ private:
     QString m_pendingSessionId;
 
     Authorization *m_auth = nullptr;
+    bool m_preAuthorizing = false;  // m_auth is speculative, see preAuthorize()
+    QElapsedTimer m_preAuthClock;
+    static constexpr int PRE_AUTH_MAX_AGE_SECS = 45;
     Session *m_session = nullptr;
     ServerWorkload *m_serverWorkload = nullptr;
+    IdentityCache m_identityCache;
+    TransferJournal m_journal;
+    bool m_journaled = false;                // the journal on disk is this transfer's
+    TransferJournal::Entry m_journalEntry;   // with the send progress, on disk up to m_journalStored
+    qint64 m_journalStored = 0;               // sentChunks as last stored
+    static constexpr int JOURNAL_LAG_CHUNKS = 16;
+    TransferJournal::Entry m_resumeEntry;    // rejoining it, until the first start_init
+    // A resumed send rehashes the chunks it sent before anything goes out;
+    // the next one to read, 0 when not checking
+    qint64 m_sentCheckNext = 0;
+    QByteArray m_sentCheckDigest;
+    static constexpr int SENT_CHECK_CHUNKS_PER_PASS = 4;
+    static constexpr int RESUME_TIMEOUT_SECS = 30;
+    ServerSelector *m_serverSelector = nullptr;
+    QStringList m_serverPool;     // more servers besides m_serverUrl, see ServerSelector
+    QList<QUrl> m_triedServers;   // full ones in this send attempt
 
-    QByteArray m_encryptionKey;
+    ChunkCrypto m_crypto;  // negotiated per session, see buildShareLink/startReceive
     QString m_shareLink;
     QString m_filePath;
     QString m_fileName;
@@ -236,32 +359,49 @@ private:
     int m_bufferUsed = 0;
     int m_bufferMax = 10;
 
-    QFile *m_uploadFile = nullptr;
-    bool m_waitingForChunkAccepted = false;
-    bool m_canSendChunk = true;
+    // Records the chunk in the journal; in counter mode on disk before it
+    // goes out, otherwise every JOURNAL_LAG_CHUNKS
+    void journalChunkSent(const SealedChunk &chunk);
+
+    // The next queued send, set up on its own identity while the current
+    // transfer drains (the server allows one session per identity)
+    struct PreparedSend
+    {
+        QString filePath;
+        Authorization *auth = nullptr;
+        Session *session = nullptr;
+        ChunkCrypto crypto;
+        QPointer<ChunkUpload> upload;  // presealing its first chunks
+        bool initialized = false;  // start_init received
+        QElapsedTimer age;
+    };
+
+    QQueue<QString> m_sendQueue;
+    PreparedSend m_prepared;
+    bool m_handingOff = false;  // the completing session goes to a SessionDrain
+    qint64 m_lastMaxChunkSize = DEFAULT_MAX_CHUNK_SIZE;  // from the last start_init
+    static constexpr qint64 DEFAULT_MAX_CHUNK_SIZE = 5 * 1024 * 1024;
+
+    QList<TarSource::Entry> m_archiveEntries;  // sending an archive instead of m_filePath
     qint64 m_maxChunkPayload = 0;
 
-    QFile *m_downloadTmpFile = nullptr;
-    QString m_downloadTmpPath;
-    QMap<qint64, QByteArray> m_chunkBuffer;   // out-of-order chunks waiting to be flushed
-    QSet<qint64> m_writtenChunks;             // all chunks written to disk or buffered
-    qint64 m_nextWriteIndex = 1;              // next sequential chunk to write to tmp file
-    QQueue<qint64> m_downloadQueue;
-    int m_activeDownloads = 0;
-    static constexpr int MAX_PARALLEL_DOWNLOADS = 4;
-    int m_chunksConfirmed = 0;
-    int m_highestKnownChunk = 0;
-    int m_pendingConfirms = 0;
+    // The transfer shown: its data side lives in the SessionManager, so a
+    // send handed to a SessionDrain carries on without this controller
+    QPointer<ChunkUpload> m_upload;
+    QPointer<ChunkDownload> m_download;
+    bool m_receivingArchive = false;
+    int m_highestKnownChunk = 0;              // sender's; a receiver's comes from m_download
     QMap<QString, int> m_receiverChunksDone;
     bool m_hasDownloadedFile = false;
 
-    void openDownloadTmpFile();
-    void flushChunksToDisk(qint64 index, const QByteArray &data);
-    void cleanupDownloadTmpFile();
-
     bool m_frozen = true;
-    int m_freezeRemaining = 0;
-    int m_sessionExpirationIn = 0;
+    bool m_sessionStarted = false;  // first start_init handled; later ones follow a WS reconnect
+    // The countdowns keep time here; the 1s timers only repaint, so they
+    // can stop while nobody looks (see updateCountdowns)
+    QDeadlineTimer m_freezeDeadline;
+    QDeadlineTimer m_expirationDeadline;
+    static int secondsLeft(const QDeadlineTimer &deadline) { return int((deadline.remainingTime() + 500) / 1000); }
+    bool m_background = false;  // window hidden or minimized
     QString m_senderName;
     bool m_senderOnline = false;
     QVariantList m_receivers;
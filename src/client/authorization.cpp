@@ -3,6 +3,7 @@
 // For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
 
 #include "authorization.h"
+#include "client/session/sessionmanager.h"
 
 #include <QDebug>
 #include <QNetworkRequest>
@@ -10,10 +11,6 @@
 #include <QJsonObject>
 #include <QJsonDocument>
 
-namespace {
-constexpr auto NETWORK_TIMEOUT_SECS = 10;
-}
-
 Authorization::Authorization(QObject *parent)
     : QObject{parent}
     , m_cookieJar(new QNetworkCookieJar)
@@ -56,6 +53,27 @@ bool Authorization::isAuthorized() const
     return m_authorized;
 }
 
+void Authorization::restore(const QString &id, const QList<QNetworkCookie> &cookies)
+{
+    QUrl url(m_url);
+    url.setPath("/api/");
+    m_cookieJar->setCookiesFromUrl(cookies, url);
+    m_clientId = id;
+    m_restoring = true;
+}
+
+bool Authorization::isRestored() const
+{
+    return m_restored;
+}
+
+QList<QNetworkCookie> Authorization::getCookies() const
+{
+    QUrl url(m_url);
+    url.setPath("/api/");
+    return m_cookieJar->cookiesForUrl(url);
+}
+
 void Authorization::connect()
 {
     if (m_url.isEmpty()) {
@@ -69,29 +87,36 @@ void Authorization::connect()
 
     emit connecting();
 
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
-    manager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
+    if (!m_restoring) {
+        requestIdentity();
+        return;
+    }
 
+    QUrl url(m_url);
+    url.setPath("/api/me/info");
+
+    auto *reply = SessionManager::instance().get(QNetworkRequest(url), m_cookieJar);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        processInfoReply(reply);
+        reply->deleteLater();
+    });
+}
+
+void Authorization::requestIdentity()
+{
     QUrl url(m_url);
     url.setPath("/api/identity/request");
     url.setQuery(QStringLiteral("name=%1").arg(m_clientName));
 
-    auto *reply = manager->get(QNetworkRequest(url));
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager, reply]() {
+    auto *reply = SessionManager::instance().get(QNetworkRequest(url), m_cookieJar);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         processReply(reply);
-        manager->deleteLater();
+        reply->deleteLater();
     });
 }
 
 void Authorization::confirmCaptcha(const QString &answer)
 {
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
-    manager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
-
     QUrl url(m_url);
     url.setPath("/api/identity/confirmation");
 
@@ -104,13 +129,40 @@ void Authorization::confirmCaptcha(const QString &answer)
     QNetworkRequest request(url);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
 
-    auto *reply = manager->post(request, QJsonDocument(body).toJson(QJsonDocument::Compact));
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager, reply]() {
+    auto *reply = SessionManager::instance().post(request, m_cookieJar,
+                                                  QJsonDocument(body).toJson(QJsonDocument::Compact));
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         processConfirmReply(reply);
-        manager->deleteLater();
+        reply->deleteLater();
     });
 }
 
+void Authorization::processInfoReply(QNetworkReply *reply)
+{
+    m_restoring = false;
+
+    const int code = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+    if (code == 0) {
+        emit error("Connection error");
+        return;
+    }
+
+    const auto json = QJsonDocument::fromJson(reply->readAll()).object();
+    if (code == 200 && json["id"].toString() == m_clientId) {
+        m_clientName = json["name"].toString();
+        m_restored = true;
+        m_authorized = true;
+        emit authorized();
+        return;
+    }
+
+    // Expired or dropped by the server: start over with a clean jar
+    qInfo() << "Cached identity rejected with" << code << "- requesting a new one";
+    m_clientId.clear();
+    m_cookieJar.reset(new QNetworkCookieJar);
+    requestIdentity();
+}
+
 void Authorization::processReply(QNetworkReply *reply)
 {
     if (!reply) {
@@ -131,7 +183,7 @@ void Authorization::processReply(QNetworkReply *reply)
     }
 
     if (code == 503) {
-        emit error("Server is full, try again later");
+        emit serverFull();
         return;
     }
 
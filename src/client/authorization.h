@@ -6,6 +6,7 @@
 
 #include <QObject>
 #include <QUrl>
+#include <QNetworkCookie>
 #include <QNetworkCookieJar>
 #include <QNetworkReply>
 #include <QNetworkAccessManager>
@@ -23,6 +24,12 @@ public:
     const QSharedPointer<QNetworkCookieJar> getCookieJar();
     bool isAuthorized() const;
 
+    // Reuse an identity from an earlier launch: connect() first checks it
+    // with /api/me/info and requests a new one only if the server rejects it
+    void restore(const QString &id, const QList<QNetworkCookie> &cookies);
+    bool isRestored() const;
+    QList<QNetworkCookie> getCookies() const;
+
 public slots:
     void connect();
     void confirmCaptcha(const QString &answer);
@@ -32,8 +39,12 @@ signals:
     void authorized();
     void captchaRequired(const QString &imageBase64, int answerLength);
     void error(const QString &reason);
+    // 503 on the identity request; the caller may try another server
+    void serverFull();
 
 private:
+    void requestIdentity();
+    void processInfoReply(QNetworkReply *reply);
     void processReply(QNetworkReply *reply);
     void processConfirmReply(QNetworkReply *reply);
 
@@ -41,6 +52,8 @@ private:
     QString m_clientName;
     QString m_clientId;
     bool m_authorized = false;
+    bool m_restoring = false;
+    bool m_restored = false;
 
     QString m_captchaToken;
     QString m_pendingClientId;
@@ -0,0 +1,103 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "identitycache.h"
+#include "crypto/crypto.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr auto KEY_SETTING = "identity/cache_key";
+constexpr auto FILE_NAME = "identity.bin";
+}
+
+IdentityCache::IdentityCache(QSettings &settings)
+    : m_settings(settings)
+    , m_path(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(FILE_NAME))
+{
+}
+
+IdentityCache::Entry IdentityCache::load(const QUrl &server) const
+{
+    const QJsonObject json = readAll().value(serverKey(server)).toObject();
+
+    Entry entry;
+    entry.id = json["id"].toString();
+    entry.name = json["name"].toString();
+    for (const QJsonValue &raw : json["cookies"].toArray()) {
+        entry.cookies += QNetworkCookie::parseCookies(raw.toString().toUtf8());
+    }
+    return entry;
+}
+
+void IdentityCache::store(const QUrl &server, const Entry &entry)
+{
+    QJsonArray cookies;
+    for (const QNetworkCookie &cookie : entry.cookies) {
+        cookies.append(QString::fromUtf8(cookie.toRawForm(QNetworkCookie::Full)));
+    }
+
+    QJsonObject entries = readAll();
+    entries[serverKey(server)] = QJsonObject{
+        {"id", entry.id},
+        {"name", entry.name},
+        {"cookies", cookies},
+    };
+    writeAll(entries);
+}
+
+void IdentityCache::remove(const QUrl &server)
+{
+    QJsonObject entries = readAll();
+    if (!entries.contains(serverKey(server))) return;
+    entries.remove(serverKey(server));
+    writeAll(entries);
+}
+
+QString IdentityCache::serverKey(const QUrl &server)
+{
+    return server.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment
+                           | QUrl::StripTrailingSlash).toString();
+}
+
+QJsonObject IdentityCache::readAll() const
+{
+    const QByteArray key = Crypto::base64UrlToKey(m_settings.value(KEY_SETTING).toString());
+    if (key.isEmpty()) return {};
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    const QByteArray plain = Crypto::decrypt(file.readAll(), key);
+    if (plain.isEmpty()) {
+        qWarning() << "IdentityCache: cannot open" << m_path << "- ignoring it";
+        return {};
+    }
+    return QJsonDocument::fromJson(plain).object();
+}
+
+void IdentityCache::writeAll(const QJsonObject &entries)
+{
+    QByteArray key = Crypto::base64UrlToKey(m_settings.value(KEY_SETTING).toString());
+    if (key.isEmpty()) {
+        key = Crypto::generateKey();
+        m_settings.setValue(KEY_SETTING, Crypto::keyToBase64Url(key));
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "IdentityCache: cannot write" << m_path;
+        return;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    file.write(Crypto::encrypt(QJsonDocument(entries).toJson(QJsonDocument::Compact), key));
+    if (!file.commit()) qWarning() << "IdentityCache: cannot write" << m_path;
+}
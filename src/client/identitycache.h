@@ -0,0 +1,43 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QNetworkCookie>
+#include <QSettings>
+#include <QString>
+#include <QUrl>
+
+// Identities (client ID, name and the server's cookie) kept across launches,
+// one per server, so a repeat start can skip /api/identity/request and its
+// captcha. The file is sealed with XChaCha20-Poly1305 under a random key
+// kept in QSettings: a copied cache file alone is useless, but anyone who
+// can read the user's settings can open it.
+class IdentityCache
+{
+public:
+    struct Entry
+    {
+        QString id;
+        QString name;
+        QList<QNetworkCookie> cookies;
+        bool isValid() const { return !id.isEmpty() && !cookies.isEmpty(); }
+    };
+
+    explicit IdentityCache(QSettings &settings);
+
+    Entry load(const QUrl &server) const;
+    void store(const QUrl &server, const Entry &entry);
+    void remove(const QUrl &server);
+
+private:
+    static QString serverKey(const QUrl &server);
+    QJsonObject readAll() const;
+    void writeAll(const QJsonObject &entries);
+
+    QSettings &m_settings;
+    QString m_path;
+};
@@ -0,0 +1,141 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "serverselector.h"
+#include "serverworkload.h"
+#include "client/session/sessionmanager.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+namespace {
+constexpr auto PROBE_INTERVAL_SECS = 30;
+constexpr auto NETWORK_TIMEOUT_SECS = 5;
+constexpr auto FULL_MARK_SECS = 30;
+// A fully loaded server scores like one this much further away
+constexpr double LOAD_PENALTY_MS = 500;
+constexpr double UNREACHABLE_MS = NETWORK_TIMEOUT_SECS * 1000;
+}
+
+ServerSelector::ServerSelector(QObject *parent)
+    : QObject{parent}
+    , m_timer(new QTimer(this))
+{
+    m_timer->setInterval(PROBE_INTERVAL_SECS * 1000);
+    QObject::connect(m_timer, &QTimer::timeout, this, &ServerSelector::probe);
+}
+
+void ServerSelector::setServers(const QList<QUrl> &servers)
+{
+    m_servers.clear();
+    for (const QUrl &url : servers) {
+        const QUrl server = url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment);
+        if (server.isValid() && !server.host().isEmpty() && !m_servers.contains(server)) m_servers << server;
+    }
+    m_measurements.clear();
+    m_fullMarks.clear();
+
+    m_lastProbe.invalidate();
+    if (m_servers.size() > 1 && !m_paused) {
+        m_timer->start();
+        probe();
+    } else {
+        m_timer->stop();
+    }
+}
+
+void ServerSelector::setPaused(bool paused)
+{
+    m_paused = paused;
+    if (paused || m_servers.size() < 2) {
+        m_timer->stop();
+        return;
+    }
+    m_timer->start();
+    if (!m_lastProbe.isValid() || m_lastProbe.elapsed() >= PROBE_INTERVAL_SECS * 1000) probe();
+}
+
+bool ServerSelector::contains(const QUrl &server) const
+{
+    return m_servers.contains(server);
+}
+
+QUrl ServerSelector::best(const QList<QUrl> &exclude) const
+{
+    QUrl winner;
+    double winnerScore = 0;
+    for (const QUrl &server : m_servers) {
+        if (exclude.contains(server)) continue;
+        const auto mark = m_fullMarks.constFind(server);
+        if (mark != m_fullMarks.cend() && !mark->hasExpired()) continue;
+
+        double score = 0;
+        const auto it = m_measurements.constFind(server);
+        if (it != m_measurements.cend()) {
+            if (it->full) continue;
+            score = (it->rttMs < 0 ? UNREACHABLE_MS : it->rttMs) + it->load * LOAD_PENALTY_MS;
+        } else if (!m_measurements.isEmpty()) {
+            // Probe still running: not better than a measured one
+            score = UNREACHABLE_MS;
+        }
+
+        if (winner.isEmpty() || score < winnerScore) {
+            winner = server;
+            winnerScore = score;
+        }
+    }
+    return winner;
+}
+
+void ServerSelector::markFull(const QUrl &server)
+{
+    m_fullMarks[server] = QDeadlineTimer(FULL_MARK_SECS * 1000);
+    emit updated();
+}
+
+void ServerSelector::clearFull(const QUrl &server)
+{
+    if (m_fullMarks.remove(server) > 0) emit updated();
+}
+
+void ServerSelector::probe()
+{
+    m_lastProbe.start();
+    for (const QUrl &server : std::as_const(m_servers)) {
+        QUrl url(server);
+        url.setPath("/api/statistics/current");
+        QNetworkRequest request(url);
+        request.setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
+
+        QElapsedTimer timer;
+        timer.start();
+        auto *reply = SessionManager::instance().get(request);
+        QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, server, timer]() {
+            reply->deleteLater();
+            if (!m_servers.contains(server)) return;  // list changed meanwhile
+
+            Measurement measurement;
+            const int code = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+            if (code == 200) {
+                const auto info = ServerWorkloadInfo::fromJson(QJsonDocument::fromJson(reply->readAll()).object());
+                measurement.rttMs = timer.elapsed();
+                const double users = info.maxUserCount > 0
+                    ? double(info.currentUserCount) / info.maxUserCount : 0;
+                const double sessions = info.maxSessionCount > 0
+                    ? double(info.currentSessionCount) / info.maxSessionCount : 0;
+                measurement.load = qMin(1.0, qMax(users, sessions));
+                measurement.full = users >= 1 || sessions >= 1;
+                // A fresh answer replaces the mark; a failed probe leaves it
+                m_fullMarks.remove(server);
+            } else {
+                qWarning() << "ServerSelector: probe of" << server << "failed with" << code;
+            }
+            m_measurements[server] = measurement;
+            emit updated();
+        });
+    }
+}
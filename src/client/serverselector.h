@@ -0,0 +1,63 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+
+// Picks the server for new sender sessions among the configured ones.
+// Every server is probed in parallel (/api/statistics/current) and scored
+// by its round trip plus a penalty for its load; full servers are skipped.
+// With a single server nothing is probed.
+class ServerSelector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ServerSelector(QObject *parent = nullptr);
+
+    // The first server is the preferred one: it wins ties and is used as
+    // long as nothing has been measured
+    void setServers(const QList<QUrl> &servers);
+    const QList<QUrl> &servers() const { return m_servers; }
+    bool contains(const QUrl &server) const;
+
+    // Lowest score among the servers not excluded; empty if none is left
+    QUrl best(const QList<QUrl> &exclude = {}) const;
+    // The server answered 503: skipped until a probe says otherwise, a
+    // request to it succeeds (clearFull) or FULL_MARK_SECS pass, so a
+    // single server, which is never probed, is not given up for good
+    void markFull(const QUrl &server);
+    void clearFull(const QUrl &server);
+
+    // No periodic probes while paused; resuming probes at once if the
+    // last results are older than the interval
+    void setPaused(bool paused);
+
+public slots:
+    void probe();
+
+signals:
+    void updated();
+
+private:
+    struct Measurement
+    {
+        qint64 rttMs = -1;  // -1: unreachable
+        double load = 0;    // 0..1, the higher of users and sessions
+        bool full = false;
+    };
+
+    QList<QUrl> m_servers;
+    QHash<QUrl, Measurement> m_measurements;
+    QHash<QUrl, QDeadlineTimer> m_fullMarks;  // from markFull()
+    QTimer *m_timer = nullptr;
+    QElapsedTimer m_lastProbe;
+    bool m_paused = false;
+};
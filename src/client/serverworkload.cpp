@@ -3,25 +3,54 @@
 // For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
 
 #include "serverworkload.h"
+#include "client/session/sessionmanager.h"
 
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QRandomGenerator>
 #include <QDebug>
 
+#include <algorithm>
+
 namespace
 {
 constexpr auto INTERVAL_SECS = 1;
+// Unchanged counters double the interval up to this
+constexpr auto MAX_STABLE_INTERVAL_SECS = 8;
+// Failures double it from INTERVAL_SECS up to this
+constexpr auto MAX_BACKOFF_SECS = 60;
+// Still often enough to keep the pooled connection from idling out
+constexpr auto BACKGROUND_INTERVAL_SECS = 30;
+// Every interval is spread by up to ±20%
+constexpr auto JITTER_PERCENT = 20;
 constexpr auto NETWORK_TIMEOUT_SECS = 5;
 }
 
+ServerWorkloadInfo ServerWorkloadInfo::fromJson(const QJsonObject &json)
+{
+    ServerWorkloadInfo info;
+    info.maxSessionCount = json["max_session_count"].toInt();
+    info.maxUserCount = json["max_user_count"].toInt();
+    info.currentSessionCount = json["current_session_count"].toInt();
+    info.currentUserCount = json["current_user_count"].toInt();
+    return info;
+}
+
+bool ServerWorkloadInfo::operator==(const ServerWorkloadInfo &other) const
+{
+    return maxSessionCount == other.maxSessionCount
+        && maxUserCount == other.maxUserCount
+        && currentSessionCount == other.currentSessionCount
+        && currentUserCount == other.currentUserCount;
+}
+
 ServerWorkload::ServerWorkload(QObject *parent)
     : QObject{parent}
-    , m_networkAccessManager(new QNetworkAccessManager(this))
     , m_timer(new QTimer(this))
+    , m_stableIntervalMs(INTERVAL_SECS*1000)
 {
-    m_networkAccessManager->setTransferTimeout(NETWORK_TIMEOUT_SECS*1000);
     m_timer->setInterval(INTERVAL_SECS*1000);
     m_timer->setSingleShot(true);
     QObject::connect(m_timer, &QTimer::timeout, this, &ServerWorkload::onTimeout);
@@ -30,18 +59,76 @@ ServerWorkload::ServerWorkload(QObject *parent)
 
 void ServerWorkload::onServerHostUpdated(const QUrl &url)
 {
-    m_url = url;
-    m_url.setPath("/api/statistics/current");
+    QUrl statistics(url);
+    statistics.setPath("/api/statistics/current");
+    if (statistics != m_url) {
+        // Another server: its counters and validator start over
+        m_etag.clear();
+        m_stableIntervalMs = INTERVAL_SECS*1000;
+        m_failures = 0;
+    }
+    m_url = statistics;
+    // Connect now rather than at the next poll
+    SessionManager::instance().warmUp(m_url);
+}
+
+void ServerWorkload::setBackground(bool background)
+{
+    m_background = background;
+    // While a request is out the timer is idle; its reply restarts it
+    if (!background && m_timer->isActive() && m_failures == 0) {
+        m_timer->stop();
+        onTimeout();
+    }
 }
 
 void ServerWorkload::onTimeout()
 {
-    if (m_url.isEmpty()) return;
+    if (m_url.isEmpty()) {
+        m_timer->start(INTERVAL_SECS*1000);
+        return;
+    }
 
+    // Through the shared pool: the poll keeps the connection to the server
+    // warm for the identity request and session create/join
     QNetworkRequest request(m_url);
-    auto reply = m_networkAccessManager->get(request);
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() { onRequestFinished(reply); });
-    QObject::connect(reply, &QNetworkReply::finished, m_timer, QOverload<>::of(&QTimer::start));
+    request.setTransferTimeout(NETWORK_TIMEOUT_SECS*1000);
+    if (!m_etag.isEmpty()) request.setRawHeader("If-None-Match", m_etag);
+    auto reply = SessionManager::instance().get(request);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        onRequestFinished(reply);
+        scheduleNext();
+    });
+}
+
+void ServerWorkload::scheduleNext()
+{
+    int interval = m_stableIntervalMs;
+    if (m_failures > 0) {
+        interval = std::min(INTERVAL_SECS*1000 << std::min(m_failures - 1, 16), MAX_BACKOFF_SECS*1000);
+    }
+    if (m_background) interval = std::max(interval, BACKGROUND_INTERVAL_SECS*1000);
+
+    const int jitter = interval * JITTER_PERCENT / 100;
+    m_timer->start(interval + QRandomGenerator::global()->bounded(-jitter, jitter + 1));
+}
+
+void ServerWorkload::applyInfo(const ServerWorkloadInfo &info)
+{
+    // Stable counters slow the poll down, a change brings it back to normal
+    if (info == m_info) {
+        m_stableIntervalMs = std::min(m_stableIntervalMs * 2, MAX_STABLE_INTERVAL_SECS*1000);
+    } else {
+        m_stableIntervalMs = INTERVAL_SECS*1000;
+    }
+
+    // Emit on every successful reply, not only on counter change. The
+    // UI uses this signal to also flip its "connected" indicator back
+    // to true after a transient failure — suppressing it when counts
+    // happen to match the stale snapshot would leave "No connection"
+    // stuck on screen.
+    m_info = info;
+    emit updated(m_info);
 }
 
 void ServerWorkload::onRequestFinished(QNetworkReply *reply)
@@ -53,14 +140,23 @@ void ServerWorkload::onRequestFinished(QNetworkReply *reply)
 
     if (reply->error() != QNetworkReply::NoError) {
         reply->deleteLater();
+        ++m_failures;
         emit connectionFailed();
         return;
     }
 
     const auto code = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+    if (code == 304 && !m_etag.isEmpty()) {
+        // Nothing changed since the last full reply
+        m_failures = 0;
+        applyInfo(m_info);
+        reply->deleteLater();
+        return;
+    }
     if (code != 200) {
         qWarning() << "ServerWorkload::onRequestFinished code is" << code;
         reply->deleteLater();
+        ++m_failures;
         emit connectionFailed();
         return;
     }
@@ -69,23 +165,14 @@ void ServerWorkload::onRequestFinished(QNetworkReply *reply)
     if (json.isEmpty()) {
         qWarning() << "ServerWorkload::onRequestFinished JSON is empty (or invalid)";
         reply->deleteLater();
+        ++m_failures;
         emit connectionFailed();
         return;
     }
 
-    ServerWorkloadInfo info;
-    info.maxSessionCount = json["max_session_count"].toInt();
-    info.maxUserCount = json["max_user_count"].toInt();
-    info.currentSessionCount = json["current_session_count"].toInt();
-    info.currentUserCount = json["current_user_count"].toInt();
-
-    // Emit on every successful reply, not only on counter change. The
-    // UI uses this signal to also flip its "connected" indicator back
-    // to true after a transient failure — suppressing it when counts
-    // happen to match the stale snapshot would leave "No connection"
-    // stuck on screen.
-    m_info = info;
-    emit updated(m_info);
+    m_failures = 0;
+    m_etag = reply->rawHeader("ETag");
+    applyInfo(ServerWorkloadInfo::fromJson(json));
 
     reply->deleteLater();
 }
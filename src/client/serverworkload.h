@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <QJsonObject>
 #include <QObject>
 #include <QNetworkAccessManager>
 #include <QTimer>
@@ -14,10 +15,20 @@ struct ServerWorkloadInfo
     int maxUserCount = 0;
     int currentSessionCount = 0;
     int currentUserCount = 0;
+
+    // From the /api/statistics/current reply
+    static ServerWorkloadInfo fromJson(const QJsonObject &json);
+
+    bool operator==(const ServerWorkloadInfo &other) const;
+    bool operator!=(const ServerWorkloadInfo &other) const { return !(*this == other); }
 };
 
 Q_DECLARE_METATYPE(ServerWorkloadInfo)
 
+// Polls /api/statistics/current for the footer. The interval adapts: it
+// doubles up to MAX_STABLE_INTERVAL_SECS while the counters stay the same,
+// backs off exponentially on failure and carries jitter, so a crowd of
+// clients does not poll in lockstep. Replies are conditional (ETag).
 class ServerWorkload : public QObject
 {
     Q_OBJECT
@@ -26,6 +37,9 @@ public:
 
 public slots:
     void onServerHostUpdated(const QUrl& url);
+    // Polls every BACKGROUND_INTERVAL_SECS instead; back to normal with an
+    // immediate poll when it ends
+    void setBackground(bool background);
 
 signals:
     void updated(const ServerWorkloadInfo& info);
@@ -36,8 +50,14 @@ private slots:
     void onRequestFinished(QNetworkReply* reply);
 
 private:
-    QNetworkAccessManager* m_networkAccessManager;
+    void scheduleNext();
+    void applyInfo(const ServerWorkloadInfo& info);
+
     QTimer* m_timer;
     QUrl m_url;
     ServerWorkloadInfo m_info;
+    QByteArray m_etag;
+    int m_stableIntervalMs;
+    int m_failures = 0;
+    bool m_background = false;
 };
@@ -0,0 +1,470 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "chunkdownload.h"
+#include "actions.h"
+#include "session.h"
+#include "sessionmanager.h"
+#include "diagnostics/pipelinetrace.h"
+#include "transfer/tarextractor.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+// Fallback for moving a received entry across filesystems
+bool copyRecursively(const QString &from, const QString &to)
+{
+    const QFileInfo info(from);
+    if (!info.isDir()) return QFile::copy(from, to);
+    if (!QDir().mkpath(to)) return false;
+    const QStringList names = QDir(from).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+    for (const QString &name : names) {
+        if (!copyRecursively(QDir(from).filePath(name), QDir(to).filePath(name))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ChunkDownload::ChunkDownload(const ChunkCrypto &crypto)
+    : QObject(&SessionManager::instance())
+    , m_crypto(crypto)
+    , m_confirmSyncTimer(new QTimer(this))
+{
+    m_confirmSyncTimer->setSingleShot(true);
+    m_confirmSyncTimer->setInterval(CONFIRM_SYNC_MS);
+    QObject::connect(m_confirmSyncTimer, &QTimer::timeout, this, &ChunkDownload::confirmWrittenChunks);
+
+    // Another transfer freed a download slot
+    QObject::connect(&SessionManager::instance(), &SessionManager::budgetAvailable,
+                     this, &ChunkDownload::processQueue);
+}
+
+ChunkDownload::~ChunkDownload()
+{
+    close();
+}
+
+bool ChunkDownload::create(const QString &dir, bool archive, QString *error)
+{
+    const quint64 tag = QRandomGenerator::global()->generate64();
+
+    if (archive) {
+        // Unpacked into a staging folder as chunks arrive; saving moves the
+        // top-level entries out of it
+        m_tmpPath = QDir(dir).filePath(QStringLiteral("putinqa_%1.d").arg(tag, 0, 16));
+        m_extractor = new TarExtractor(m_tmpPath, this);
+        m_sink.setDevice(m_extractor);
+        if (!QDir().mkpath(m_tmpPath) || !m_extractor->open(QIODevice::WriteOnly)) {
+            qWarning() << "Cannot create staging folder:" << m_tmpPath;
+            if (error) *error = QStringLiteral("Cannot create temporary folder");
+            return false;
+        }
+        return true;
+    }
+
+    m_tmpPath = QDir(dir).filePath(QStringLiteral("putinqa_%1.tmp").arg(tag, 0, 16));
+    m_tmpFile = new QFile(m_tmpPath, this);
+    m_sink.setDevice(m_tmpFile);
+    if (!m_tmpFile->open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot create tmp file:" << m_tmpPath;
+        if (error) *error = QStringLiteral("Cannot create temporary file");
+        return false;
+    }
+    return true;
+}
+
+bool ChunkDownload::reopen(const QString &tmpPath, qint64 fileSize, qint64 chunkPayload, QString *error)
+{
+    m_tmpPath = tmpPath;
+    m_tmpFile = new QFile(m_tmpPath, this);
+    // ReadWrite would create an empty one in its place
+    if (!QFileInfo::exists(m_tmpPath)) {
+        if (error) *error = QStringLiteral("The partly received file is gone");
+        return false;
+    }
+    if (!m_tmpFile->open(QIODevice::ReadWrite)) {
+        if (error) *error = QStringLiteral("Cannot open the temporary file");
+        return false;
+    }
+
+    qint64 written = m_tmpFile->size() / chunkPayload;
+    if (fileSize > 0 && m_tmpFile->size() >= fileSize) {
+        written = (fileSize + chunkPayload - 1) / chunkPayload;
+        m_lastChunkIndex = written;
+    } else {
+        m_tmpFile->resize(written * chunkPayload);
+    }
+    m_tmpFile->seek(m_tmpFile->size());
+    m_sink.setDevice(m_tmpFile);
+    m_sink.skipTo(written + 1);
+    m_chunksConfirmed = written;
+    emit chunksConfirmedChanged();
+    setHighestKnownChunk(written);
+    return true;
+}
+
+void ChunkDownload::rewindTo(qint64 next, qint64 chunkPayload)
+{
+    if (!m_tmpFile || next >= m_sink.nextIndex()) return;
+    m_tmpFile->resize((next - 1) * chunkPayload);
+    m_tmpFile->seek(m_tmpFile->size());
+    m_sink.skipTo(next);
+    m_lastChunkIndex = 0;
+    m_chunksConfirmed = next - 1;
+    emit chunksConfirmedChanged();
+}
+
+void ChunkDownload::discard()
+{
+    ++m_cryptoEpoch;
+    m_queue.clear();
+    m_active.clear();
+    m_heldConfirms.clear();
+    m_confirmSyncTimer->stop();
+    close();
+    if (m_tmpPath.isEmpty()) return;
+    if (QFileInfo(m_tmpPath).isDir()) {
+        QDir(m_tmpPath).removeRecursively();
+    } else {
+        QFile::remove(m_tmpPath);
+    }
+    m_tmpPath.clear();
+}
+
+void ChunkDownload::close()
+{
+    m_sink.setDevice(nullptr);
+    if (m_tmpFile) {
+        m_tmpFile->close();
+        delete m_tmpFile;
+        m_tmpFile = nullptr;
+    }
+    if (m_extractor) {
+        m_extractor->close();
+        delete m_extractor;
+        m_extractor = nullptr;
+    }
+}
+
+void ChunkDownload::setSession(Session *session, const QString &clientId)
+{
+    if (m_session) {
+        QObject::disconnect(m_session, nullptr, this, nullptr);
+        QObject::disconnect(m_session->state(), nullptr, this, nullptr);
+    }
+    m_session = session;
+    m_clientId = clientId;
+    if (!m_session) return;
+
+    QObject::connect(m_session, &Session::chunkDataReceived, this, &ChunkDownload::onChunkData);
+    QObject::connect(m_session, &Session::chunkDownloadFailed, this, &ChunkDownload::onChunkFailed);
+
+    auto *state = m_session->state();
+    // The first start_init is the controller's to handle, see start()
+    QObject::connect(state, &SessionState::sessionInitialized, this, [this]() {
+        if (m_started) start();
+    });
+    QObject::connect(state, &SessionState::newChunkEvent, this, &ChunkDownload::onNewChunk);
+    QObject::connect(state, &SessionState::chunkDownloadFinishedEvent,
+                     this, &ChunkDownload::onChunkDownloadFinished);
+    QObject::connect(state, &SessionState::uploadFinishedEvent, this, [this]() {
+        m_uploadFinished = true;
+        checkDone();
+    });
+}
+
+void ChunkDownload::start()
+{
+    if (!m_session) return;
+    const auto &state = m_session->getState();
+    const auto &chunks = state.getChunks()->value;
+    // Small files: the sender may have finished before we joined
+    if (state.getUploadFinished()->value) m_uploadFinished = true;
+    const bool resumed = m_started || !m_sink.isEmpty();
+    m_started = true;
+
+    // Chunks announced while we were away. Ones already written, queued or
+    // being fetched are left alone: the chunk GETs do not use the WS.
+    int missing = 0;
+    chunks.forEach([this, &missing](const SessionStateStructures::Chunk &chunk) {
+        setHighestKnownChunk(chunk.index);
+        if (m_sink.contains(chunk.index) || m_active.contains(chunk.index)
+            || m_queue.contains(chunk.index)) return;
+        m_queue.enqueue(chunk.index);
+        ++missing;
+    });
+
+    // Confirms without an echo may have died with the connection. One for
+    // a chunk still in the buffer goes again; one for a chunk that is gone
+    // was received, since the server drops only chunks every receiver
+    // confirmed. The snapshot is taken as the answer in both cases: a lost
+    // echo must not keep the save button disabled.
+    int reconfirmed = 0;
+    for (const qint64 index : std::as_const(m_pendingConfirms)) {
+        if (!chunks.contains(index)) continue;
+        m_session->sendJsonMessage(Action::ConfirmChunk(index).json());
+        ++reconfirmed;
+    }
+    m_pendingConfirms.clear();
+    if (resumed) {
+        qInfo() << "Resuming download:" << missing << "chunk(s) to fetch," << reconfirmed << "confirm(s) resent";
+    }
+
+    processQueue();
+    checkDone();
+}
+
+void ChunkDownload::setHighestKnownChunk(qint64 index)
+{
+    if (index <= m_highestKnownChunk) return;
+    m_highestKnownChunk = index;
+    emit highestKnownChunkChanged();
+}
+
+void ChunkDownload::onNewChunk(qint64 index)
+{
+    setHighestKnownChunk(index);
+    m_queue.enqueue(index);
+    processQueue();
+}
+
+void ChunkDownload::processQueue()
+{
+    if (!m_started) return;
+    const int parallel = concurrency();
+    while (m_active.size() < parallel && !m_queue.isEmpty() && m_session) {
+        const qint64 index = m_queue.head();
+        if (m_sink.contains(index) || m_active.contains(index)) {
+            m_queue.dequeue();
+            continue;
+        }
+        // Refused by the process-wide budget: stays queued until budgetAvailable
+        if (!m_session->downloadChunkHttp(index)) break;
+
+        m_queue.dequeue();
+        m_active.insert(index);
+    }
+}
+
+int ChunkDownload::concurrency() const
+{
+    const qint64 rttMs = m_session ? m_session->rttMs() : -1;
+    if (rttMs < 0) return DEFAULT_PARALLEL_DOWNLOADS;
+    return static_cast<int>(qBound<qint64>(MIN_PARALLEL_DOWNLOADS,
+                                           MIN_PARALLEL_DOWNLOADS + rttMs / RTT_PER_EXTRA_DOWNLOAD_MS,
+                                           MAX_PARALLEL_DOWNLOADS));
+}
+
+void ChunkDownload::onChunkData(qint64 index, const QByteArray &data)
+{
+    // Opened on a crypto worker; the chunk counts as active until then
+    const quint64 epoch = m_cryptoEpoch;
+    const ChunkCrypto crypto = m_crypto;
+    const qint64 maxSize = m_session->getState().getLimits().maxChunkSize;
+    SessionManager::instance().runCrypto(this,
+        [crypto, data, index, maxSize]() { return crypto.open(data, index, maxSize); },
+        [this, epoch, index, wireBytes = data.size()](const OpenedChunk &opened) {
+            if (epoch == m_cryptoEpoch && m_session) onChunkOpened(index, opened, wireBytes);
+        });
+}
+
+void ChunkDownload::onChunkOpened(qint64 index, const OpenedChunk &opened, qint64 wireBytes)
+{
+    opened.recordTimes(m_session->stats());
+    if (opened.failedStage) {
+        onChunkUnreadable(index, opened.failedStage);
+        return;
+    }
+    if (opened.last) m_lastChunkIndex = index;
+
+    {
+        PipelineTrace::Span span(PipelineTrace::Stage::Write, index);
+        m_sink.accept(index, opened.plain);
+    }
+    if (m_extractor && m_extractor->hasFailed() && !m_extractFailureReported) {
+        m_extractFailureReported = true;
+        emit error("Cannot unpack: " + m_extractor->errorString());
+    }
+    m_session->stats().addPayload(opened.plain.size(), wireBytes);
+    m_active.remove(index);
+
+    if (m_holdConfirms && m_tmpFile) {
+        // A resume trusts the tmp file: confirm only what is on the disk
+        m_heldConfirms.insert(index);
+        const bool idle = m_active.isEmpty() && m_queue.isEmpty();
+        if (idle || m_heldConfirms.size() >= CONFIRM_SYNC_CHUNKS) {
+            confirmWrittenChunks();
+        } else if (!m_confirmSyncTimer->isActive()) {
+            m_confirmSyncTimer->start();
+        }
+    } else {
+        confirmChunk(index);
+    }
+    processQueue();
+}
+
+void ChunkDownload::confirmChunk(qint64 index)
+{
+    m_session->sendJsonMessage(Action::ConfirmChunk(index).json());
+    PipelineTrace::instant(PipelineTrace::Stage::Confirm, index);
+    m_chunksConfirmed++;
+    m_pendingConfirms.insert(index);
+    emit chunksConfirmedChanged();
+}
+
+void ChunkDownload::confirmWrittenChunks()
+{
+    if (!m_session) return;
+    // Out-of-order chunks wait in memory for the gap
+    QList<qint64> written;
+    for (const qint64 index : std::as_const(m_heldConfirms)) {
+        if (index < m_sink.nextIndex()) written << index;
+    }
+    if (written.isEmpty()) return;
+    m_confirmSyncTimer->stop();
+
+    // One sync covers every chunk written since the last one
+    if (!m_sink.sync()) {
+        qWarning() << "Cannot sync the tmp file:" << (m_tmpFile ? m_tmpFile->errorString() : QString());
+        emit error(QStringLiteral("Cannot write temporary file"));
+        return;
+    }
+    std::sort(written.begin(), written.end());
+    for (const qint64 index : std::as_const(written)) {
+        m_heldConfirms.remove(index);
+        confirmChunk(index);
+    }
+}
+
+void ChunkDownload::onChunkUnreadable(qint64 index, const char *stage)
+{
+    m_active.remove(index);
+    // Fetched again in case it was damaged on the way. A chunk that never
+    // opens would never be confirmed, and the sender's buffer would stall
+    // on it, so the transfer ends instead.
+    const int attempts = ++m_unreadable[index];
+    qWarning() << "Failed to" << stage << "chunk" << index << "- attempt" << attempts << "of" << MAX_CHUNK_ATTEMPTS;
+    if (attempts >= MAX_CHUNK_ATTEMPTS) {
+        m_finished = true;
+        emit finished(QStringLiteral("corrupt"));
+        return;
+    }
+    m_queue.enqueue(index);
+    processQueue();
+}
+
+void ChunkDownload::onChunkFailed(qint64 index, const QString &error)
+{
+    qWarning() << "Chunk" << index << "download failed:" << error;
+    m_active.remove(index);
+    // Re-enqueue for retry (unless 404 = removed)
+    if (!error.contains("404")) {
+        m_queue.enqueue(index);
+    }
+    processQueue();
+}
+
+void ChunkDownload::onChunkDownloadFinished(const QString &receiverId, qint64 index)
+{
+    // Server acknowledged our confirm_chunk
+    if (receiverId == m_clientId && m_pendingConfirms.remove(index)) checkDone();
+}
+
+bool ChunkDownload::missingLastChunk() const
+{
+    return m_crypto.nonceMode == Crypto::NonceMode::Counter && m_lastChunkIndex != m_highestKnownChunk;
+}
+
+bool ChunkDownload::archiveIncomplete() const
+{
+    return m_extractor && !m_extractor->isFinished();
+}
+
+void ChunkDownload::checkDone()
+{
+    if (m_finished || !m_uploadFinished || m_sink.isEmpty() || m_chunksConfirmed == 0
+        || m_chunksConfirmed < m_highestKnownChunk || !m_pendingConfirms.isEmpty()) return;
+
+    // All chunks downloaded, decrypted, confirmed, and acknowledged
+    m_finished = true;
+    if (missingLastChunk()) {
+        emit finished(QStringLiteral("truncated"));
+    } else if (archiveIncomplete()) {
+        emit finished(QStringLiteral("extract_failed"));
+    } else {
+        emit finished(QStringLiteral("ok"));
+    }
+}
+
+bool ChunkDownload::saveTo(const QString &path, QString *error)
+{
+    if (m_extractor) {
+        const QDir staging(m_tmpPath);
+        const QDir target(path);
+
+        // Refuse before moving anything; entries already moved by an earlier
+        // attempt are gone from staging and skipped
+        QStringList entries;
+        for (const QString &name : m_extractor->topLevelEntries()) {
+            if (!QFileInfo::exists(staging.filePath(name))) continue;
+            if (QFileInfo::exists(target.filePath(name))) {
+                if (error) *error = "Already exists: " + target.filePath(name);
+                return false;
+            }
+            entries << name;
+        }
+
+        for (const QString &name : std::as_const(entries)) {
+            const QString from = staging.filePath(name);
+            const QString to = target.filePath(name);
+            // Rename is instant on the same filesystem and works for folders too
+            if (QDir().rename(from, to)) continue;
+            if (!copyRecursively(from, to)) {
+                if (error) *error = "Cannot save to: " + to;
+                return false;
+            }
+            if (QFileInfo(from).isDir()) {
+                QDir(from).removeRecursively();
+            } else {
+                QFile::remove(from);
+            }
+        }
+        qInfo() << "Archive unpacked to" << path;
+
+        close();
+        staging.removeRecursively();
+        m_tmpPath.clear();
+        return true;
+    }
+
+    if (m_tmpFile) m_tmpFile->close();
+
+    // Try rename (instant if same filesystem), fall back to copy
+    if (QFile::rename(m_tmpPath, path)) {
+        qInfo() << "File moved to" << path;
+    } else if (QFile::copy(m_tmpPath, path)) {
+        // Cross-filesystem: copy + remove
+        QFile::remove(m_tmpPath);
+        qInfo() << "File copied to" << path;
+    } else {
+        if (error) *error = "Cannot save to: " + path;
+        // Reopen tmp file in case user retries with different path
+        if (m_tmpFile) m_tmpFile->open(QIODevice::Append);
+        return false;
+    }
+
+    // Tmp file moved/copied — clear reference without deleting
+    close();
+    m_tmpPath.clear();
+    return true;
+}
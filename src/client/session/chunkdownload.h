@@ -0,0 +1,129 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QMap>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+
+#include "transfer/chunkcrypto.h"
+#include "transfer/chunksink.h"
+
+class QFile;
+class QTimer;
+class Session;
+class TarExtractor;
+
+// The data side of one receive: fetches the chunks the server announces
+// over HTTP, opens them on the crypto workers, writes them in order to a
+// temporary file (or unpacks them, for archives) and confirms each one.
+// Like ChunkUpload it follows its session's events by itself and is owned
+// by the SessionManager. The data outlives the session, until saved or
+// discarded; deleting the object alone leaves it on the disk, where a
+// journaled receive picks it up after a restart.
+class ChunkDownload : public QObject
+{
+    Q_OBJECT
+public:
+    // Chunk GETs in flight, scaled with the WS round trip: a longer path
+    // needs more requests out to keep it busy. DEFAULT until the first pong.
+    static constexpr int MIN_PARALLEL_DOWNLOADS = 2;
+    static constexpr int DEFAULT_PARALLEL_DOWNLOADS = 4;
+    static constexpr int MAX_PARALLEL_DOWNLOADS = 8;
+    static constexpr int RTT_PER_EXTRA_DOWNLOAD_MS = 25;
+
+    explicit ChunkDownload(const ChunkCrypto &crypto);
+    ~ChunkDownload() override;
+
+    // A new temporary file in `dir`, or for archives a staging folder
+    bool create(const QString &dir, bool archive, QString *error);
+    // The temporary file of a journaled receive, after a restart. Chunks are
+    // written in order, so its length says how many of chunkPayload bytes
+    // made it; a torn last write is cut off and fetched again.
+    bool reopen(const QString &tmpPath, qint64 fileSize, qint64 chunkPayload, QString *error);
+    // Cuts the file back to before chunk `next`, which is fetched again
+    void rewindTo(qint64 next, qint64 chunkPayload);
+    // Removes what was received
+    void discard();
+
+    void setSession(Session *session, const QString &clientId);
+    // Journaled: a chunk is confirmed only once it is synced to the disk,
+    // since the server drops what every receiver confirmed
+    void setHoldConfirms(bool hold) { m_holdConfirms = hold; }
+    // From the session's start_init: fetches whatever of its buffer is not
+    // here yet and confirms again what may have been lost on the way.
+    // Reconnects call it again by themselves.
+    void start();
+
+    QString tmpPath() const { return m_tmpPath; }
+    bool isArchive() const { return m_extractor != nullptr; }
+    bool hasData() const { return !m_sink.isEmpty(); }
+    qint64 nextIndex() const { return m_sink.nextIndex(); }
+    int chunksConfirmed() const { return m_chunksConfirmed; }
+    int highestKnownChunk() const { return m_highestKnownChunk; }
+    // The server may call it done, yet the sender's last chunk never came
+    // (counter nonces mark it) or the archive did not unpack to its end
+    bool missingLastChunk() const;
+    bool archiveIncomplete() const;
+    // Moves the file, or an archive's entries into the folder `path`
+    bool saveTo(const QString &path, QString *error);
+
+signals:
+    void chunksConfirmedChanged();
+    void highestKnownChunkChanged();
+    void error(const QString &message);
+    // Everything fetched, written and confirmed: "ok", "truncated" or
+    // "extract_failed"; or "corrupt" for a chunk that would not open
+    void finished(const QString &status);
+
+private:
+    void processQueue();
+    int concurrency() const;
+    void onNewChunk(qint64 index);
+    void onChunkData(qint64 index, const QByteArray &data);
+    void onChunkOpened(qint64 index, const OpenedChunk &opened, qint64 wireBytes);
+    void onChunkUnreadable(qint64 index, const char *stage);
+    void onChunkFailed(qint64 index, const QString &error);
+    void onChunkDownloadFinished(const QString &receiverId, qint64 index);
+    void confirmChunk(qint64 index);
+    void confirmWrittenChunks();
+    void setHighestKnownChunk(qint64 index);
+    void checkDone();
+    void close();
+
+    static constexpr int MAX_CHUNK_ATTEMPTS = 3;
+    // The tmp file is synced once per batch of held confirms: at
+    // CONFIRM_SYNC_CHUNKS, after CONFIRM_SYNC_MS, or when nothing else is
+    // being fetched
+    static constexpr int CONFIRM_SYNC_CHUNKS = 8;
+    static constexpr int CONFIRM_SYNC_MS = 250;
+
+    QPointer<Session> m_session;
+    QString m_clientId;
+    ChunkCrypto m_crypto;
+    bool m_started = false;
+    bool m_uploadFinished = false;
+    bool m_finished = false;
+
+    QFile *m_tmpFile = nullptr;
+    TarExtractor *m_extractor = nullptr;      // instead of m_tmpFile for archives
+    QString m_tmpPath;                        // tmp file, or staging folder for archives
+    bool m_extractFailureReported = false;
+    ChunkSink m_sink;                         // reorders chunks into m_tmpFile or m_extractor
+    QQueue<qint64> m_queue;
+    QSet<qint64> m_active;
+    QMap<qint64, int> m_unreadable;           // failed to decrypt or decompress, by attempts
+    int m_chunksConfirmed = 0;
+    int m_highestKnownChunk = 0;
+    qint64 m_lastChunkIndex = 0;              // counter nonces: chunk sealed as the last one
+    QSet<qint64> m_pendingConfirms;           // confirm_chunk sent, chunk_download echo not seen yet
+    bool m_holdConfirms = false;
+    QSet<qint64> m_heldConfirms;              // decoded, confirmed once on the disk
+    QTimer *m_confirmSyncTimer = nullptr;
+    quint64 m_cryptoEpoch = 0;                // bumped to drop the results of jobs in flight
+};
@@ -0,0 +1,267 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "chunkupload.h"
+#include "actions.h"
+#include "session.h"
+#include "sessionmanager.h"
+#include "diagnostics/pipelinetrace.h"
+
+#include <QDebug>
+#include <QIODevice>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+
+// Workers finish out of order; the queue stays in index order
+void insertByIndex(QQueue<SealedChunk> &queue, const SealedChunk &chunk)
+{
+    const auto pos = std::find_if(queue.cbegin(), queue.cend(),
+                                  [&chunk](const SealedChunk &queued) { return queued.index > chunk.index; });
+    queue.insert(pos, chunk);
+}
+
+} // namespace
+
+ChunkUpload::ChunkUpload(QIODevice *file, const ChunkCrypto &crypto)
+    : QObject(&SessionManager::instance())
+    , m_file(file)
+    , m_crypto(crypto)
+{
+    m_file->setParent(this);
+    // Another transfer freed bandwidth
+    QObject::connect(&SessionManager::instance(), &SessionManager::budgetAvailable,
+                     this, &ChunkUpload::sendNext);
+}
+
+ChunkUpload::~ChunkUpload()
+{
+    closeFile();
+}
+
+void ChunkUpload::setSession(Session *session)
+{
+    if (m_session) {
+        QObject::disconnect(m_session, nullptr, this, nullptr);
+        QObject::disconnect(m_session->state(), nullptr, this, nullptr);
+    }
+    m_session = session;
+    if (!m_session) return;
+
+    auto *state = m_session->state();
+    // The first start_init is the controller's to handle, see start()
+    QObject::connect(state, &SessionState::sessionInitialized, this, [this]() {
+        if (m_started) resume();
+    });
+    QObject::connect(state, &SessionState::newChunkEvent, this, &ChunkUpload::onNewChunk);
+    QObject::connect(state, &SessionState::newChunkAllowedEvent, this, &ChunkUpload::onNewChunkAllowed);
+}
+
+void ChunkUpload::preseal(qint64 payload, int count)
+{
+    if (m_started || payload <= 0) return;
+    m_presealPayload = payload;
+    m_presealCount = count;
+    // A new session numbers chunks from 1
+    m_readIndex = 0;
+    QTimer::singleShot(0, this, &ChunkUpload::presealNext);
+}
+
+void ChunkUpload::presealNext()
+{
+    if (m_presealPayload <= 0 || !m_file || !m_file->isOpen() || m_file->atEnd()
+        || m_presealed.size() + m_sealing.size() >= m_presealCount) return;
+
+    // One read per event loop pass, so the network replies are not held
+    // up; the sealing runs on a worker
+    sealNext(m_presealPayload);
+    QTimer::singleShot(0, this, &ChunkUpload::presealNext);
+}
+
+bool ChunkUpload::start(qint64 payload)
+{
+    if (!m_file) return false;
+    if (m_presealPayload > 0 && m_presealPayload != payload) {
+        qInfo() << "Chunk payload changed to" << payload << "- resealing";
+        m_presealed.clear();
+        m_sealing.clear();
+        ++m_cryptoEpoch;
+        m_file->close();
+        m_readIndex = 0;
+    }
+    m_presealPayload = 0;
+    if (!m_file->isOpen() && !m_file->open(QIODevice::ReadOnly)) return false;
+
+    m_payload = payload;
+    m_started = true;
+    sendNext();
+    return true;
+}
+
+void ChunkUpload::startAt(qint64 payload, qint64 readIndex, const SealedChunk &resend)
+{
+    m_presealPayload = 0;
+    m_payload = payload;
+    m_readIndex = readIndex;
+    if (resend.index > 0) {
+        if (m_session) resend.recordTimes(m_session->stats());
+        m_presealed.enqueue(resend);
+    }
+    m_started = true;
+    resume();
+}
+
+void ChunkUpload::resume()
+{
+    if (!m_session || !m_file) return;
+
+    const auto &state = m_session->getState();
+    const qint64 serverLast = state.getLastUploadedChunk()->value;
+    qInfo() << "Resuming upload: server has chunks up to" << serverLast << "- we sent" << m_inFlight.index;
+
+    if (m_waitingForEcho) {
+        m_waitingForEcho = false;
+        if (serverLast >= m_inFlight.index) {
+            // Stored; only the new_chunk echo was lost
+            m_session->stats().addPayload(m_inFlight.payloadBytes, m_inFlight.data.size());
+        } else {
+            // Lost with the connection: the same sealed bytes go out again,
+            // ahead of a chunk sealed after it
+            m_presealed.prepend(m_inFlight);
+        }
+        m_inFlight = SealedChunk();
+    }
+
+    // A new_chunk_allowed may have been lost as well
+    m_canSend = state.getChunks()->value.size() < state.getLimits().maxChunkQueue;
+    if (!m_canSend) {
+        emit stalled();
+        return;
+    }
+    sendNext();
+}
+
+void ChunkUpload::cancel()
+{
+    m_started = false;
+    m_waitingForEcho = false;
+    m_canSend = false;
+    m_presealPayload = 0;
+    m_presealed.clear();
+    m_sealing.clear();
+    ++m_cryptoEpoch;
+    closeFile();
+}
+
+void ChunkUpload::sendNext()
+{
+    if (!m_started || !m_session || !m_file || !m_canSend || m_waitingForEcho) return;
+    // Over the bandwidth limit; budgetAvailable calls back in
+    if (!SessionManager::instance().bandwidthAvailable()) return;
+
+    // The head goes once no earlier chunk is still on a worker
+    if (!m_presealed.isEmpty() && (m_sealing.isEmpty() || m_presealed.head().index < m_sealing.first())) {
+        const SealedChunk chunk = m_presealed.dequeue();
+        emit sending(chunk);
+        m_session->sendBinaryMessage(chunk.data);
+        PipelineTrace::instant(PipelineTrace::Stage::WsSend, chunk.index);
+        m_inFlight = chunk;
+        m_waitingForEcho = true;
+        sealAhead();
+        return;
+    }
+    // Calls back in once sealed
+    if (!m_sealing.isEmpty()) return;
+
+    if (m_file->atEnd()) {
+        m_session->sendJsonMessage(Action::UploadFinished().json());
+        closeFile();
+        emit finished();
+        return;
+    }
+
+    // Server assigns indices sequentially, so the next one is known up front
+    sealAhead();
+}
+
+void ChunkUpload::sealNext(qint64 payload)
+{
+    // The file is read here, in order; the rest runs on a crypto worker
+    const qint64 index = ++m_readIndex;
+    QByteArray raw;
+    {
+        PipelineTrace::Span span(PipelineTrace::Stage::Read, index);
+        raw = m_file->read(payload);
+    }
+    const bool last = m_file->atEnd();
+    m_sealing.append(index);
+
+    const quint64 epoch = m_cryptoEpoch;
+    const ChunkCrypto crypto = m_crypto;
+    SessionManager::instance().runCrypto(this,
+        [crypto, raw, index, last]() { return crypto.seal(raw, index, last); },
+        [this, epoch](const SealedChunk &chunk) {
+            if (epoch != m_cryptoEpoch) return;
+            m_sealing.removeOne(chunk.index);
+            if (m_session) chunk.recordTimes(m_session->stats());
+            insertByIndex(m_presealed, chunk);
+            // Sealed before start(), the first chunks wait for it
+            sendNext();
+        });
+}
+
+void ChunkUpload::sealAhead()
+{
+    // The upload waits a round trip for each new_chunk echo. The next
+    // chunks are sealed meanwhile, each on its own worker, so one goes out
+    // the moment the echo arrives.
+    if (!m_started || !m_file || !m_file->isOpen()) return;
+    while (m_presealed.size() + m_sealing.size() < SEAL_AHEAD_CHUNKS && !m_file->atEnd()) {
+        sealNext(m_payload);
+    }
+}
+
+void ChunkUpload::onNewChunk(qint64 index, qint64 size)
+{
+    PipelineTrace::instant(PipelineTrace::Stage::NewChunkEcho, index);
+    if (!m_waitingForEcho || !m_session) return;
+    m_waitingForEcho = false;
+
+    if (m_crypto.nonceMode == Crypto::NonceMode::Counter && index != m_inFlight.index) {
+        // The nonce was derived from the expected index; receivers would
+        // fail to decrypt every chunk from here on
+        qWarning() << "Server stored chunk" << m_inFlight.index << "as" << index;
+        cancel();
+        emit failed(QStringLiteral("Server reordered chunks, cannot continue with counter nonces"));
+        return;
+    }
+    m_session->stats().addPayload(m_inFlight.payloadBytes, size);
+    m_inFlight = SealedChunk();
+
+    const auto &state = m_session->getState();
+    if (state.getChunks()->value.size() >= state.getLimits().maxChunkQueue) {
+        m_canSend = false;
+        emit stalled();
+    } else {
+        QTimer::singleShot(0, this, &ChunkUpload::sendNext);
+    }
+}
+
+void ChunkUpload::onNewChunkAllowed(bool status)
+{
+    if (status && !m_canSend && m_started) {
+        m_canSend = true;
+        QTimer::singleShot(0, this, &ChunkUpload::sendNext);
+    }
+}
+
+void ChunkUpload::closeFile()
+{
+    if (!m_file) return;
+    m_file->close();
+    delete m_file;
+    m_file = nullptr;
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+
+#include "transfer/chunkcrypto.h"
+
+class QIODevice;
+class Session;
+
+// The data side of one send: reads the file in order, seals the chunks on
+// the crypto workers and puts them on the session's WebSocket, each once
+// the server echoed the one before and while its buffer has room. It
+// follows its session's events by itself, reconnects included, so it runs
+// the same whether a controller shows it or not (see SessionDrain). Owned
+// by the SessionManager; whoever holds it deletes it.
+class ChunkUpload : public QObject
+{
+    Q_OBJECT
+public:
+    static constexpr int PRESEAL_CHUNKS = 4;
+
+    // Takes over `file` (a QFile or TarSource), open for reading
+    ChunkUpload(QIODevice *file, const ChunkCrypto &crypto);
+    ~ChunkUpload() override;
+
+    const ChunkCrypto &crypto() const { return m_crypto; }
+    // Until start() others may read from it, e.g. to check it against the
+    // journal; null once everything was read
+    QIODevice *file() const { return m_file; }
+    // The server's buffer is full: the slowest receiver sets the pace
+    bool isStalled() const { return m_started && !m_canSend; }
+
+    void setSession(Session *session);
+    // Reads and seals the first chunks at `payload` bytes while the session
+    // is being set up; start() checks them against the server's chunk size
+    void preseal(qint64 payload, int count = PRESEAL_CHUNKS);
+    // start_init arrived: chunks go out at `payload` bytes from here on,
+    // and ones presealed at another size are sealed again. False if the
+    // file cannot be opened again for that.
+    bool start(qint64 payload);
+    // Rejoined after a restart (see TransferJournal): chunks up to readIndex
+    // are on the server and the file is positioned after them. `resend`, if
+    // its index is set, goes out first.
+    void startAt(qint64 payload, qint64 readIndex, const SealedChunk &resend);
+    // Nothing more is read or sent; jobs still on a worker are dropped
+    void cancel();
+
+signals:
+    // Right before the chunk goes out, for the journal
+    void sending(const SealedChunk &chunk);
+    void stalled();
+    // The last chunk is stored and upload_finished sent
+    void finished();
+    void failed(const QString &reason);
+
+private:
+    void sendNext();
+    void sealNext(qint64 payload);
+    void sealAhead();
+    void presealNext();
+    // After a WebSocket reconnect, from the server's fresh snapshot
+    void resume();
+    void onNewChunk(qint64 index, qint64 size);
+    void onNewChunkAllowed(bool status);
+    void closeFile();
+
+    static constexpr int SEAL_AHEAD_CHUNKS = 2;
+
+    QPointer<Session> m_session;
+    QIODevice *m_file = nullptr;
+    ChunkCrypto m_crypto;
+    bool m_started = false;
+    qint64 m_payload = 0;
+    qint64 m_presealPayload = 0;       // presealed before start(), at this size
+    int m_presealCount = 0;
+    QQueue<SealedChunk> m_presealed;    // sealed, not sent yet, in index order
+    QList<qint64> m_sealing;            // on a crypto worker, in read order
+    qint64 m_readIndex = 0;             // last chunk read from m_file
+    quint64 m_cryptoEpoch = 0;          // bumped to drop the results of jobs in flight
+    SealedChunk m_inFlight;             // sent, new_chunk echo not seen yet; kept to resend
+    bool m_waitingForEcho = false;
+    bool m_canSend = true;
+};
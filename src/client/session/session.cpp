@@ -4,32 +4,39 @@
 
 #include "session.h"
 #include "actions.h"
+#include "sessionmanager.h"
+#include "diagnostics/pipelinetrace.h"
 
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <QDebug>
 #include <QTimer>
-
-namespace {
-constexpr auto NETWORK_TIMEOUT_SECS = 10;
-}
+#include <QElapsedTimer>
 
 Session::Session(const QUrl &url, const QSharedPointer<QNetworkCookieJar> cookieJar, QObject *parent)
     : QObject{parent}
     , m_url(url)
     , m_cookieJar(cookieJar)
     , m_state(new SessionState(this))
-    , m_downloadManager(new QNetworkAccessManager(this))
 {
-    m_downloadManager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
-    m_downloadManager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
+    SessionManager::instance().registerSession(this);
 
     QObject::connect(this, &Session::joined, this, &Session::onJoined);
     QObject::connect(m_state, &SessionState::updated, this, &Session::stateUpdated);
     QObject::connect(m_state, &SessionState::complete, this, &Session::onComplete);
 }
 
+Session::~Session()
+{
+    // The replies belong to the shared manager; drop them with the session
+    for (QNetworkReply *reply : std::as_const(m_downloads)) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    SessionManager::instance().unregisterSession(this);
+}
+
 void Session::join(const QString &id)
 {
     m_role = Role::receiver;
@@ -38,15 +45,10 @@ void Session::join(const QString &id)
     url.setPath("/api/session/join");
     url.setQuery(QStringLiteral("id=%1").arg(id));
 
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
-    manager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
-
-    auto *reply = manager->get(QNetworkRequest(url));
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager, reply]() {
+    auto *reply = SessionManager::instance().get(QNetworkRequest(url), m_cookieJar);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         processReply(reply);
-        manager->deleteLater();
+        reply->deleteLater();
     });
 }
 
@@ -57,11 +59,6 @@ void Session::create(bool autoDropFreeze)
     QUrl url(m_url);
     url.setPath("/api/session/create");
 
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
-    manager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
-
     QNetworkRequest request(url);
     QByteArray body;
     if (autoDropFreeze) {
@@ -69,15 +66,23 @@ void Session::create(bool autoDropFreeze)
         body = QJsonDocument(QJsonObject{{"auto_drop_freeze", true}}).toJson(QJsonDocument::Compact);
     }
 
-    auto *reply = manager->post(request, body);
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager, reply]() {
+    auto *reply = SessionManager::instance().post(request, m_cookieJar, body);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         processReply(reply);
-        manager->deleteLater();
+        reply->deleteLater();
     });
 }
 
+void Session::resume(const QString &id, bool sender)
+{
+    m_role = sender ? Role::sender : Role::receiver;
+    m_id = id;
+    emit joined();
+}
+
 void Session::sendJsonMessage(const QJsonObject &json)
 {
+    if (m_offline) return;
     if (!m_wsConnection) {
         qWarning() << "Session::sendJsonMessage: no WebSocket";
         return;
@@ -87,29 +92,50 @@ void Session::sendJsonMessage(const QJsonObject &json)
 
 void Session::sendBinaryMessage(const QByteArray &data)
 {
+    if (m_offline) return;
     if (!m_wsConnection) {
         qWarning() << "Session::sendBinaryMessage: no WebSocket";
         return;
     }
     m_wsConnection->sendBinary(data);
+    SessionManager::instance().consumeBandwidth(data.size());
+    m_stats.wsSendQueueBytes.record(m_wsConnection->pendingBytes());
 }
 
-void Session::downloadChunkHttp(qint64 index)
+bool Session::downloadChunkHttp(qint64 index)
 {
+    if (m_offline) return true;
+
+    SessionManager &manager = SessionManager::instance();
+    if (!manager.tryAcquireDownload(this)) return false;
+
     QUrl url(m_url);
     url.setPath("/api/session/chunk");
     url.setQuery(QStringLiteral("id=%1").arg(index));
 
-    auto *reply = m_downloadManager->get(QNetworkRequest(url));
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, index]() {
+    QElapsedTimer timer;
+    timer.start();
+    PipelineTrace::asyncBegin(PipelineTrace::Stage::Fetch, index);
+    auto *reply = manager.get(QNetworkRequest(url), m_cookieJar);
+    m_downloads.insert(reply);
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply, index, timer]() {
+        PipelineTrace::asyncEnd(PipelineTrace::Stage::Fetch, index);
+        m_downloads.remove(reply);
+        SessionManager &manager = SessionManager::instance();
+        manager.releaseDownload(this);
         const int code = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
         if (code == 200) {
-            emit chunkDataReceived(index, reply->readAll());
+            m_stats.chunkDownloadLatencyUs.record(timer.nsecsElapsed() / 1000);
+            const QByteArray data = reply->readAll();
+            manager.consumeBandwidth(data.size());
+            emit chunkDataReceived(index, data);
         } else {
+            m_stats.addFailedDownload();
             emit chunkDownloadFailed(index, QStringLiteral("HTTP %1").arg(code));
         }
         reply->deleteLater();
     });
+    return true;
 }
 
 void Session::forceQuit()
@@ -124,15 +150,10 @@ void Session::forceQuit()
     QUrl url(m_url);
     url.setPath("/api/me/leave");
 
-    auto *manager = new QNetworkAccessManager(this);
-    manager->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
-    manager->setCookieJar(m_cookieJar.data());
-    m_cookieJar->setParent(nullptr);
-
-    auto *reply = manager->post(QNetworkRequest(url), QByteArray());
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, manager, reply]() {
+    auto *reply = SessionManager::instance().post(QNetworkRequest(url), m_cookieJar, QByteArray());
+    QObject::connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         processReply(reply);
-        manager->deleteLater();
+        reply->deleteLater();
     });
 }
 
@@ -143,6 +164,16 @@ void Session::onJoined()
     QObject::connect(m_wsConnection, &WebSocketConnection::connected, this, &Session::onWsConnected);
     QObject::connect(m_wsConnection, &WebSocketConnection::disconnected, this, &Session::onWsDisconnected);
     QObject::connect(m_wsConnection, &WebSocketConnection::newTextMessage, this, &Session::onWsText);
+    QObject::connect(m_wsConnection, &WebSocketConnection::reconnecting, this, [this](int, int, int delayMs) {
+        m_stats.wsReconnectDelayMs.record(delayMs);
+    });
+    QObject::connect(m_wsConnection, &WebSocketConnection::reconnected, this, [this](int, qint64 outageMs) {
+        m_stats.wsOutageMs.record(outageMs);
+    });
+    QObject::connect(m_wsConnection, &WebSocketConnection::rttMeasured, this, [this](qint64 sampleMs, qint64 smoothedMs) {
+        m_stats.wsRttMs.record(sampleMs);
+        m_stats.setRttMs(smoothedMs);
+    });
 
     m_wsConnection->connect();
 }
@@ -159,6 +190,17 @@ void Session::onWsDisconnected(bool serverClosed)
 
 void Session::onWsText(const QString &string)
 {
+    if (!m_recordPath.isEmpty()) {
+        if (!m_recorder.isOpen()
+            && !m_recorder.open(m_recordPath, m_role == Role::sender ? "sender" : "receiver")) {
+            m_recordPath.clear();
+        }
+        m_recorder.record(string);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
     const auto obj = QJsonDocument::fromJson(string.toUtf8()).object();
 
     // Events carrying a top-level "id" require an explicit ACK before the
@@ -172,6 +214,7 @@ void Session::onWsText(const QString &string)
     }
 
     m_state->processEventJson(obj);
+    m_stats.eventProcessingUs.record(timer.nsecsElapsed() / 1000);
 }
 
 void Session::onComplete(const QString &status)
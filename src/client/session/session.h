@@ -10,30 +10,54 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkCookieJar>
+#include <QSet>
 
 #include "sessionstate.h"
 #include "websocketconnection.h"
+#include "diagnostics/eventrecorder.h"
+#include "diagnostics/transferstats.h"
 
 class Session : public QObject
 {
     Q_OBJECT
 public:
     explicit Session(const QUrl &url, const QSharedPointer<QNetworkCookieJar> cookieJar, QObject *parent = nullptr);
+    ~Session() override;
 
     void join(const QString &id);
     // If autoDropFreeze is true, the server drops the initial freeze on
     // the first confirmed chunk and treats "last receiver left" as a
     // successful completion. Sent as JSON body to POST /api/session/create.
     void create(bool autoDropFreeze = false);
+    // Back into a session this identity is still part of (after a restart,
+    // see TransferJournal): no create or join, straight to the WebSocket,
+    // whose start_init brings the state
+    void resume(const QString &id, bool sender);
     SessionState *state() { return m_state; }
     const SessionState &getState() const { return *m_state; }
     const QString &getId() const { return m_id; }
     QSharedPointer<QNetworkCookieJar> getCookieJar() const { return m_cookieJar; }
+    TransferStats &stats() { return m_stats; }
+    const TransferStats &stats() const { return m_stats; }
+    // Smoothed WebSocket ping round trip, -1 until the first pong
+    qint64 rttMs() const { return m_wsConnection ? m_wsConnection->rttMs() : -1; }
+
+    // Records every raw WebSocket event to `path` (see EventRecorder); the
+    // file is created on the first event, once the role is known.
+    void setEventRecording(const QString &path) { m_recordPath = path; }
+
+    // Offline sessions do no network I/O: messages and chunk downloads are
+    // dropped. Used with replayEvent() to feed recorded events through the
+    // same handlers without a server.
+    void setOffline(bool offline) { m_offline = offline; }
+    void replayEvent(const QString &message) { onWsText(message); }
 
 public slots:
     void sendJsonMessage(const QJsonObject &json);
     void sendBinaryMessage(const QByteArray &data);
-    void downloadChunkHttp(qint64 index);
+    // Returns false without starting when the SessionManager budget is used
+    // up; retry on SessionManager::budgetAvailable
+    bool downloadChunkHttp(qint64 index);
     void forceQuit();
 
 signals:
@@ -60,6 +84,10 @@ private:
     enum class Role { undefined, receiver, sender } m_role = Role::undefined;
     WebSocketConnection *m_wsConnection = nullptr;
     SessionState *m_state = nullptr;
-    QNetworkAccessManager *m_downloadManager = nullptr;
+    QSet<QNetworkReply *> m_downloads;  // in flight on the SessionManager pool
     bool m_forceQuit = false;
+    bool m_offline = false;
+    TransferStats m_stats;
+    QString m_recordPath;
+    EventRecorder m_recorder;
 };
@@ -0,0 +1,75 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "sessiondrain.h"
+#include "chunkupload.h"
+#include "session.h"
+#include "client/authorization.h"
+
+#include <QDebug>
+#include <QTimer>
+
+SessionDrain::SessionDrain(Session *session, Authorization *auth, ChunkUpload *upload, const QString &fileName,
+                           QDeadlineTimer freezeDeadline, QObject *parent)
+    : QObject{parent}
+    , m_session(session)
+    , m_upload(upload)
+    , m_fileName(fileName)
+    , m_freezeDeadline(freezeDeadline)
+{
+    m_session->setParent(this);
+    if (auth) auth->setParent(this);
+
+    QObject::connect(m_session, &Session::complete, this, &SessionDrain::finish);
+    // Once the upload is done, a dropped freeze is all the sender waits for
+    QObject::connect(m_session->state(), &SessionState::freezeDroppedEvent, this, [this]() {
+        if (m_session->getState().getUploadFinished()->value) finish("ok");
+    });
+    QObject::connect(m_session->state(), &SessionState::uploadFinishedEvent,
+                     this, &SessionDrain::onUploadFinished);
+    // A snapshot after a reconnect may bring both at once
+    QObject::connect(m_session->state(), &SessionState::sessionInitialized, this, [this]() {
+        if (m_session->getState().getUploadFinished()->value) onUploadFinished();
+    });
+    // Reconnects happen inside WebSocketConnection; a disconnect reaches
+    // the session only once it gives up or the server closed it
+    QObject::connect(m_session, &Session::webSocketConnection, this, [this](bool connected) {
+        if (!connected) finish("disconnected");
+    });
+    if (m_upload) {
+        // Nobody is left to tell: end it on the server, whose complete
+        // then ends the drain
+        QObject::connect(m_upload, &ChunkUpload::failed, this, [this](const QString &reason) {
+            qWarning().noquote() << "Send of" << m_fileName << "failed:" << reason;
+            m_session->forceQuit();
+        });
+    }
+
+    if (m_session->getState().getUploadFinished()->value) onUploadFinished();
+}
+
+void SessionDrain::onUploadFinished()
+{
+    if (!m_session->getState().getInitialFreeze()->value) {
+        finish("ok");
+        return;
+    }
+    if (m_timing) return;
+    m_timing = true;
+    const qint64 freezeMs = m_freezeDeadline.isForever()
+        ? m_session->getState().getLimits().maxInitialFreeze * 1000 : m_freezeDeadline.remainingTime();
+    QTimer::singleShot(freezeMs + GRACE_SECS * 1000, this, [this]() { finish("timeout"); });
+}
+
+void SessionDrain::finish(const QString &status)
+{
+    if (m_finished) return;
+    m_finished = true;
+    qInfo().noquote() << "Background send of" << m_fileName << "ended with" << status;
+    if (m_upload) {
+        m_upload->cancel();
+        m_upload->deleteLater();
+    }
+    deleteLater();
+}
@@ -0,0 +1,45 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QObject>
+#include <QString>
+
+class Authorization;
+class ChunkUpload;
+class Session;
+
+// Carries on with a send in the background, so the controller can move on
+// to the next file in its queue: its upload may still be paced by a slow
+// receiver, or be finished while the initial freeze keeps the link open.
+// The session stays connected (the server drops clients without a
+// WebSocket after 60s) and the ChunkUpload keeps feeding it until the
+// upload is done and the freeze drops, the session completes or the
+// connection is lost for good; then the drain deletes itself with all
+// three. If none of that is heard by the end of the freeze plus GRACE_SECS
+// after the upload finished, it gives up all the same.
+class SessionDrain : public QObject
+{
+    Q_OBJECT
+public:
+    // Takes over all three; none may stay connected to anyone else.
+    // freezeDeadline is when the server's timer drops the freeze.
+    SessionDrain(Session *session, Authorization *auth, ChunkUpload *upload, const QString &fileName,
+                 QDeadlineTimer freezeDeadline, QObject *parent = nullptr);
+
+private:
+    void onUploadFinished();
+    void finish(const QString &status);
+
+    static constexpr int GRACE_SECS = 30;
+
+    Session *m_session = nullptr;
+    ChunkUpload *m_upload = nullptr;
+    QString m_fileName;
+    QDeadlineTimer m_freezeDeadline;
+    bool m_timing = false;
+    bool m_finished = false;
+};
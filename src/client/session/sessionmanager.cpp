@@ -0,0 +1,216 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "sessionmanager.h"
+
+#include <QCoreApplication>
+#include <QNetworkCookie>
+#include <QNetworkRequest>
+#include <QPointer>
+#include <QSettings>
+
+#include <utility>
+
+namespace {
+constexpr auto NETWORK_TIMEOUT_SECS = 10;
+// Qt drops idle pooled connections after a couple of minutes
+constexpr auto WARM_UP_INTERVAL_SECS = 60;
+}
+
+SessionManager &SessionManager::instance()
+{
+    // Owned by the application so the network manager goes before it does
+    static QPointer<SessionManager> manager;
+    if (!manager) manager = new SessionManager(QCoreApplication::instance());
+    return *manager;
+}
+
+SessionManager::SessionManager(QObject *parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+    , m_cryptoPool(new QThreadPool(this))
+    , m_refillTimer(new QTimer(this))
+{
+    m_network->setTransferTimeout(NETWORK_TIMEOUT_SECS * 1000);
+    m_refillTimer->setSingleShot(true);
+    QObject::connect(m_refillTimer, &QTimer::timeout, this, [this]() {
+        refill();
+        if (m_tokens > 0) emit budgetAvailable();
+    });
+    m_refillClock.start();
+
+    // The limits are the process's, so they are read once here and not by
+    // each AppController
+    QSettings settings;
+    m_maxDownloads = qMax(0, settings.value("transfer/max_parallel_downloads", m_maxDownloads).toInt());
+    setBandwidthLimit(settings.value("transfer/bandwidth_limit", 0).toLongLong() * 1024);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 3, 0)
+    const bool loaded = QNetworkInformation::loadDefaultBackend();
+#else
+    const bool loaded = QNetworkInformation::load(QNetworkInformation::Feature::Reachability);
+#endif
+    if (loaded && QNetworkInformation::instance()) {
+        auto *info = QNetworkInformation::instance();
+        m_reachability = info->reachability();
+        QObject::connect(info, &QNetworkInformation::reachabilityChanged, this,
+                         [this](QNetworkInformation::Reachability reachability) {
+            const bool wasOnline = m_reachability == QNetworkInformation::Reachability::Online;
+            m_reachability = reachability;
+            if (!wasOnline && reachability == QNetworkInformation::Reachability::Online) {
+                emit connectivityRestored();
+            }
+        });
+    }
+}
+
+SessionManager::~SessionManager()
+{
+    // Jobs post their results here; none may run past this point
+    m_cryptoPool->clear();
+    m_cryptoPool->waitForDone();
+}
+
+void SessionManager::setMaxParallelDownloads(int count)
+{
+    m_maxDownloads = qMax(0, count);
+    emit budgetAvailable();
+}
+
+void SessionManager::setBandwidthLimit(qint64 bytesPerSecond)
+{
+    m_bandwidthLimit = qMax<qint64>(0, bytesPerSecond);
+    m_tokens = static_cast<double>(m_bandwidthLimit);
+    m_refillClock.restart();
+    emit budgetAvailable();
+}
+
+void SessionManager::warmUp(const QUrl &server)
+{
+    if (!server.isValid() || server.host().isEmpty()) return;
+
+    const bool secure = server.scheme() == "https";
+    const quint16 port = static_cast<quint16>(server.port(secure ? 443 : 80));
+    const QString key = QStringLiteral("%1://%2:%3").arg(server.scheme(), server.host()).arg(port);
+    auto it = m_warmedUp.find(key);
+    if (it != m_warmedUp.end() && it->elapsed() < WARM_UP_INTERVAL_SECS * 1000) return;
+    m_warmedUp[key].start();
+
+#if QT_CONFIG(ssl)
+    if (secure) {
+        m_network->connectToHostEncrypted(server.host(), port);
+        return;
+    }
+#endif
+    m_network->connectToHost(server.host(), port);
+}
+
+QNetworkReply *SessionManager::get(const QNetworkRequest &request,
+                                   const QSharedPointer<QNetworkCookieJar> &cookieJar)
+{
+    auto *reply = m_network->get(withCookies(request, cookieJar.data()));
+    storeCookies(reply, cookieJar);
+    return reply;
+}
+
+QNetworkReply *SessionManager::post(const QNetworkRequest &request,
+                                    const QSharedPointer<QNetworkCookieJar> &cookieJar, const QByteArray &body)
+{
+    auto *reply = m_network->post(withCookies(request, cookieJar.data()), body);
+    storeCookies(reply, cookieJar);
+    return reply;
+}
+
+QNetworkRequest SessionManager::withCookies(QNetworkRequest request, QNetworkCookieJar *cookieJar) const
+{
+    request.setAttribute(QNetworkRequest::CookieLoadControlAttribute, QNetworkRequest::Manual);
+    request.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Manual);
+    if (cookieJar) {
+        request.setHeader(QNetworkRequest::CookieHeader,
+                          QVariant::fromValue(cookieJar->cookiesForUrl(request.url())));
+    }
+    return request;
+}
+
+void SessionManager::storeCookies(QNetworkReply *reply, const QSharedPointer<QNetworkCookieJar> &cookieJar)
+{
+    if (!cookieJar) return;
+    // Connected first, so the jar is up to date in the caller's own handler
+    const QWeakPointer<QNetworkCookieJar> weakJar = cookieJar;
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, weakJar]() {
+        const auto cookies = reply->header(QNetworkRequest::SetCookieHeader).value<QList<QNetworkCookie>>();
+        if (const auto jar = weakJar.toStrongRef(); jar && !cookies.isEmpty()) {
+            jar->setCookiesFromUrl(cookies, reply->url());
+        }
+    });
+}
+
+bool SessionManager::tryAcquireDownload(const Session *session)
+{
+    auto it = m_inFlight.find(session);
+    if (it == m_inFlight.end()) return false;
+    if (!bandwidthAvailable()) return false;
+
+    if (m_maxDownloads > 0) {
+        if (m_totalInFlight >= m_maxDownloads) return false;
+        // Equal share among the sessions that are downloading, this one included
+        int downloading = it.value() > 0 ? 0 : 1;
+        for (const int count : std::as_const(m_inFlight)) {
+            if (count > 0) ++downloading;
+        }
+        const int share = qMax(1, (m_maxDownloads + downloading - 1) / downloading);
+        if (it.value() >= share) return false;
+    }
+
+    ++it.value();
+    ++m_totalInFlight;
+    return true;
+}
+
+void SessionManager::releaseDownload(const Session *session)
+{
+    auto it = m_inFlight.find(session);
+    if (it == m_inFlight.end() || it.value() == 0) return;
+    --it.value();
+    --m_totalInFlight;
+    emit budgetAvailable();
+}
+
+bool SessionManager::bandwidthAvailable()
+{
+    if (m_bandwidthLimit == 0) return true;
+    refill();
+    return m_tokens > 0;
+}
+
+void SessionManager::consumeBandwidth(qint64 bytes)
+{
+    if (m_bandwidthLimit == 0) return;
+    refill();
+    m_tokens -= static_cast<double>(bytes);
+    if (m_tokens <= 0 && !m_refillTimer->isActive()) {
+        // Wake the waiters once the debt is paid back
+        m_refillTimer->start(static_cast<int>(-m_tokens * 1000 / m_bandwidthLimit) + 1);
+    }
+}
+
+void SessionManager::refill()
+{
+    const double seconds = m_refillClock.nsecsElapsed() / 1e9;
+    m_refillClock.restart();
+    // At most one second of burst
+    m_tokens = qMin(static_cast<double>(m_bandwidthLimit), m_tokens + seconds * m_bandwidthLimit);
+}
+
+void SessionManager::registerSession(const Session *session)
+{
+    m_inFlight.insert(session, 0);
+}
+
+void SessionManager::unregisterSession(const Session *session)
+{
+    const int released = m_inFlight.take(session);
+    m_totalInFlight -= released;
+    if (released > 0) emit budgetAvailable();
+}
@@ -0,0 +1,118 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkCookieJar>
+#include <QNetworkInformation>
+#include <QNetworkReply>
+#include <QObject>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QTimer>
+
+class Session;
+
+// Process-wide coordinator for every live Session: one HTTP pool for all
+// requests to the server, one budget for parallel downloads and bandwidth,
+// and one set of worker threads for sealing and opening chunks. Transfers
+// running side by side (a send going on in the background while the next
+// one is shown, or several AppControllers in one process) share the link
+// and the cores fairly instead of each assuming it has all of them. The
+// transfers themselves, ChunkUpload and ChunkDownload, are its children,
+// so none depends on the controller that started it.
+class SessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    static SessionManager &instance();
+    ~SessionManager() override;
+
+    // Parallel chunk downloads across all sessions, 0 = unlimited. Each
+    // session gets an equal share of it, and always at least one.
+    void setMaxParallelDownloads(int count);
+    int maxParallelDownloads() const { return m_maxDownloads; }
+
+    // Chunk bytes per second across all sessions and both directions,
+    // 0 = unlimited. A chunk is never split: the budget may go negative by
+    // one chunk and later transfers wait until it is paid back.
+    void setBandwidthLimit(qint64 bytesPerSecond);
+    qint64 bandwidthLimit() const { return m_bandwidthLimit; }
+
+    int sessionCount() const { return m_inFlight.size(); }
+    int downloadsInFlight() const { return m_totalInFlight; }
+
+    // Opens a connection to the server in the shared pool (DNS, TCP and, for
+    // https, TLS) so the first real request skips the handshakes. Repeats
+    // within WARM_UP_INTERVAL_SECS are no-ops.
+    void warmUp(const QUrl &server);
+
+    // Requests through the shared manager, so keep-alive connections are
+    // reused by every session, the authorization and the workload poll.
+    // The shared manager keeps no cookies: they are read from the caller's
+    // jar and Set-Cookie goes back into it.
+    QNetworkReply *get(const QNetworkRequest &request,
+                       const QSharedPointer<QNetworkCookieJar> &cookieJar = {});
+    QNetworkReply *post(const QNetworkRequest &request, const QSharedPointer<QNetworkCookieJar> &cookieJar,
+                        const QByteArray &body);
+
+    bool tryAcquireDownload(const Session *session);
+    void releaseDownload(const Session *session);
+
+    bool bandwidthAvailable();
+    void consumeBandwidth(qint64 bytes);
+
+    // Runs job() on a crypto worker, then done(result) on this thread,
+    // unless context is gone by then. The job must only use what it
+    // captured by value: it runs while the GUI thread goes on.
+    template <typename Job, typename Done>
+    void runCrypto(QObject *context, Job job, Done done)
+    {
+        const QPointer<QObject> guard(context);
+        m_cryptoPool->start([this, guard, job, done]() {
+            const auto result = job();
+            QMetaObject::invokeMethod(this, [guard, done, result]() {
+                if (guard) done(result);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    // False only when the platform reports no network at all; without a
+    // QNetworkInformation backend the network is assumed to be there
+    bool isOnline() const { return m_reachability != QNetworkInformation::Reachability::Disconnected; }
+
+signals:
+    // A download slot or bandwidth was freed; sessions that were refused retry
+    void budgetAvailable();
+    // The platform reports the network back after it was gone; pending
+    // reconnects go now instead of waiting out their backoff
+    void connectivityRestored();
+
+private:
+    friend class Session;
+    explicit SessionManager(QObject *parent = nullptr);
+
+    void registerSession(const Session *session);
+    void unregisterSession(const Session *session);
+    void refill();
+    QNetworkRequest withCookies(QNetworkRequest request, QNetworkCookieJar *cookieJar) const;
+    void storeCookies(QNetworkReply *reply, const QSharedPointer<QNetworkCookieJar> &cookieJar);
+
+    QNetworkAccessManager *m_network = nullptr;
+    QThreadPool *m_cryptoPool = nullptr;
+    QNetworkInformation::Reachability m_reachability = QNetworkInformation::Reachability::Unknown;
+    QHash<QString, QElapsedTimer> m_warmedUp;  // by scheme://host:port
+    QHash<const Session *, int> m_inFlight;  // downloads per registered session
+    int m_totalInFlight = 0;
+    int m_maxDownloads = 8;
+
+    qint64 m_bandwidthLimit = 0;
+    double m_tokens = 0;                     // bytes that may go out now
+    QElapsedTimer m_refillClock;
+    QTimer *m_refillTimer = nullptr;
+};
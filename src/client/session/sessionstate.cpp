@@ -13,6 +13,138 @@ SessionStateStructures::UpdatableStructure::UpdatableStructure(QObject *parent)
 {
 }
 
+void SessionStateStructures::ChunkWindow::reset(qint64 capacity)
+{
+    qint64 size = 1;
+    while (size < capacity) size <<= 1;
+    m_slots.fill(Chunk(), size);
+    m_mask = size - 1;
+    m_first = 0;
+    m_last = 0;
+    m_count = 0;
+}
+
+void SessionStateStructures::ChunkWindow::clear()
+{
+    m_slots.fill(Chunk());
+    m_first = 0;
+    m_last = 0;
+    m_count = 0;
+}
+
+bool SessionStateStructures::ChunkWindow::insert(const Chunk &chunk)
+{
+    if (chunk.index <= 0) return false;
+    if (m_slots.isEmpty()) reset(1);
+
+    if (m_count == 0) {
+        m_first = chunk.index;
+        m_last = chunk.index;
+    } else {
+        const qint64 first = qMin(m_first, chunk.index);
+        const qint64 last = qMax(m_last, chunk.index);
+        if (last - first + 1 > m_slots.size()) grow(last - first + 1);
+        m_first = first;
+        m_last = last;
+    }
+
+    Chunk &slot = m_slots[chunk.index & m_mask];
+    const bool isNew = (slot.index != chunk.index);
+    slot = chunk;
+    if (isNew) ++m_count;
+    return isNew;
+}
+
+bool SessionStateStructures::ChunkWindow::remove(qint64 index)
+{
+    if (!contains(index)) return false;
+
+    m_slots[index & m_mask] = Chunk();
+    if (--m_count == 0) {
+        m_first = 0;
+        m_last = 0;
+        return true;
+    }
+
+    // Each index is stepped over at most once, so this stays amortized O(1)
+    if (index == m_first) {
+        while (m_slots[m_first & m_mask].index != m_first) ++m_first;
+    } else if (index == m_last) {
+        while (m_slots[m_last & m_mask].index != m_last) --m_last;
+    }
+    return true;
+}
+
+bool SessionStateStructures::ChunkWindow::contains(qint64 index) const
+{
+    if (m_count == 0 || index < m_first || index > m_last) return false;
+    return m_slots[index & m_mask].index == index;
+}
+
+void SessionStateStructures::ChunkWindow::grow(qint64 span)
+{
+    qint64 size = qMax<qint64>(m_slots.size(), 1);
+    while (size < span) size <<= 1;
+
+    QVector<Chunk> slots(size);
+    const qint64 mask = size - 1;
+    forEach([&slots, mask](const Chunk &chunk) { slots[chunk.index & mask] = chunk; });
+
+    m_slots.swap(slots);
+    m_mask = mask;
+}
+
+void SessionStateStructures::MemberTable::clear()
+{
+    m_rows.clear();
+    m_index.clear();
+}
+
+void SessionStateStructures::MemberTable::reserve(int size)
+{
+    m_rows.reserve(size);
+    m_index.reserve(size);
+}
+
+SessionStateStructures::Member *SessionStateStructures::MemberTable::find(const QString &id)
+{
+    const auto it = m_index.constFind(id);
+    return it == m_index.constEnd() ? nullptr : &m_rows[it.value()];
+}
+
+const SessionStateStructures::Member *SessionStateStructures::MemberTable::find(const QString &id) const
+{
+    const auto it = m_index.constFind(id);
+    return it == m_index.constEnd() ? nullptr : &m_rows[it.value()];
+}
+
+SessionStateStructures::Member &SessionStateStructures::MemberTable::insert(const QString &id)
+{
+    if (auto *existing = find(id)) return *existing;
+
+    m_rows.append(Member());
+    Member &member = m_rows.last();
+    member.id = id;
+    m_index.insert(member.id, m_rows.size() - 1);
+    return member;
+}
+
+bool SessionStateStructures::MemberTable::remove(const QString &id)
+{
+    const auto it = m_index.constFind(id);
+    if (it == m_index.constEnd()) return false;
+
+    const int row = it.value();
+    const int last = m_rows.size() - 1;
+    m_index.erase(it);
+    if (row != last) {
+        m_rows[row] = std::move(m_rows[last]);
+        m_index[m_rows[row].id] = row;
+    }
+    m_rows.removeLast();
+    return true;
+}
+
 SessionState::SessionState(QObject *parent)
     : QObject{parent}
     , m_lastUploadedChunk(new SessionStateStructures::OneValue<qint64>(this))
@@ -22,11 +154,11 @@ SessionState::SessionState(QObject *parent)
     , m_someChunksWasRemoved(new SessionStateStructures::OneValue<bool>(this))
     , m_uploadFinished(new SessionStateStructures::OneValue<bool>(this))
     , m_newChunkIsAllowed(new SessionStateStructures::OneValue<bool>(this))
-    , m_sender(new SessionStateStructures::Member(this))
+    , m_sender(new SessionStateStructures::OneValue<SessionStateStructures::Member>(this))
     , m_fileInfo(new SessionStateStructures::FileInfo(this))
     , m_transferCounter(new SessionStateStructures::TransferCounter(this))
-    , m_receivers(new SessionStateStructures::OneValue<QMap<QString, SessionStateStructures::Member*>>(this))
-    , m_chunks(new SessionStateStructures::OneValue<QMap<qint64, SessionStateStructures::Chunk>>(this))
+    , m_receivers(new SessionStateStructures::OneValue<SessionStateStructures::MemberTable>(this))
+    , m_chunks(new SessionStateStructures::OneValue<SessionStateStructures::ChunkWindow>(this))
 {
     m_newChunkIsAllowed->value = true;
 }
@@ -40,11 +172,11 @@ const SessionStateStructures::OneValue<bool> *SessionState::getInitialFreeze() c
 const SessionStateStructures::OneValue<bool> *SessionState::getSomeChunkWasRemoved() const { return m_someChunksWasRemoved; }
 const SessionStateStructures::OneValue<bool> *SessionState::getUploadFinished() const { return m_uploadFinished; }
 const SessionStateStructures::OneValue<bool> *SessionState::getNewChunkIsAllowed() const { return m_newChunkIsAllowed; }
-const SessionStateStructures::Member *SessionState::getSender() const { return m_sender; }
+const SessionStateStructures::OneValue<SessionStateStructures::Member> *SessionState::getSender() const { return m_sender; }
 const SessionStateStructures::FileInfo *SessionState::getFileInfo() const { return m_fileInfo; }
 const SessionStateStructures::TransferCounter *SessionState::getTransferCounter() const { return m_transferCounter; }
-const SessionStateStructures::OneValue<QMap<QString, SessionStateStructures::Member*>> *SessionState::getReceivers() const { return m_receivers; }
-const SessionStateStructures::OneValue<QMap<qint64, SessionStateStructures::Chunk>> *SessionState::getChunks() const { return m_chunks; }
+const SessionStateStructures::OneValue<SessionStateStructures::MemberTable> *SessionState::getReceivers() const { return m_receivers; }
+const SessionStateStructures::OneValue<SessionStateStructures::ChunkWindow> *SessionState::getChunks() const { return m_chunks; }
 
 QString SessionState::dump() const
 {
@@ -60,22 +192,22 @@ QString SessionState::dump() const
     string += QStringLiteral("Upload finished: %1\n").arg(m_uploadFinished->value ? "yes" : "no");
     string += QStringLiteral("New chunk allowed: %1\n").arg(m_newChunkIsAllowed->value ? "yes" : "no");
     string += QStringLiteral("Sender: id=%1 online=%2 name=%3\n")
-                  .arg(m_sender->id).arg(m_sender->isOnline).arg(m_sender->name);
+                  .arg(m_sender->value.id).arg(m_sender->value.isOnline).arg(m_sender->value.name);
     string += QStringLiteral("File: size=%1 name=%2\n").arg(m_fileInfo->size).arg(m_fileInfo->name);
     string += QStringLiteral("Transfer: from_sender=%1 to_receivers=%2\n")
                   .arg(m_transferCounter->fromSender).arg(m_transferCounter->toReceivers);
 
     string += QStringLiteral("Receivers (%1):\n").arg(m_receivers->value.size());
-    for (auto it = m_receivers->value.begin(); it != m_receivers->value.end(); ++it) {
+    for (const auto &member : m_receivers->value) {
         string += QStringLiteral("  id=%1 online=%2 chunk=%3 name=%4\n")
-                      .arg(it.value()->id).arg(it.value()->isOnline)
-                      .arg(it.value()->currentChunk.index).arg(it.value()->name);
+                      .arg(member.id).arg(member.isOnline)
+                      .arg(member.currentChunk.index).arg(member.name);
     }
 
     string += QStringLiteral("Chunks (%1):\n").arg(m_chunks->value.size());
-    for (auto it = m_chunks->value.begin(); it != m_chunks->value.end(); ++it) {
-        string += QStringLiteral("  index=%1 size=%2\n").arg(it.value().index).arg(it.value().size);
-    }
+    m_chunks->value.forEach([&string](const SessionStateStructures::Chunk &chunk) {
+        string += QStringLiteral("  index=%1 size=%2\n").arg(chunk.index).arg(chunk.size);
+    });
 
     return string;
 }
@@ -126,32 +258,34 @@ void SessionState::onStartInit(const QJsonObject &data)
 
     const auto members = data.value("members").toObject();
     const auto sender = members.value("sender").toObject();
-    m_sender->id = sender.value("id").toString();
-    m_sender->isOnline = sender.value("is_online").toBool();
-    m_sender->name = sender.value("name").toString();
+    m_sender->value.id = sender.value("id").toString();
+    m_sender->value.isOnline = sender.value("is_online").toBool();
+    m_sender->value.name = sender.value("name").toString();
 
+    // Rebuild from the snapshot, reusing id strings of members we already know
     const auto receiversArray = members.value("receivers").toArray();
-    qDeleteAll(m_receivers->value);
-    m_receivers->value.clear();
+    SessionStateStructures::MemberTable receivers;
+    receivers.reserve(receiversArray.size());
     for (const auto &node : receiversArray) {
         const auto obj = node.toObject();
-        auto *member = new SessionStateStructures::Member(this);
-        member->currentChunk.index = obj.value("current_chunk").toInteger();
-        member->id = obj.value("id").toString();
-        member->isOnline = obj.value("is_online").toBool();
-        member->name = obj.value("name").toString();
-        m_receivers->value.insert(member->id, member);
+        const auto id = obj.value("id").toString();
+        const auto *known = m_receivers->value.find(id);
+        auto &member = receivers.insert(known ? known->id : id);
+        member.currentChunk.index = obj.value("current_chunk").toInteger();
+        member.isOnline = obj.value("is_online").toBool();
+        member.name = obj.value("name").toString();
     }
+    m_receivers->value = std::move(receivers);
 
     const auto state = data.value("state").toObject();
     const auto chunks = state.value("chunks").toArray();
-    m_chunks->value.clear();
+    m_chunks->value.reset(qMax<qint64>(m_limits.maxChunkQueue, chunks.size()));
     for (const auto &node : chunks) {
         const auto obj = node.toObject();
         SessionStateStructures::Chunk chunk;
         chunk.index = obj.value("index").toInteger();
         chunk.size = obj.value("size").toInteger();
-        m_chunks->value.insert(chunk.index, chunk);
+        m_chunks->value.insert(chunk);
     }
 
     m_lastUploadedChunk->value = state.value("current_chunk").toInteger();
@@ -178,16 +312,16 @@ void SessionState::onOnline(const QJsonObject &data)
     const auto id = data.value("id").toString();
     const bool status = data.value("status").toBool();
 
-    if (m_sender->id == id) {
-        if (m_sender->isOnline != status) {
-            m_sender->isOnline = status;
+    if (m_sender->value.id == id) {
+        if (m_sender->value.isOnline != status) {
+            m_sender->value.isOnline = status;
             emit m_sender->updated();
         }
     } else {
-        auto it = m_receivers->value.find(id);
-        if (it != m_receivers->value.end() && it.value()->isOnline != status) {
-            it.value()->isOnline = status;
-            emit it.value()->updated();
+        auto *member = m_receivers->value.find(id);
+        if (member && member->isOnline != status) {
+            member->isOnline = status;
+            emit m_receivers->updated();
         }
     }
 
@@ -199,16 +333,16 @@ void SessionState::onNameChanged(const QJsonObject &data)
     const auto id = data.value("id").toString();
     const auto name = data.value("name").toString();
 
-    if (m_sender->id == id) {
-        if (m_sender->name != name) {
-            m_sender->name = name;
+    if (m_sender->value.id == id) {
+        if (m_sender->value.name != name) {
+            m_sender->value.name = name;
             emit m_sender->updated();
         }
     } else {
-        auto it = m_receivers->value.find(id);
-        if (it != m_receivers->value.end() && it.value()->name != name) {
-            it.value()->name = name;
-            emit it.value()->updated();
+        auto *member = m_receivers->value.find(id);
+        if (member && member->name != name) {
+            member->name = name;
+            emit m_receivers->updated();
         }
     }
 
@@ -217,22 +351,18 @@ void SessionState::onNameChanged(const QJsonObject &data)
 
 void SessionState::onNewReceiver(const QJsonObject &data)
 {
-    auto *member = new SessionStateStructures::Member(this);
-    member->isOnline = true;
-    member->name = data.value("name").toString();
-    member->id = data.value("id").toString();
-    m_receivers->value.insert(member->id, member);
+    auto &member = m_receivers->value.insert(data.value("id").toString());
+    member.isOnline = true;
+    member.name = data.value("name").toString();
+    emit m_receivers->updated();
 
-    emit newReceiverEvent(member->id, member->name);
+    emit newReceiverEvent(member.id, member.name);
 }
 
 void SessionState::onReceiverRemoved(const QJsonObject &data)
 {
     const auto id = data.value("id").toString();
-    auto it = m_receivers->value.find(id);
-    if (it != m_receivers->value.end()) {
-        delete it.value();
-        m_receivers->value.erase(it);
+    if (m_receivers->value.remove(id)) {
         emit m_receivers->updated();
     }
 
@@ -252,7 +382,7 @@ void SessionState::onNewChunk(const QJsonObject &data)
     SessionStateStructures::Chunk chunk;
     chunk.index = data.value("index").toInteger();
     chunk.size = data.value("size").toInteger();
-    m_chunks->value.insert(chunk.index, chunk);
+    m_chunks->value.insert(chunk);
     emit m_chunks->updated();
     emit newChunkEvent(chunk.index, chunk.size);
 }
@@ -263,11 +393,10 @@ void SessionState::onChunkDownload(const QJsonObject &data)
     const auto index = data.value("index").toInteger();
     const auto action = data.value("action").toString();
 
-    auto it = m_receivers->value.find(id);
-    if (it != m_receivers->value.end()) {
-        it.value()->currentChunk.index = index;
-        it.value()->currentChunk.inProgress = (action == "started");
-        emit it.value()->updated();
+    if (auto *member = m_receivers->value.find(id)) {
+        member->currentChunk.index = index;
+        member->currentChunk.inProgress = (action == "started");
+        emit m_receivers->updated();
     }
 
     if (action == "finished") {
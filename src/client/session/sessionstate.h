@@ -6,6 +6,8 @@
 
 #include <QObject>
 #include <QJsonObject>
+#include <QVector>
+#include <QHash>
 
 namespace SessionStateStructures {
 
@@ -19,9 +21,7 @@ signals:
     void updated();
 };
 
-struct Member : public UpdatableStructure {
-    Member(QObject *parent) : UpdatableStructure(parent) {}
-
+struct Member {
     QString name;
     QString id;
     bool isOnline = false;
@@ -31,6 +31,32 @@ struct Member : public UpdatableStructure {
     } currentChunk;
 };
 
+// Receivers stored by value in one contiguous array plus an id -> row index.
+// The id string is interned: the row and the index key share one QString
+// payload, and a member that reappears in a later start_init snapshot keeps
+// the existing one. Rows are unordered (removal swaps the last row in), so
+// the table is O(1) for lookup, insert and remove. There is no per-member
+// signal; whoever owns the table emits a single updated() for it.
+class MemberTable {
+public:
+    void clear();
+    void reserve(int size);
+
+    Member *find(const QString &id);
+    const Member *find(const QString &id) const;
+    Member &insert(const QString &id);  // returns the existing row if present
+    bool remove(const QString &id);
+
+    int size() const { return m_rows.size(); }
+    bool isEmpty() const { return m_rows.isEmpty(); }
+    QVector<Member>::const_iterator begin() const { return m_rows.cbegin(); }
+    QVector<Member>::const_iterator end() const { return m_rows.cend(); }
+
+private:
+    QVector<Member> m_rows;
+    QHash<QString, int> m_index;
+};
+
 struct FileInfo : public UpdatableStructure {
     FileInfo(QObject *parent) : UpdatableStructure(parent) {}
 
@@ -64,6 +90,47 @@ struct Chunk {
     qint64 size = 0;
 };
 
+// Server chunk buffer mirror. The server keeps at most maxChunkQueue chunks
+// with increasing indices, so chunks live in a power-of-two ring addressed by
+// index & mask: insert/remove/contains are O(1) and nothing is allocated per
+// chunk. A slot is free when its stored index differs from the index that
+// maps to it (indices start at 1, so a zeroed slot is always free). The ring
+// only grows if the span between the oldest and newest live chunk outgrows
+// it (a receiver holding back an old chunk while newer ones are removed).
+class ChunkWindow {
+public:
+    void reset(qint64 capacity);
+    void clear();
+
+    bool insert(const Chunk &chunk);
+    bool remove(qint64 index);
+    bool contains(qint64 index) const;
+
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    qint64 firstIndex() const { return m_first; }
+    qint64 lastIndex() const { return m_last; }
+
+    // Visits live chunks in ascending index order
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        if (m_count == 0) return;
+        for (qint64 i = m_first; i <= m_last; ++i) {
+            const Chunk &slot = m_slots[i & m_mask];
+            if (slot.index == i) fn(slot);
+        }
+    }
+
+private:
+    void grow(qint64 span);
+
+    QVector<Chunk> m_slots;
+    qint64 m_mask = -1;
+    qint64 m_first = 0;
+    qint64 m_last = 0;
+    int m_count = 0;
+};
+
 } // namespace SessionStateStructures
 
 class SessionState : public QObject
@@ -82,11 +149,11 @@ public:
     const SessionStateStructures::OneValue<bool> *getSomeChunkWasRemoved() const;
     const SessionStateStructures::OneValue<bool> *getUploadFinished() const;
     const SessionStateStructures::OneValue<bool> *getNewChunkIsAllowed() const;
-    const SessionStateStructures::Member *getSender() const;
+    const SessionStateStructures::OneValue<SessionStateStructures::Member> *getSender() const;
     const SessionStateStructures::FileInfo *getFileInfo() const;
     const SessionStateStructures::TransferCounter *getTransferCounter() const;
-    const SessionStateStructures::OneValue<QMap<QString, SessionStateStructures::Member*>> *getReceivers() const;
-    const SessionStateStructures::OneValue<QMap<qint64, SessionStateStructures::Chunk>> *getChunks() const;
+    const SessionStateStructures::OneValue<SessionStateStructures::MemberTable> *getReceivers() const;
+    const SessionStateStructures::OneValue<SessionStateStructures::ChunkWindow> *getChunks() const;
 
     QString dump() const;
 
@@ -140,9 +207,9 @@ private:
     SessionStateStructures::OneValue<bool> *m_someChunksWasRemoved;
     SessionStateStructures::OneValue<bool> *m_uploadFinished;
     SessionStateStructures::OneValue<bool> *m_newChunkIsAllowed;
-    SessionStateStructures::Member *m_sender;
+    SessionStateStructures::OneValue<SessionStateStructures::Member> *m_sender;
     SessionStateStructures::FileInfo *m_fileInfo;
     SessionStateStructures::TransferCounter *m_transferCounter;
-    SessionStateStructures::OneValue<QMap<QString, SessionStateStructures::Member*>> *m_receivers;
-    SessionStateStructures::OneValue<QMap<qint64, SessionStateStructures::Chunk>> *m_chunks;
+    SessionStateStructures::OneValue<SessionStateStructures::MemberTable> *m_receivers;
+    SessionStateStructures::OneValue<SessionStateStructures::ChunkWindow> *m_chunks;
 };
@@ -3,16 +3,45 @@
 // For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
 
 #include "websocketconnection.h"
+#include "sessionmanager.h"
 
 #include <QDebug>
 #include <QNetworkCookie>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QTimer>
+#include <QRandomGenerator>
+
+#include <algorithm>
 
 namespace {
 constexpr auto MAX_RECONNECTS = 30;
-constexpr auto RECONNECT_DELAY_MS = 2000;
+// Backoff ceiling doubles from this per attempt, capped at MAX; the actual
+// delay is drawn uniformly below the ceiling (full jitter), so clients
+// dropped together by a server restart do not come back together
+constexpr auto RECONNECT_BASE_DELAY_MS = 500;
+constexpr auto RECONNECT_MAX_DELAY_MS = 10000;
+// put-in-pipe drops a client a minute after its WebSocket is gone; there
+// is no session to come back to after that
+constexpr auto RECONNECT_WINDOW_MS = 60000;
+// TCP alone takes minutes to notice a half-open path (NAT dropped the
+// mapping, the peer vanished). Traffic in either direction defers the
+// deadline, so a large frame still being written is not mistaken for one.
+constexpr auto PING_INTERVAL_SECS = 10;
+constexpr auto PONG_TIMEOUT_SECS = 15;
+
+// What a message of payloadBytes costs on the socket, which is what
+// bytesWritten counts: QWebSocket splits it into frames of frameSize, and
+// every client frame carries a header and a 4-byte mask
+qint64 frameBytes(qint64 payloadBytes, qint64 frameSize)
+{
+    qint64 total = 0;
+    do {
+        const qint64 part = std::min(payloadBytes, frameSize);
+        total += part + 2 + 4 + (part > 0xFFFF ? 8 : part > 125 ? 2 : 0);
+        payloadBytes -= part;
+    } while (payloadBytes > 0);
+    return total;
+}
 }
 
 WebSocketConnection::WebSocketConnection(const QSharedPointer<QNetworkCookieJar> cookieJar, const QUrl& url, QObject *parent)
@@ -21,14 +50,35 @@ WebSocketConnection::WebSocketConnection(const QSharedPointer<QNetworkCookieJar>
     , m_url(url)
     , m_cookieJar(cookieJar)
     , m_reconnectTtl(MAX_RECONNECTS)
+    , m_reconnectTimer(new QTimer(this))
+    , m_pingTimer(new QTimer(this))
+    , m_pongTimer(new QTimer(this))
 {
     m_url.setPath("/api/ws");
     m_url.setScheme(m_url.scheme() == "https" ? "wss" : "ws");
 
+    m_reconnectTimer->setSingleShot(true);
+    QObject::connect(m_reconnectTimer, &QTimer::timeout, this, &WebSocketConnection::connect);
+    QObject::connect(&SessionManager::instance(), &SessionManager::connectivityRestored,
+                     this, &WebSocketConnection::reconnectNow);
+
+    m_pingTimer->setInterval(PING_INTERVAL_SECS * 1000);
+    QObject::connect(m_pingTimer, &QTimer::timeout, this, &WebSocketConnection::sendPing);
+    m_pongTimer->setSingleShot(true);
+    m_pongTimer->setInterval(PONG_TIMEOUT_SECS * 1000);
+    QObject::connect(m_pongTimer, &QTimer::timeout, this, &WebSocketConnection::onPongTimeout);
+    QObject::connect(m_ws, &QWebSocket::pong, this, [this](quint64 elapsedTime, const QByteArray &) {
+        onPong(elapsedTime);
+    });
+
     QObject::connect(m_ws, &QWebSocket::binaryMessageReceived, this, &WebSocketConnection::onBinaryMessageReceived);
     QObject::connect(m_ws, &QWebSocket::textMessageReceived, this, &WebSocketConnection::onTextMessageReceived);
     QObject::connect(m_ws, &QWebSocket::connected, this, &WebSocketConnection::onConnected);
     QObject::connect(m_ws, &QWebSocket::disconnected, this, &WebSocketConnection::onDisconnected);
+    QObject::connect(m_ws, &QWebSocket::bytesWritten, this, [this](qint64 bytes) {
+        m_pendingBytes = qMax<qint64>(0, m_pendingBytes - bytes);
+        if (m_pongTimer->isActive()) m_pongTimer->start();
+    });
 #if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
     QObject::connect(m_ws, &QWebSocket::errorOccurred, this, &WebSocketConnection::onWsError);
 #else
@@ -61,6 +111,7 @@ void WebSocketConnection::connect()
 void WebSocketConnection::sendBinary(const QByteArray &data)
 {
     const auto sent = m_ws->sendBinaryMessage(data);
+    m_pendingBytes += frameBytes(sent, m_ws->outgoingFrameSize());
     if (sent != data.size()) {
         qWarning() << "WebSocketConnection::sendBinary data size is" << data.size() << "but sent" << sent;
     }
@@ -69,6 +120,7 @@ void WebSocketConnection::sendBinary(const QByteArray &data)
 void WebSocketConnection::sendText(const QString &message)
 {
     const auto sent = m_ws->sendTextMessage(message);
+    if (sent > 0) m_pendingBytes += frameBytes(sent, m_ws->outgoingFrameSize());
     if (sent == 0) {
         qWarning() << "WebSocketConnection::sendText data was not sent";
     }
@@ -76,15 +128,35 @@ void WebSocketConnection::sendText(const QString &message)
 
 void WebSocketConnection::onConnected()
 {
-    if (m_reconnectTtl.attemptsLeft() != MAX_RECONNECTS) {
-        m_reconnectTtl.release();
+    m_pendingBytes = 0;
+    if (m_outage.isValid()) {
+        const int attempts = m_reconnectTtl.used();
+        const qint64 outageMs = m_outage.elapsed();
+        qInfo() << "WebSocket reconnected after" << outageMs << "ms," << attempts << "attempt(s)";
+        m_outage.invalidate();
+        emit reconnected(attempts, outageMs);
     }
+    m_reconnectTtl.release();
+    m_pingTimer->start();
 
     emit connected();
 }
 
 void WebSocketConnection::onDisconnected()
 {
+    m_pingTimer->stop();
+    m_pongTimer->stop();
+    // Already handled, a reconnect is pending
+    if (m_reconnectTimer->isActive()) return;
+
+    // Dead path: whatever close code the socket reports, it was not a close
+    if (m_livenessLost) {
+        m_livenessLost = false;
+        if (scheduleReconnect()) return;
+        emit disconnected(false);
+        return;
+    }
+
     auto closeCode = m_ws->closeCode();
 
     // Normal close (1000) or server-initiated close — don't reconnect
@@ -97,13 +169,7 @@ void WebSocketConnection::onDisconnected()
     }
 
     // Abnormal close — try reconnect if TTL allows
-    if (m_reconnectTtl.attemptsLeft() > 0) {
-        if (m_reconnectTtl.isAliveIfIncrement()) {
-            emit reconnecting(m_reconnectTtl.attemptsLeft());
-            QTimer::singleShot(RECONNECT_DELAY_MS, this, &WebSocketConnection::connect);
-            return;
-        }
-    }
+    if (scheduleReconnect()) return;
 
     emit disconnected(false);
 }
@@ -123,22 +189,89 @@ void WebSocketConnection::onWsError(QAbstractSocket::SocketError wsError)
     if (wsError == QAbstractSocket::ConnectionRefusedError ||
         wsError == QAbstractSocket::NetworkError ||
         wsError == QAbstractSocket::HostNotFoundError) {
-        if (m_reconnectTtl.isAliveIfIncrement()) {
-            emit reconnecting(m_reconnectTtl.attemptsLeft());
-            QTimer::singleShot(RECONNECT_DELAY_MS, this, &WebSocketConnection::connect);
-            return;
-        }
+        if (scheduleReconnect()) return;
     }
 
     emit error("WebSocket error: " + m_ws->errorString());
 }
 
+bool WebSocketConnection::scheduleReconnect()
+{
+    // A failed attempt can report both an error and a disconnect
+    if (m_reconnectTimer->isActive()) return true;
+
+    if (!m_outage.isValid()) m_outage.start();
+    const qint64 windowLeftMs = RECONNECT_WINDOW_MS - m_outage.elapsed();
+    if (windowLeftMs <= 0) {
+        qWarning() << "WebSocket: no connection for" << RECONNECT_WINDOW_MS / 1000 << "s, giving up";
+        return false;
+    }
+
+    // Known offline: no attempt is spent. connectivityRestored connects at
+    // once; otherwise one last try when the window closes.
+    if (!SessionManager::instance().isOnline()) {
+        qInfo() << "WebSocket: offline, waiting up to" << windowLeftMs << "ms for the network";
+        m_reconnectTimer->start(static_cast<int>(windowLeftMs));
+        return true;
+    }
+
+    if (m_reconnectTtl.attemptsLeft() <= 0 || !m_reconnectTtl.isAliveIfIncrement()) return false;
+
+    const int attempt = m_reconnectTtl.used();
+    const int ceiling = std::min(RECONNECT_BASE_DELAY_MS << std::min(attempt - 1, 16), RECONNECT_MAX_DELAY_MS);
+    const int delayMs = static_cast<int>(
+        std::min<qint64>(QRandomGenerator::global()->bounded(ceiling + 1), windowLeftMs));
+
+    qInfo() << "WebSocket reconnect attempt" << attempt << "in" << delayMs << "ms";
+    emit reconnecting(attempt, m_reconnectTtl.attemptsLeft(), delayMs);
+    m_reconnectTimer->start(delayMs);
+    return true;
+}
+
+void WebSocketConnection::reconnectNow()
+{
+    if (!m_reconnectTimer->isActive()) return;
+
+    qInfo() << "WebSocket: network is back, reconnecting now";
+    m_reconnectTimer->stop();
+    connect();
+}
+
+void WebSocketConnection::sendPing()
+{
+    // The previous one is still out; its deadline decides
+    if (m_pongTimer->isActive()) return;
+    m_ws->ping();
+    m_pendingBytes += frameBytes(0, m_ws->outgoingFrameSize());
+    m_pongTimer->start();
+}
+
+void WebSocketConnection::onPong(quint64 elapsedMs)
+{
+    m_pongTimer->stop();
+    const qint64 sample = static_cast<qint64>(elapsedMs);
+    // RFC 6298 smoothing: one sample moves the estimate by 1/8
+    m_rttMs = m_rttMs < 0 ? sample : (7 * m_rttMs + sample) / 8;
+    emit rttMeasured(sample, m_rttMs);
+}
+
+void WebSocketConnection::onPongTimeout()
+{
+    qWarning() << "WebSocket: no pong or traffic for" << PONG_TIMEOUT_SECS << "s, reconnecting";
+    m_livenessLost = true;
+    m_ws->abort();
+    // abort() normally reports the disconnect itself
+    if (m_livenessLost) onDisconnected();
+}
+
 void WebSocketConnection::onTextMessageReceived(const QString &string)
 {
+    if (m_pongTimer->isActive()) m_pongTimer->start();
     emit newTextMessage(string);
 }
 
 void WebSocketConnection::onBinaryMessageReceived(const QByteArray &data)
 {
+    if (m_pongTimer->isActive()) m_pongTimer->start();
     emit newBinaryMessage(data);
 }
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <QElapsedTimer>
 #include <QObject>
+#include <QTimer>
 #include <QWebSocket>
 #include <QNetworkCookieJar>
 
@@ -28,6 +30,7 @@ class WebSocketConnection : public QObject
         void release() {
             m_counter = 0;
         }
+        int used() const { return m_counter; }
 
     private:
         int m_counter = 0;
@@ -37,6 +40,13 @@ class WebSocketConnection : public QObject
 public:
     explicit WebSocketConnection(const QSharedPointer<QNetworkCookieJar> cookieJar, const QUrl &url, QObject *parent = nullptr);
 
+    // Bytes handed to the socket that it has not written out yet, in frame
+    // bytes as bytesWritten reports them. Pongs sent by QWebSocket itself
+    // are not counted and only wear the figure down to zero.
+    qint64 pendingBytes() const { return m_pendingBytes; }
+    // Smoothed ping round trip (as TCP's SRTT), -1 before the first pong
+    qint64 rttMs() const { return m_rttMs; }
+
 public slots:
     void connect();
     void sendText(const QString &message);
@@ -47,7 +57,13 @@ signals:
     void disconnected(bool serverClosed);
     void newTextMessage(const QString &message);
     void newBinaryMessage(const QByteArray &data);
-    void reconnecting(int attemptsLeft);
+    // Per attempt: its number in this outage, the attempts after it and
+    // the backoff it waits before connecting
+    void reconnecting(int attempt, int attemptsLeft, int delayMs);
+    // Back after an outage of outageMs that took the given attempts
+    void reconnected(int attempts, qint64 outageMs);
+    // One pong: the sample and the smoothed round trip after it
+    void rttMeasured(qint64 sampleMs, qint64 smoothedMs);
     void error(const QString &description);
 
 private slots:
@@ -58,8 +74,21 @@ private slots:
     void onBinaryMessageReceived(const QByteArray &data);
 
 private:
+    bool scheduleReconnect();
+    void reconnectNow();
+    void sendPing();
+    void onPong(quint64 elapsedMs);
+    void onPongTimeout();
+
     QWebSocket* m_ws;
     QUrl m_url;
     const QSharedPointer<QNetworkCookieJar> m_cookieJar;
     Ttl m_reconnectTtl;
+    QTimer* m_reconnectTimer;
+    QElapsedTimer m_outage;  // since the connection was lost, invalid while up
+    QTimer* m_pingTimer;
+    QTimer* m_pongTimer;     // runs while a ping is unanswered
+    qint64 m_rttMs = -1;
+    bool m_livenessLost = false;  // aborted by onPongTimeout, not closed
+    qint64 m_pendingBytes = 0;
 };
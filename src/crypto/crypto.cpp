@@ -5,11 +5,106 @@
 #include "crypto.h"
 #include <sodium.h>
 
+namespace {
+
+// libsodium's AEAD constructions share one signature, so a cipher is a
+// pair of function pointers plus its sizes
+struct Suite
+{
+    size_t nonceBytes;
+    size_t tagBytes;
+    int (*encrypt)(unsigned char *c, unsigned long long *clen,
+                   const unsigned char *m, unsigned long long mlen,
+                   const unsigned char *ad, unsigned long long adlen,
+                   const unsigned char *nsec, const unsigned char *npub, const unsigned char *k);
+    int (*decrypt)(unsigned char *m, unsigned long long *mlen, unsigned char *nsec,
+                   const unsigned char *c, unsigned long long clen,
+                   const unsigned char *ad, unsigned long long adlen,
+                   const unsigned char *npub, const unsigned char *k);
+};
+
+const Suite XCHACHA20_POLY1305 = {
+    crypto_aead_xchacha20poly1305_ietf_NPUBBYTES,
+    crypto_aead_xchacha20poly1305_ietf_ABYTES,
+    crypto_aead_xchacha20poly1305_ietf_encrypt,
+    crypto_aead_xchacha20poly1305_ietf_decrypt,
+};
+
+const Suite AES256_GCM = {
+    crypto_aead_aes256gcm_NPUBBYTES,
+    crypto_aead_aes256gcm_ABYTES,
+    crypto_aead_aes256gcm_encrypt,
+    crypto_aead_aes256gcm_decrypt,
+};
+
+static_assert(crypto_aead_aes256gcm_KEYBYTES == crypto_aead_xchacha20poly1305_ietf_KEYBYTES,
+              "one key size for every cipher");
+
+const Suite &suite(Crypto::Cipher cipher)
+{
+    return cipher == Crypto::Cipher::Aes256Gcm ? AES256_GCM : XCHACHA20_POLY1305;
+}
+
+constexpr size_t MAX_NONCE_BYTES = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+
+void counterNonce(qint64 index, unsigned char *nonce)
+{
+    sodium_memzero(nonce, MAX_NONCE_BYTES);
+    for (int i = 0; i < 8; ++i) nonce[i] = static_cast<unsigned char>(static_cast<quint64>(index) >> (8 * i));
+}
+
+bool usable(Crypto::Cipher cipher, const QByteArray &key)
+{
+    return Crypto::isAvailable(cipher) && key.size() == crypto_aead_xchacha20poly1305_ietf_KEYBYTES;
+}
+
+} // namespace
+
 bool Crypto::init()
 {
     return sodium_init() >= 0;
 }
 
+bool Crypto::isAvailable(Cipher cipher)
+{
+    return cipher != Cipher::Aes256Gcm || crypto_aead_aes256gcm_is_available() == 1;
+}
+
+QString Crypto::cipherName(Cipher cipher)
+{
+    return cipher == Cipher::Aes256Gcm ? QStringLiteral("aes256-gcm")
+                                       : QStringLiteral("xchacha20-poly1305");
+}
+
+Crypto::Cipher Crypto::cipherFromName(const QString &name, bool *ok)
+{
+    if (ok) *ok = true;
+    if (name == "xchacha20-poly1305") return Cipher::XChaCha20Poly1305;
+    if (name == "aes256-gcm") return Cipher::Aes256Gcm;
+    if (ok) *ok = false;
+    return Cipher::XChaCha20Poly1305;
+}
+
+QString Crypto::nonceModeName(NonceMode mode)
+{
+    return mode == NonceMode::Counter ? QStringLiteral("counter") : QStringLiteral("random");
+}
+
+Crypto::NonceMode Crypto::nonceModeFromName(const QString &name, bool *ok)
+{
+    if (ok) *ok = true;
+    if (name.isEmpty() || name == "random") return NonceMode::Random;
+    if (name == "counter") return NonceMode::Counter;
+    if (ok) *ok = false;
+    return NonceMode::Random;
+}
+
+int Crypto::overhead(Cipher cipher, NonceMode mode)
+{
+    const Suite &s = suite(cipher);
+    return static_cast<int>((mode == NonceMode::Random ? s.nonceBytes : 0) + s.tagBytes);
+}
+
 QByteArray Crypto::generateKey()
 {
     QByteArray key(crypto_aead_xchacha20poly1305_ietf_KEYBYTES, Qt::Uninitialized);
@@ -18,58 +113,112 @@ QByteArray Crypto::generateKey()
     return key;
 }
 
-QByteArray Crypto::encrypt(const QByteArray &plaintext, const QByteArray &key)
+QByteArray Crypto::encrypt(const QByteArray &plaintext, const QByteArray &key, Cipher cipher)
 {
-    constexpr int nonceLen = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    const Suite &s = suite(cipher);
+    if (!usable(cipher, key)) return {};
 
-    QByteArray nonce(nonceLen, Qt::Uninitialized);
-    randombytes_buf(reinterpret_cast<unsigned char *>(nonce.data()), nonceLen);
+    // Nonce and ciphertext go straight into the result, no intermediate copies
+    QByteArray result(static_cast<qsizetype>(s.nonceBytes + plaintext.size() + s.tagBytes),
+                      Qt::Uninitialized);
+    auto *nonce = reinterpret_cast<unsigned char *>(result.data());
+    randombytes_buf(nonce, s.nonceBytes);
 
-    QByteArray ciphertext(plaintext.size() + crypto_aead_xchacha20poly1305_ietf_ABYTES,
-                          Qt::Uninitialized);
     unsigned long long ciphertextLen = 0;
-
-    crypto_aead_xchacha20poly1305_ietf_encrypt(
-        reinterpret_cast<unsigned char *>(ciphertext.data()),
+    s.encrypt(
+        nonce + s.nonceBytes,
         &ciphertextLen,
         reinterpret_cast<const unsigned char *>(plaintext.constData()),
         plaintext.size(),
         nullptr, 0,
         nullptr,
-        reinterpret_cast<const unsigned char *>(nonce.constData()),
+        nonce,
         reinterpret_cast<const unsigned char *>(key.constData()));
 
-    ciphertext.resize(static_cast<qsizetype>(ciphertextLen));
-
-    QByteArray result;
-    result.reserve(nonceLen + ciphertext.size());
-    result.append(nonce);
-    result.append(ciphertext);
+    result.resize(static_cast<qsizetype>(s.nonceBytes + ciphertextLen));
     return result;
 }
 
-QByteArray Crypto::decrypt(const QByteArray &data, const QByteArray &key)
+QByteArray Crypto::decrypt(const QByteArray &data, const QByteArray &key, Cipher cipher)
 {
-    constexpr int nonceLen = crypto_aead_xchacha20poly1305_ietf_NPUBBYTES;
+    const Suite &s = suite(cipher);
+    if (!usable(cipher, key)) return {};
 
-    if (data.size() <= nonceLen) {
+    if (data.size() < static_cast<qsizetype>(s.nonceBytes + s.tagBytes)) {
         return {};
     }
 
-    const QByteArray nonce = data.left(nonceLen);
-    const QByteArray ciphertext = data.mid(nonceLen);
+    const auto *nonce = reinterpret_cast<const unsigned char *>(data.constData());
+    const unsigned long long ciphertextLen = data.size() - s.nonceBytes;
 
-    QByteArray plaintext(ciphertext.size(), Qt::Uninitialized);
+    QByteArray plaintext(static_cast<qsizetype>(ciphertextLen - s.tagBytes), Qt::Uninitialized);
     unsigned long long plaintextLen = 0;
 
-    const int ret = crypto_aead_xchacha20poly1305_ietf_decrypt(
+    const int ret = s.decrypt(
         reinterpret_cast<unsigned char *>(plaintext.data()),
         &plaintextLen,
         nullptr,
-        reinterpret_cast<const unsigned char *>(ciphertext.constData()),
-        ciphertext.size(),
+        nonce + s.nonceBytes,
+        ciphertextLen,
         nullptr, 0,
-        reinterpret_cast<const unsigned char *>(nonce.constData()),
+        nonce,
+        reinterpret_cast<const unsigned char *>(key.constData()));
+
+    if (ret != 0) {
+        return {};
+    }
+
+    plaintext.resize(static_cast<qsizetype>(plaintextLen));
+    return plaintext;
+}
+
+QByteArray Crypto::encryptChunk(const QByteArray &plaintext, const QByteArray &key, Cipher cipher,
+                                qint64 index, bool last)
+{
+    const Suite &s = suite(cipher);
+    if (!usable(cipher, key)) return {};
+
+    unsigned char nonce[MAX_NONCE_BYTES];
+    counterNonce(index, nonce);
+    const unsigned char ad = last ? 1 : 0;
+
+    QByteArray result(static_cast<qsizetype>(plaintext.size() + s.tagBytes), Qt::Uninitialized);
+    unsigned long long ciphertextLen = 0;
+    s.encrypt(
+        reinterpret_cast<unsigned char *>(result.data()),
+        &ciphertextLen,
+        reinterpret_cast<const unsigned char *>(plaintext.constData()),
+        plaintext.size(),
+        &ad, 1,
+        nullptr,
+        nonce,
+        reinterpret_cast<const unsigned char *>(key.constData()));
+
+    result.resize(static_cast<qsizetype>(ciphertextLen));
+    return result;
+}
+
+QByteArray Crypto::decryptChunk(const QByteArray &data, const QByteArray &key, Cipher cipher,
+                                qint64 index, bool last)
+{
+    const Suite &s = suite(cipher);
+    if (!usable(cipher, key) || data.size() < static_cast<qsizetype>(s.tagBytes)) return {};
+
+    unsigned char nonce[MAX_NONCE_BYTES];
+    counterNonce(index, nonce);
+    const unsigned char ad = last ? 1 : 0;
+
+    QByteArray plaintext(static_cast<qsizetype>(data.size() - s.tagBytes), Qt::Uninitialized);
+    unsigned long long plaintextLen = 0;
+
+    const int ret = s.decrypt(
+        reinterpret_cast<unsigned char *>(plaintext.data()),
+        &plaintextLen,
+        nullptr,
+        reinterpret_cast<const unsigned char *>(data.constData()),
+        data.size(),
+        &ad, 1,
+        nonce,
         reinterpret_cast<const unsigned char *>(key.constData()));
 
     if (ret != 0) {
@@ -9,10 +9,49 @@
 
 namespace Crypto {
 
+// AEAD used for chunks, advertised as the share link's encryption=
+// parameter. Both take a 32-byte key; the wire format of a chunk is
+// [nonce][ciphertext][tag] with the sizes of the cipher.
+enum class Cipher {
+    XChaCha20Poly1305,  // "xchacha20-poly1305", 24-byte random nonce, always available
+    Aes256Gcm,          // "aes256-gcm", 12-byte random nonce, needs AES-NI/ARMv8 crypto
+};
+
+// How chunk nonces are produced, advertised as the share link's nonce=
+// parameter (absent = Random)
+enum class NonceMode {
+    Random,   // random per chunk, sent in front of the ciphertext
+    Counter,  // derived from the chunk index, not sent; last chunk is marked
+};
+
 bool init();
+
+// Aes256Gcm is only usable after init() and on CPUs with AES instructions;
+// libsodium has no software fallback for it
+bool isAvailable(Cipher cipher);
+QString cipherName(Cipher cipher);
+Cipher cipherFromName(const QString &name, bool *ok = nullptr);
+QString nonceModeName(NonceMode mode);
+NonceMode nonceModeFromName(const QString &name, bool *ok = nullptr);
+// Nonce (Random mode only) + tag bytes added to every chunk
+int overhead(Cipher cipher, NonceMode mode = NonceMode::Random);
+
 QByteArray generateKey();
-QByteArray encrypt(const QByteArray &plaintext, const QByteArray &key);
-QByteArray decrypt(const QByteArray &data, const QByteArray &key);
+QByteArray encrypt(const QByteArray &plaintext, const QByteArray &key,
+                   Cipher cipher = Cipher::XChaCha20Poly1305);
+QByteArray decrypt(const QByteArray &data, const QByteArray &key,
+                   Cipher cipher = Cipher::XChaCha20Poly1305);
+
+// Counter mode. The nonce is the chunk index (little-endian, zero-padded),
+// unique because every session has a fresh key. `last` is authenticated as
+// associated data, so a chunk decrypts only under its own index and only
+// with the flag it was sealed with: reordering, substitution and cut-off
+// transfers are detected.
+QByteArray encryptChunk(const QByteArray &plaintext, const QByteArray &key, Cipher cipher,
+                        qint64 index, bool last);
+QByteArray decryptChunk(const QByteArray &data, const QByteArray &key, Cipher cipher,
+                        qint64 index, bool last);
+
 QString keyToBase64Url(const QByteArray &key);
 QByteArray base64UrlToKey(const QString &str);
 
@@ -0,0 +1,70 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "eventrecorder.h"
+
+#include <QDebug>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+constexpr auto FORMAT_NAME = "putinqa-events";
+constexpr auto FORMAT_VERSION = 1;
+}
+
+bool EventRecorder::open(const QString &path, const QString &role)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Cannot record events to" << path;
+        return false;
+    }
+    const QJsonObject header{
+        {"format", FORMAT_NAME},
+        {"version", FORMAT_VERSION},
+        {"role", role},
+    };
+    m_file.write(QJsonDocument(header).toJson(QJsonDocument::Compact));
+    m_file.write("\n");
+    m_clock.start();
+    return true;
+}
+
+void EventRecorder::record(const QString &message)
+{
+    if (!m_file.isOpen()) return;
+    const QJsonObject line{
+        {"t_us", m_clock.nsecsElapsed() / 1000},
+        {"raw", message},
+    };
+    m_file.write(QJsonDocument(line).toJson(QJsonDocument::Compact));
+    m_file.write("\n");
+}
+
+void EventRecorder::close()
+{
+    if (m_file.isOpen()) m_file.close();
+}
+
+bool EventRecorder::load(const QString &path, Recording *recording)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    const QJsonObject header = QJsonDocument::fromJson(file.readLine()).object();
+    if (header.value("format").toString() != QLatin1String(FORMAT_NAME)
+        || header.value("version").toInt() != FORMAT_VERSION) {
+        return false;
+    }
+    recording->role = header.value("role").toString();
+    recording->events.clear();
+
+    while (!file.atEnd()) {
+        const QJsonObject line = QJsonDocument::fromJson(file.readLine()).object();
+        if (!line.contains("raw")) continue;
+        recording->events.append({line.value("t_us").toInteger(), line.value("raw").toString()});
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+// Raw WebSocket events of one session as JSON Lines: a header
+// {"format":"putinqa-events","version":1,"role":"sender"|"receiver"}
+// followed by {"t_us":<since first event>,"raw":"<message text>"} per event.
+// Read back by putinqa-replay.
+class EventRecorder
+{
+public:
+    struct Event
+    {
+        qint64 offsetUs = 0;
+        QString message;
+    };
+
+    struct Recording
+    {
+        QString role;
+        QList<Event> events;
+    };
+
+    bool open(const QString &path, const QString &role);
+    bool isOpen() const { return m_file.isOpen(); }
+    void record(const QString &message);
+    void close();
+
+    // Returns false if the file is missing or not a recording
+    static bool load(const QString &path, Recording *recording);
+
+private:
+    QFile m_file;
+    QElapsedTimer m_clock;
+};
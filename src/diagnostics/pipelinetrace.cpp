@@ -0,0 +1,177 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "pipelinetrace.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+#include <chrono>
+
+namespace {
+
+constexpr quint64 RING_SIZE = 1 << 16;  // ~3 MB, touched only when tracing
+
+enum class Phase : char {
+    Complete = 'X',
+    Instant = 'i',
+    AsyncBegin = 'b',
+    AsyncEnd = 'e',
+};
+
+struct Event {
+    // ticket + 1 once the slot is completely written, 0 while being written
+    std::atomic<quint64> seq {0};
+    qint64 ts = 0;
+    qint64 dur = 0;
+    qint64 chunk = 0;
+    quint32 tid = 0;
+    PipelineTrace::Stage stage = PipelineTrace::Stage::Read;
+    Phase phase = Phase::Instant;
+};
+
+Event g_ring[RING_SIZE];
+std::atomic<quint64> g_head {0};
+std::atomic<quint32> g_nextTid {0};
+const auto g_origin = std::chrono::steady_clock::now();
+
+quint32 threadId()
+{
+    thread_local const quint32 id = ++g_nextTid;
+    return id;
+}
+
+const char *stageName(PipelineTrace::Stage stage)
+{
+    switch (stage) {
+    case PipelineTrace::Stage::Read: return "read";
+    case PipelineTrace::Stage::Compress: return "compress";
+    case PipelineTrace::Stage::Encrypt: return "encrypt";
+    case PipelineTrace::Stage::WsSend: return "ws-send";
+    case PipelineTrace::Stage::NewChunkEcho: return "new_chunk";
+    case PipelineTrace::Stage::Fetch: return "fetch";
+    case PipelineTrace::Stage::Decrypt: return "decrypt";
+    case PipelineTrace::Stage::Decompress: return "decompress";
+    case PipelineTrace::Stage::Write: return "write";
+    case PipelineTrace::Stage::Confirm: return "confirm";
+    case PipelineTrace::Stage::DownloadFinished: return "chunk_download finished";
+    }
+    return "unknown";
+}
+
+void push(PipelineTrace::Stage stage, Phase phase, qint64 chunk, qint64 ts, qint64 dur)
+{
+    const quint64 ticket = g_head.fetch_add(1, std::memory_order_relaxed);
+    Event &event = g_ring[ticket & (RING_SIZE - 1)];
+    event.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.ts = ts;
+    event.dur = dur;
+    event.chunk = chunk;
+    event.tid = threadId();
+    event.stage = stage;
+    event.phase = phase;
+    event.seq.store(ticket + 1, std::memory_order_release);
+}
+
+} // namespace
+
+std::atomic<bool> PipelineTrace::detail::enabled {false};
+
+void PipelineTrace::setEnabled(bool enabled)
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void PipelineTrace::clear()
+{
+    for (auto &event : g_ring) event.seq.store(0, std::memory_order_relaxed);
+    g_head.store(0, std::memory_order_relaxed);
+}
+
+qint64 PipelineTrace::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - g_origin).count();
+}
+
+void PipelineTrace::complete(Stage stage, qint64 chunk, qint64 startNs, qint64 endNs)
+{
+    if (!isEnabled()) return;
+    push(stage, Phase::Complete, chunk, startNs, endNs - startNs);
+}
+
+void PipelineTrace::instant(Stage stage, qint64 chunk)
+{
+    if (!isEnabled()) return;
+    push(stage, Phase::Instant, chunk, nowNs(), 0);
+}
+
+void PipelineTrace::asyncBegin(Stage stage, qint64 chunk)
+{
+    if (!isEnabled()) return;
+    push(stage, Phase::AsyncBegin, chunk, nowNs(), 0);
+}
+
+void PipelineTrace::asyncEnd(Stage stage, qint64 chunk)
+{
+    if (!isEnabled()) return;
+    push(stage, Phase::AsyncEnd, chunk, nowNs(), 0);
+}
+
+bool PipelineTrace::writeChromeJson(const QString &path)
+{
+    const quint64 head = g_head.load(std::memory_order_acquire);
+    const quint64 first = head > RING_SIZE ? head - RING_SIZE : 0;
+
+    QJsonArray events;
+    for (quint64 ticket = first; ticket < head; ++ticket) {
+        const Event &slot = g_ring[ticket & (RING_SIZE - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != ticket + 1) continue;
+
+        const qint64 ts = slot.ts;
+        const qint64 dur = slot.dur;
+        const qint64 chunk = slot.chunk;
+        const quint32 tid = slot.tid;
+        const auto stage = slot.stage;
+        const auto phase = slot.phase;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Overwritten while we were copying it
+        if (slot.seq.load(std::memory_order_relaxed) != ticket + 1) continue;
+
+        QJsonObject event;
+        event["name"] = QString::fromLatin1(stageName(stage));
+        event["cat"] = QStringLiteral("chunk");
+        event["ph"] = QString(QLatin1Char(static_cast<char>(phase)));
+        event["ts"] = ts / 1000.0;
+        event["pid"] = 1;
+        event["tid"] = static_cast<qint64>(tid);
+        event["args"] = QJsonObject{{"chunk", chunk}};
+        switch (phase) {
+        case Phase::Complete:
+            event["dur"] = dur / 1000.0;
+            break;
+        case Phase::Instant:
+            event["s"] = QStringLiteral("t");
+            break;
+        case Phase::AsyncBegin:
+        case Phase::AsyncEnd:
+            event["id"] = chunk;
+            break;
+        }
+        events.append(event);
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "PipelineTrace: cannot write" << path;
+        return false;
+    }
+    const QJsonObject root{{"traceEvents", events}, {"displayTimeUnit", "ms"}};
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
@@ -0,0 +1,62 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+
+// Per-chunk pipeline tracing. Events go into a fixed lock-free ring (oldest
+// are overwritten) and can be written out as Chrome trace JSON, which loads
+// in chrome://tracing and ui.perfetto.dev. When disabled every call site
+// costs one relaxed atomic load.
+namespace PipelineTrace {
+
+enum class Stage : quint8 {
+    Read,
+    Compress,
+    Encrypt,
+    WsSend,
+    NewChunkEcho,
+    Fetch,
+    Decrypt,
+    Decompress,
+    Write,
+    Confirm,
+    DownloadFinished,
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool enabled);
+void clear();
+
+qint64 nowNs();
+void complete(Stage stage, qint64 chunk, qint64 startNs, qint64 endNs);
+void instant(Stage stage, qint64 chunk);
+void asyncBegin(Stage stage, qint64 chunk);
+void asyncEnd(Stage stage, qint64 chunk);
+
+bool writeChromeJson(const QString &path);
+
+// Records a complete ("X") event covering its own lifetime
+class Span {
+public:
+    Span(Stage stage, qint64 chunk)
+        : m_stage(stage), m_chunk(chunk), m_start(isEnabled() ? nowNs() : -1) {}
+    ~Span() { if (m_start >= 0) complete(m_stage, m_chunk, m_start, nowNs()); }
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+
+private:
+    const Stage m_stage;
+    const qint64 m_chunk;
+    const qint64 m_start;
+};
+
+} // namespace PipelineTrace
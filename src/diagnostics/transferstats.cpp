@@ -0,0 +1,153 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "transferstats.h"
+
+#include <QtAlgorithms>
+
+void Histogram::record(qint64 value)
+{
+    if (value < 0) value = 0;
+
+    ++m_buckets[bucketOf(value)];
+    if (m_count == 0 || value < m_min) m_min = value;
+    if (value > m_max) m_max = value;
+    m_sum += value;
+    ++m_count;
+}
+
+void Histogram::reset()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+qint64 Histogram::percentile(double p) const
+{
+    if (m_count == 0) return 0;
+
+    const auto target = static_cast<quint64>(qBound(0.0, p, 100.0) / 100.0 * m_count + 0.5);
+    quint64 seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        seen += m_buckets[bucket];
+        if (seen >= qMax<quint64>(target, 1)) {
+            const qint64 mid = bucketLow(bucket) + (bucketHigh(bucket) - bucketLow(bucket)) / 2;
+            return qBound(m_min, mid, m_max);
+        }
+    }
+    return m_max;
+}
+
+QJsonObject Histogram::toJson() const
+{
+    return {
+        {"count", static_cast<qint64>(m_count)},
+        {"min", min()},
+        {"max", m_max},
+        {"mean", mean()},
+        {"p50", percentile(50)},
+        {"p90", percentile(90)},
+        {"p99", percentile(99)},
+        {"p999", percentile(99.9)},
+    };
+}
+
+int Histogram::bucketOf(qint64 value)
+{
+    if (value < LINEAR_COUNT) return static_cast<int>(value);
+
+    const int msb = 63 - qCountLeadingZeroBits(static_cast<quint64>(value));
+    const int shift = msb - SUB_BITS;
+    const int sub = static_cast<int>((value >> shift) & (SUB_COUNT - 1));
+    return LINEAR_COUNT + (msb - (SUB_BITS + 1)) * SUB_COUNT + sub;
+}
+
+qint64 Histogram::bucketLow(int bucket)
+{
+    if (bucket < LINEAR_COUNT) return bucket;
+
+    const int group = (bucket - LINEAR_COUNT) / SUB_COUNT;
+    const int sub = (bucket - LINEAR_COUNT) % SUB_COUNT;
+    const int shift = group + 1;
+    return static_cast<qint64>(SUB_COUNT + sub) << shift;
+}
+
+qint64 Histogram::bucketHigh(int bucket)
+{
+    if (bucket < LINEAR_COUNT) return bucket;
+
+    const int shift = (bucket - LINEAR_COUNT) / SUB_COUNT + 1;
+    return bucketLow(bucket) + ((static_cast<qint64>(1) << shift) - 1);
+}
+
+TransferStats::TransferStats()
+{
+    m_clock.start();
+}
+
+void TransferStats::addPayload(qint64 plainBytes, qint64 wireBytes)
+{
+    const qint64 now = m_clock.elapsed();
+    if (m_firstPayloadMs < 0) m_firstPayloadMs = now;
+    m_lastPayloadMs = now;
+    m_payloadBytes += plainBytes;
+    m_wireBytes += wireBytes;
+    ++m_chunks;
+}
+
+double TransferStats::goodputBytesPerSec() const
+{
+    const qint64 spanMs = m_lastPayloadMs - m_firstPayloadMs;
+    if (m_firstPayloadMs < 0 || spanMs <= 0) return 0.0;
+    return m_payloadBytes * 1000.0 / spanMs;
+}
+
+QVariantMap TransferStats::toVariantMap() const
+{
+    return {
+        {"goodput", goodputBytesPerSec()},
+        {"payloadBytes", m_payloadBytes},
+        {"wireBytes", m_wireBytes},
+        {"chunks", m_chunks},
+        {"failedDownloads", m_failedDownloads},
+        {"timeToFirstPayloadMs", m_firstPayloadMs},
+        {"downloadLatencyP50Us", chunkDownloadLatencyUs.percentile(50)},
+        {"downloadLatencyP99Us", chunkDownloadLatencyUs.percentile(99)},
+        {"encryptP50Us", encryptUs.percentile(50)},
+        {"decryptP50Us", decryptUs.percentile(50)},
+        {"compressP50Us", compressUs.percentile(50)},
+        {"decompressP50Us", decompressUs.percentile(50)},
+        {"wsSendQueueMaxBytes", wsSendQueueBytes.max()},
+        {"eventP99Us", eventProcessingUs.percentile(99)},
+        {"wsReconnects", static_cast<qint64>(wsOutageMs.count())},
+        {"wsOutageMaxMs", wsOutageMs.max()},
+        {"rttMs", m_rttMs},
+    };
+}
+
+QJsonObject TransferStats::toJson() const
+{
+    return {
+        {"elapsed_ms", m_clock.elapsed()},
+        {"time_to_first_payload_ms", m_firstPayloadMs},
+        {"payload_bytes", m_payloadBytes},
+        {"wire_bytes", m_wireBytes},
+        {"chunks", m_chunks},
+        {"failed_downloads", m_failedDownloads},
+        {"goodput_bytes_per_sec", goodputBytesPerSec()},
+        {"chunk_download_latency_us", chunkDownloadLatencyUs.toJson()},
+        {"encrypt_us", encryptUs.toJson()},
+        {"decrypt_us", decryptUs.toJson()},
+        {"compress_us", compressUs.toJson()},
+        {"decompress_us", decompressUs.toJson()},
+        {"ws_send_queue_bytes", wsSendQueueBytes.toJson()},
+        {"event_processing_us", eventProcessingUs.toJson()},
+        {"ws_reconnect_delay_ms", wsReconnectDelayMs.toJson()},
+        {"ws_outage_ms", wsOutageMs.toJson()},
+        {"ws_rtt_ms", wsRttMs.toJson()},
+    };
+}
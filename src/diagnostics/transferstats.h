@@ -0,0 +1,89 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QVariantMap>
+
+#include <array>
+
+// Log-linear histogram in the spirit of HdrHistogram: values below 32 are
+// exact, above that every power of two is split into 16 buckets (~6% error).
+// Fixed size, no allocation on record().
+class Histogram
+{
+public:
+    void record(qint64 value);
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64 min() const { return m_count ? m_min : 0; }
+    qint64 max() const { return m_max; }
+    double mean() const { return m_count ? static_cast<double>(m_sum) / m_count : 0.0; }
+    qint64 percentile(double p) const;
+
+    QJsonObject toJson() const;
+
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int LINEAR_COUNT = SUB_COUNT * 2;
+    static constexpr int BUCKET_COUNT = LINEAR_COUNT + (63 - (SUB_BITS + 1)) * SUB_COUNT;
+
+    static int bucketOf(qint64 value);
+    static qint64 bucketLow(int bucket);
+    static qint64 bucketHigh(int bucket);
+
+    std::array<quint64, BUCKET_COUNT> m_buckets {};
+    quint64 m_count = 0;
+    qint64 m_sum = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+};
+
+// Per-session transfer metrics. Session records network-side samples,
+// ChunkUpload and ChunkDownload record crypto timings and payload progress.
+class TransferStats
+{
+public:
+    TransferStats();
+
+    Histogram chunkDownloadLatencyUs;
+    Histogram encryptUs;
+    Histogram decryptUs;
+    Histogram compressUs;    // only with compression negotiated
+    Histogram decompressUs;
+    Histogram wsSendQueueBytes;
+    Histogram eventProcessingUs;
+    Histogram wsReconnectDelayMs;  // backoff drawn for each reconnect attempt
+    Histogram wsOutageMs;          // lost to reconnected, one per outage
+    Histogram wsRttMs;             // WebSocket ping round trips
+
+    // Plaintext bytes that made it through the pipeline (sender: accepted by
+    // the server, receiver: decrypted and written) and their size on the wire,
+    // which is smaller than the payload when chunks are compressed.
+    void addPayload(qint64 plainBytes, qint64 wireBytes);
+    void addFailedDownload() { ++m_failedDownloads; }
+    void setRttMs(qint64 smoothedMs) { m_rttMs = smoothedMs; }
+
+    qint64 payloadBytes() const { return m_payloadBytes; }
+    qint64 timeToFirstPayloadMs() const { return m_firstPayloadMs; }
+    qint64 rttMs() const { return m_rttMs; }
+    double goodputBytesPerSec() const;
+
+    QVariantMap toVariantMap() const;  // flat, for the QML stats property
+    QJsonObject toJson() const;        // full histograms, machine-readable
+
+private:
+    QElapsedTimer m_clock;
+    qint64 m_firstPayloadMs = -1;
+    qint64 m_lastPayloadMs = -1;
+    qint64 m_payloadBytes = 0;
+    qint64 m_wireBytes = 0;
+    qint64 m_chunks = 0;
+    qint64 m_failedDownloads = 0;
+    qint64 m_rttMs = -1;
+};
@@ -3,6 +3,7 @@
 // For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QQuickWindow>
@@ -11,11 +12,90 @@
 #include <QIcon>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+
+#include <memory>
 
 #include "appcontroller.h"
 
 static const QString SERVER_NAME = QStringLiteral("putinqa");
 
+// --send while another instance runs. The files join its queue:
+//   -> "send\n<path>\n<path>\n...\n\n"
+//   <- "link <path>\t<url>\n" or "dropped <path>\t<reason>\n" per file
+// Links go to stdout as "<path>\t<url>", like a first instance prints them.
+// Exits once every file is reported: 1 if one was dropped or the running
+// instance went away.
+static int forwardSend(QLocalSocket &socket, const QStringList &paths)
+{
+    QSet<QString> pending;
+    QByteArray request = "send\n";
+    for (const QString &path : paths) {
+        const QString absolute = QFileInfo(path).absoluteFilePath();
+        pending.insert(absolute);
+        request += absolute.toUtf8() + '\n';
+    }
+    request += '\n';
+    socket.write(request);
+    if (!socket.waitForBytesWritten(500)) {
+        qCritical() << "Cannot hand the files to the running instance";
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    bool dropped = false;
+    while (!pending.isEmpty()) {
+        if (!socket.canReadLine() && !socket.waitForReadyRead(-1)) {
+            qCritical() << "The running instance closed the connection";
+            return 1;
+        }
+        while (socket.canReadLine()) {
+            QString line = QString::fromUtf8(socket.readLine());
+            if (line.endsWith('\n')) line.chop(1);
+            const QString kind = line.section(' ', 0, 0);
+            const QString path = line.section(' ', 1).section('\t', 0, 0);
+            const QString detail = line.section('\t', 1);
+            if (!pending.remove(path)) continue;
+            if (kind == "link") {
+                out << path << '\t' << detail << Qt::endl;
+            } else {
+                dropped = true;
+                qCritical().noquote() << path << "was not sent:" << detail;
+            }
+        }
+    }
+    return dropped ? 1 : 0;
+}
+
+// The other end of forwardSend(). Reports only the files this client
+// handed over and lets it go once all are reported.
+static void serveSend(QLocalSocket *client, AppController &controller)
+{
+    auto pending = std::make_shared<QSet<QString>>();
+    QList<QUrl> files;
+    const QList<QByteArray> lines = client->readAll().split('\n');
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        if (lines[i].isEmpty()) continue;
+        const QString path = QString::fromUtf8(lines[i]);
+        pending->insert(path);
+        files << QUrl::fromLocalFile(path);
+    }
+
+    auto report = [client, pending](const char *kind, const QString &path, const QString &detail) {
+        if (!pending->remove(path)) return;
+        client->write(QStringLiteral("%1 %2\t%3\n").arg(QLatin1String(kind), path, detail).toUtf8());
+        if (pending->isEmpty()) client->disconnectFromServer();
+    };
+    QObject::connect(&controller, &AppController::sendLinkReady, client,
+                     [report](const QString &path, const QString &link) { report("link", path, link); });
+    QObject::connect(&controller, &AppController::sendDropped, client,
+                     [report](const QString &path, const QString &reason) { report("dropped", path, reason); });
+    controller.enqueueFiles(files);
+}
+
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
@@ -25,11 +105,28 @@ int main(int argc, char *argv[])
     app.setQuitOnLastWindowClosed(false);
     app.setWindowIcon(QIcon(":/icons/appicon.png"));
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    const QCommandLineOption traceOption("trace",
+        "Record per-chunk pipeline spans and write them as Chrome trace JSON to <file>.", "file");
+    parser.addOption(traceOption);
+    const QCommandLineOption statsOption("stats",
+        "Write transfer latency/throughput histograms as JSON to <file> when the transfer ends.", "file");
+    parser.addOption(statsOption);
+    const QCommandLineOption eventsOption("record-events",
+        "Record raw WebSocket events with timestamps to <file> for putinqa-replay.", "file");
+    parser.addOption(eventsOption);
+    const QCommandLineOption sendOption("send",
+        "Send <file>; repeat to send several files back to back, one session each.", "file");
+    parser.addOption(sendOption);
+    parser.process(app);
+
     // Single instance check
     {
         QLocalSocket socket;
         socket.connectToServer(SERVER_NAME);
         if (socket.waitForConnected(500)) {
+            if (parser.isSet(sendOption)) return forwardSend(socket, parser.values(sendOption));
             // Another instance is running — ask it to show, then quit
             socket.write("show");
             socket.waitForBytesWritten(500);
@@ -45,6 +142,15 @@ int main(int argc, char *argv[])
     localServer.listen(SERVER_NAME);
 
     AppController controller;
+    if (parser.isSet(traceOption)) {
+        controller.setTraceFile(parser.value(traceOption));
+    }
+    if (parser.isSet(statsOption)) {
+        controller.setStatsFile(parser.value(statsOption));
+    }
+    if (parser.isSet(eventsOption)) {
+        controller.setEventsFile(parser.value(eventsOption));
+    }
 
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty("appController", &controller);
@@ -53,18 +159,48 @@ int main(int argc, char *argv[])
     if (engine.rootObjects().isEmpty())
         return -1;
 
+    if (parser.isSet(sendOption)) {
+        // For batch jobs: "<path>\t<link>" per file on stdout, failures on stderr
+        QObject::connect(&controller, &AppController::sendLinkReady, &controller,
+                         [](const QString &path, const QString &link) {
+            QTextStream(stdout) << path << '\t' << link << Qt::endl;
+        });
+        QObject::connect(&controller, &AppController::sendDropped, &controller,
+                         [](const QString &path, const QString &reason) {
+            qCritical().noquote() << path << "was not sent:" << reason;
+        });
+        QList<QUrl> files;
+        for (const QString &path : parser.values(sendOption)) files << QUrl::fromLocalFile(path);
+        controller.enqueueFiles(files);
+    }
+
     auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().first());
 
-    // When another instance connects, show this window
-    QObject::connect(&localServer, &QLocalServer::newConnection, window, [&localServer, window]() {
+    // When another instance connects, show this window, or queue the files
+    // it was started to send
+    QObject::connect(&localServer, &QLocalServer::newConnection, window, [&localServer, &controller, window]() {
         auto *client = localServer.nextPendingConnection();
-        if (client) {
-            client->waitForReadyRead(500);
-            client->deleteLater();
-        }
-        window->show();
-        window->raise();
-        window->requestActivate();
+        if (!client) return;
+        QObject::connect(client, &QLocalSocket::disconnected, client, &QObject::deleteLater);
+        QObject::connect(client, &QLocalSocket::readyRead, client, [client, &controller, window]() {
+            const QByteArray data = client->peek(client->bytesAvailable());
+            if (data.isEmpty() || QByteArrayLiteral("send\n").startsWith(data)) return;
+            if (data.startsWith("send\n")) {
+                // Until the empty line that ends the list
+                if (data.endsWith("\n\n")) serveSend(client, controller);
+                return;
+            }
+            client->readAll();
+            client->disconnectFromServer();
+            window->show();
+            window->raise();
+            window->requestActivate();
+        });
+    });
+
+    // Hidden in the tray or minimized: nothing on screen to keep up to date
+    QObject::connect(window, &QWindow::visibilityChanged, &controller, [&controller](QWindow::Visibility visibility) {
+        controller.setBackground(visibility == QWindow::Hidden || visibility == QWindow::Minimized);
     });
 
     // System tray
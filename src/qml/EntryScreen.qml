@@ -56,6 +56,19 @@ Item {
             }
         }
 
+        Text {
+            Layout.alignment: Qt.AlignHCenter
+            Layout.topMargin: -8
+            text: appController.t.sendFolder
+            color: sendFolderMA.containsMouse ? "#eee" : "#999"; font.pixelSize: 13; font.underline: true
+
+            MouseArea {
+                id: sendFolderMA; anchors.fill: parent; hoverEnabled: true
+                cursorShape: Qt.PointingHandCursor
+                onClicked: { appController.startSend(); folderDialog.open() }
+            }
+        }
+
         // Receive section
         Rectangle {
             Layout.fillWidth: true; radius: 8
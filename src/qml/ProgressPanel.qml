@@ -79,6 +79,24 @@ Rectangle {
                 font.bold: true
             }
 
+            // Goodput over the transfer so far
+            Text {
+                property real goodput: appController.stats.transfer ? appController.stats.transfer.goodput : 0
+                visible: goodput > 0
+                text: appController.formatBytes(goodput) + "/s"
+                color: "#999"
+                font.pixelSize: 12
+            }
+
+            // Smoothed WebSocket round trip to the server
+            Text {
+                property int rtt: appController.stats.transfer ? appController.stats.transfer.rttMs : -1
+                visible: rtt >= 0
+                text: rtt + " ms"
+                color: "#999"
+                font.pixelSize: 12
+            }
+
             Item { Layout.fillWidth: true }
 
             // Buffer status (sender only)
@@ -162,6 +162,19 @@ Item {
 
             ProgressPanel { Layout.fillWidth: true }
 
+            Text {
+                Layout.alignment: Qt.AlignHCenter
+                text: appController.queuedCount > 0
+                      ? appController.t.queueMore + " (" + appController.queuedCount + " " + appController.t.queued + ")"
+                      : appController.t.queueMore
+                color: queueMA1.containsMouse ? "#eee" : "#999"; font.pixelSize: 12; font.underline: true
+                MouseArea {
+                    id: queueMA1; anchors.fill: parent; hoverEnabled: true
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: queueDialog.open()
+                }
+            }
+
             Text {
                 Layout.fillWidth: true
                 visible: appController.errorMsg.length > 0
@@ -239,6 +252,19 @@ Item {
 
             ProgressPanel { Layout.fillWidth: true }
 
+            Text {
+                Layout.alignment: Qt.AlignHCenter
+                text: appController.queuedCount > 0
+                      ? appController.t.queueMore + " (" + appController.queuedCount + " " + appController.t.queued + ")"
+                      : appController.t.queueMore
+                color: queueMA2.containsMouse ? "#eee" : "#999"; font.pixelSize: 12; font.underline: true
+                MouseArea {
+                    id: queueMA2; anchors.fill: parent; hoverEnabled: true
+                    cursorShape: Qt.PointingHandCursor
+                    onClicked: queueDialog.open()
+                }
+            }
+
             MemberList { Layout.fillWidth: true }
 
             // Freeze button
@@ -12,6 +12,8 @@ Item {
     property string proxyHost: appController.proxyHost
     property int proxyPort: appController.proxyPort
     property bool selectedAutoDropFreeze: appController.autoDropFreeze
+    property bool selectedCompression: appController.compression
+    property bool selectedPreferAes: appController.preferAes
 
     ColumnLayout {
         anchors.centerIn: parent
@@ -216,6 +218,92 @@ Item {
             }
         }
 
+        // Compression toggle — sender side only, hidden when built without zstd.
+        RowLayout {
+            Layout.fillWidth: true; spacing: 10
+            visible: appController.compressionAvailable
+
+            Rectangle {
+                id: compressionBox
+                width: 20; height: 20; radius: 3
+                border.color: selectedCompression ? "#e94560" : "#0f3460"
+                border.width: selectedCompression ? 2 : 1
+                color: selectedCompression ? "#e94560" : "#16213e"
+                Text {
+                    anchors.centerIn: parent
+                    text: "✓"
+                    color: "#eee"; font.pixelSize: 14; font.bold: true
+                    visible: selectedCompression
+                }
+                MouseArea {
+                    anchors.fill: parent; cursorShape: Qt.PointingHandCursor
+                    onClicked: selectedCompression = !selectedCompression
+                }
+            }
+
+            ColumnLayout {
+                Layout.fillWidth: true; spacing: 2
+
+                Text {
+                    text: appController.t.compressionLabel
+                    color: "#eee"; font.pixelSize: 13
+                    MouseArea {
+                        anchors.fill: parent; cursorShape: Qt.PointingHandCursor
+                        onClicked: selectedCompression = !selectedCompression
+                    }
+                }
+                Text {
+                    text: appController.t.compressionHint
+                    color: "#777"; font.pixelSize: 11
+                    Layout.fillWidth: true
+                    wrapMode: Text.WordWrap
+                }
+            }
+        }
+
+        // AES toggle — sender side only, hidden on CPUs without AES instructions.
+        RowLayout {
+            Layout.fillWidth: true; spacing: 10
+            visible: appController.aesAvailable
+
+            Rectangle {
+                id: preferAesBox
+                width: 20; height: 20; radius: 3
+                border.color: selectedPreferAes ? "#e94560" : "#0f3460"
+                border.width: selectedPreferAes ? 2 : 1
+                color: selectedPreferAes ? "#e94560" : "#16213e"
+                Text {
+                    anchors.centerIn: parent
+                    text: "✓"
+                    color: "#eee"; font.pixelSize: 14; font.bold: true
+                    visible: selectedPreferAes
+                }
+                MouseArea {
+                    anchors.fill: parent; cursorShape: Qt.PointingHandCursor
+                    onClicked: selectedPreferAes = !selectedPreferAes
+                }
+            }
+
+            ColumnLayout {
+                Layout.fillWidth: true; spacing: 2
+
+                Text {
+                    text: appController.t.preferAesLabel
+                    color: "#eee"; font.pixelSize: 13
+                    MouseArea {
+                        anchors.fill: parent; cursorShape: Qt.PointingHandCursor
+                        onClicked: selectedPreferAes = !selectedPreferAes
+                    }
+                }
+                Text {
+                    text: appController.t.preferAesHint
+                    color: "#777"; font.pixelSize: 11
+                    Layout.fillWidth: true
+                    wrapMode: Text.WordWrap
+                }
+            }
+        }
+
         RowLayout {
             Layout.fillWidth: true; spacing: 12
 
@@ -227,7 +315,7 @@ Item {
                     id: saveMA; anchors.fill: parent; hoverEnabled: true; cursorShape: Qt.PointingHandCursor
                     onClicked: appController.saveSettings(urlInput.text.trim(), nameInput.text.trim(), selectedLang,
                                                          selectedProxy, proxyHostInput.text.trim(), parseInt(proxyPortInput.text) || 0,
-                                                         selectedAutoDropFreeze)
+                                                         selectedAutoDropFreeze, selectedCompression, selectedPreferAes)
                 }
             }
 
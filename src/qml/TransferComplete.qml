@@ -25,6 +25,9 @@ Item {
                 switch (appController.completeStatus) {
                 case "ok": return appController.t.transferComplete
                 case "timeout": return appController.t.sessionTimedOut
+                case "truncated": return appController.t.transferTruncated
+                case "extract_failed": return appController.t.transferExtractFailed
+                case "corrupt": return appController.t.transferCorrupt
                 case "sender_is_gone": return appController.t.senderDisconnected
                 case "no_receivers": return appController.t.noReceiversJoined
                 case "terminated_by_you": return appController.t.sessionTerminated
@@ -52,7 +55,7 @@ Item {
             Text { anchors.centerIn: parent; text: appController.t.saveFile; color: "#eee"; font.pixelSize: 15; font.bold: true }
             MouseArea {
                 id: saveMA; anchors.fill: parent; hoverEnabled: true; cursorShape: Qt.PointingHandCursor
-                onClicked: saveDialog.open()
+                onClicked: appController.receivingArchive ? saveFolderDialog.open() : saveDialog.open()
             }
         }
 
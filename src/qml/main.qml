@@ -24,8 +24,22 @@ ApplicationWindow {
 
     FileDialog {
         id: fileDialog
+        fileMode: FileDialog.OpenFiles
         title: appController.t.selectFileTitle
-        onAccepted: appController.selectFile(selectedFile)
+        onAccepted: appController.selectFiles(selectedFiles)
+    }
+
+    FileDialog {
+        id: queueDialog
+        fileMode: FileDialog.OpenFiles
+        title: appController.t.queueFilesTitle
+        onAccepted: appController.enqueueFiles(selectedFiles)
+    }
+
+    FolderDialog {
+        id: folderDialog
+        title: appController.t.selectFolderTitle
+        onAccepted: appController.selectFolder(selectedFolder)
     }
 
     FileDialog {
@@ -36,6 +50,13 @@ ApplicationWindow {
         onAccepted: appController.saveReceivedFile(selectedFile)
     }
 
+    FolderDialog {
+        id: saveFolderDialog
+        title: appController.t.saveFolderTitle
+        currentFolder: appController.suggestedSavePath
+        onAccepted: appController.saveReceivedFile(selectedFolder)
+    }
+
     ColumnLayout {
         anchors.fill: parent
         spacing: 0
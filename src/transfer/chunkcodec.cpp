@@ -0,0 +1,157 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "chunkcodec.h"
+
+#include <QtGlobal>
+
+#ifdef PUTINQA_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr char FLAG_STORED = 0;
+constexpr char FLAG_ZSTD = 1;
+
+#ifdef PUTINQA_HAVE_ZSTD
+// Chunks larger than twice this are probed at the fastest level first, so
+// already-compressed data (video, archives) costs one small attempt
+constexpr qint64 PROBE_BYTES = 64 * 1024;
+
+// Compressed output must save at least 1/32 (~3%) or the chunk is stored
+bool worthIt(qint64 compressed, qint64 raw)
+{
+    return compressed < raw - raw / 32;
+}
+
+// Reused across chunks on the same thread; a context must not be shared
+// between threads
+struct Contexts
+{
+    ZSTD_CCtx *cctx = nullptr;
+    ZSTD_DCtx *dctx = nullptr;
+
+    ~Contexts()
+    {
+        ZSTD_freeCCtx(cctx);
+        ZSTD_freeDCtx(dctx);
+    }
+};
+thread_local Contexts t_contexts;
+#endif
+
+QByteArray stored(const QByteArray &raw)
+{
+    QByteArray framed;
+    framed.reserve(raw.size() + 1);
+    framed.append(FLAG_STORED);
+    framed.append(raw);
+    return framed;
+}
+
+} // namespace
+
+bool ChunkCodec::isAvailable(Method method)
+{
+#ifdef PUTINQA_HAVE_ZSTD
+    Q_UNUSED(method);
+    return true;
+#else
+    return method == Method::None;
+#endif
+}
+
+QString ChunkCodec::methodName(Method method)
+{
+    return method == Method::Zstd ? QStringLiteral("zstd") : QString();
+}
+
+ChunkCodec::Method ChunkCodec::methodFromName(const QString &name, bool *ok)
+{
+    if (ok) *ok = true;
+    if (name.isEmpty() || name == "none") return Method::None;
+    if (name == "zstd") return Method::Zstd;
+    if (ok) *ok = false;
+    return Method::None;
+}
+
+void ChunkCodec::setMethod(Method method, int level)
+{
+    m_method = isAvailable(method) ? method : Method::None;
+#ifdef PUTINQA_HAVE_ZSTD
+    m_level = qBound(1, level, ZSTD_maxCLevel());
+#else
+    m_level = level;
+#endif
+}
+
+QByteArray ChunkCodec::encode(const QByteArray &raw) const
+{
+    if (m_method == Method::None) return raw;
+
+#ifdef PUTINQA_HAVE_ZSTD
+    ZSTD_CCtx *&cctx = t_contexts.cctx;
+    if (!cctx) cctx = ZSTD_createCCtx();
+    if (!cctx) return stored(raw);
+
+    if (raw.size() > 2 * PROBE_BYTES) {
+        QByteArray probe(static_cast<qsizetype>(ZSTD_compressBound(PROBE_BYTES)), Qt::Uninitialized);
+        const size_t size = ZSTD_compressCCtx(cctx, probe.data(), probe.size(),
+                                              raw.constData(), PROBE_BYTES, 1);
+        if (ZSTD_isError(size) || !worthIt(static_cast<qint64>(size), PROBE_BYTES)) return stored(raw);
+    }
+
+    QByteArray framed(static_cast<qsizetype>(1 + ZSTD_compressBound(raw.size())), Qt::Uninitialized);
+    framed[0] = FLAG_ZSTD;
+    const size_t size = ZSTD_compressCCtx(cctx, framed.data() + 1, framed.size() - 1,
+                                          raw.constData(), raw.size(), m_level);
+    if (ZSTD_isError(size) || !worthIt(static_cast<qint64>(size), raw.size())) return stored(raw);
+    framed.resize(static_cast<qsizetype>(1 + size));
+    return framed;
+#else
+    return stored(raw);
+#endif
+}
+
+bool ChunkCodec::decode(const QByteArray &framed, qint64 maxSize, QByteArray *raw) const
+{
+    if (m_method == Method::None) {
+        *raw = framed;
+        return true;
+    }
+    if (framed.isEmpty()) return false;
+
+    const char flag = framed.at(0);
+    if (flag == FLAG_STORED) {
+        *raw = framed.mid(1);
+        return raw->size() <= maxSize;
+    }
+    if (flag != FLAG_ZSTD) return false;
+
+#ifdef PUTINQA_HAVE_ZSTD
+    const char *src = framed.constData() + 1;
+    const size_t srcSize = static_cast<size_t>(framed.size() - 1);
+
+    // The sender always writes the content size; refuse frames without it
+    // or larger than a chunk can be, before allocating anything
+    const unsigned long long contentSize = ZSTD_getFrameContentSize(src, srcSize);
+    if (contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR
+        || contentSize > static_cast<unsigned long long>(maxSize)) {
+        return false;
+    }
+
+    ZSTD_DCtx *&dctx = t_contexts.dctx;
+    if (!dctx) dctx = ZSTD_createDCtx();
+    if (!dctx) return false;
+
+    QByteArray out(static_cast<qsizetype>(contentSize), Qt::Uninitialized);
+    const size_t size = ZSTD_decompressDCtx(dctx, out.data(), out.size(), src, srcSize);
+    if (ZSTD_isError(size) || size != contentSize) return false;
+    *raw = std::move(out);
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+// Optional compression stage in front of encryption. Once a method is
+// negotiated (share link "compression=zstd") every chunk plaintext starts
+// with a one-byte flag: 0 = stored as is, 1 = zstd frame. Without a method
+// chunks carry no flag, so the wire format matches older clients.
+// A codec is a method and a level; the zstd contexts are kept per thread, so
+// copies of one run on the crypto workers side by side.
+class ChunkCodec
+{
+public:
+    enum class Method { None, Zstd };
+
+    static constexpr int DEFAULT_LEVEL = 3;
+
+    // Whether the method was compiled in (PUTINQA_HAVE_ZSTD)
+    static bool isAvailable(Method method);
+    static QString methodName(Method method);
+    static Method methodFromName(const QString &name, bool *ok = nullptr);
+
+    // Falls back to None when the method is not available
+    void setMethod(Method method, int level = DEFAULT_LEVEL);
+    Method method() const { return m_method; }
+    int level() const { return m_level; }
+
+    // Bytes the framing adds to a chunk that is stored as is
+    int overhead() const { return m_method == Method::None ? 0 : 1; }
+
+    // Chunks that do not shrink noticeably are stored as is
+    QByteArray encode(const QByteArray &raw) const;
+
+    // Returns false for a malformed chunk or one that would expand beyond
+    // maxSize bytes
+    bool decode(const QByteArray &framed, qint64 maxSize, QByteArray *raw) const;
+
+private:
+    Method m_method = Method::None;
+    int m_level = DEFAULT_LEVEL;
+};
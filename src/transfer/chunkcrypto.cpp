@@ -0,0 +1,90 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "chunkcrypto.h"
+#include "transferjournal.h"
+#include "diagnostics/pipelinetrace.h"
+#include "diagnostics/transferstats.h"
+
+#include <QElapsedTimer>
+
+void SealedChunk::recordTimes(TransferStats &stats) const
+{
+    if (compressUs >= 0) stats.compressUs.record(compressUs);
+    stats.encryptUs.record(encryptUs);
+}
+
+void OpenedChunk::recordTimes(TransferStats &stats) const
+{
+    stats.decryptUs.record(decryptUs);
+    if (decompressUs >= 0) stats.decompressUs.record(decompressUs);
+}
+
+SealedChunk ChunkCrypto::seal(const QByteArray &raw, qint64 index, bool last) const
+{
+    SealedChunk chunk;
+    chunk.index = index;
+    chunk.payloadBytes = raw.size();
+    if (digest) chunk.plainDigest = TransferJournal::digest(raw);
+    QElapsedTimer timer;
+    QByteArray encoded = raw;
+    if (codec.method() != ChunkCodec::Method::None) {
+        PipelineTrace::Span span(PipelineTrace::Stage::Compress, index);
+        timer.start();
+        encoded = codec.encode(raw);
+        chunk.compressUs = timer.nsecsElapsed() / 1000;
+    }
+    {
+        PipelineTrace::Span span(PipelineTrace::Stage::Encrypt, index);
+        timer.start();
+        if (nonceMode == Crypto::NonceMode::Random) {
+            chunk.data = Crypto::encrypt(encoded, key, cipher);
+        } else {
+            chunk.data = Crypto::encryptChunk(encoded, key, cipher, index, last);
+        }
+        chunk.encryptUs = timer.nsecsElapsed() / 1000;
+    }
+    if (digest && nonceMode == Crypto::NonceMode::Counter) {
+        chunk.sealedDigest = TransferJournal::digest(chunk.data);
+    }
+    return chunk;
+}
+
+OpenedChunk ChunkCrypto::open(const QByteArray &data, qint64 index, qint64 maxSize) const
+{
+    OpenedChunk opened;
+    QElapsedTimer timer;
+    QByteArray decrypted;
+    {
+        PipelineTrace::Span span(PipelineTrace::Stage::Decrypt, index);
+        timer.start();
+        if (nonceMode == Crypto::NonceMode::Random) {
+            decrypted = Crypto::decrypt(data, key, cipher);
+        } else {
+            // Only the final chunk is sealed with last = true, so the second
+            // attempt runs once per transfer (a failed tag check does not decrypt)
+            decrypted = Crypto::decryptChunk(data, key, cipher, index, false);
+            if (decrypted.isEmpty()) {
+                decrypted = Crypto::decryptChunk(data, key, cipher, index, true);
+                opened.last = !decrypted.isEmpty();
+            }
+        }
+        opened.decryptUs = timer.nsecsElapsed() / 1000;
+    }
+    if (decrypted.isEmpty()) {
+        opened.failedStage = "decrypt";
+        return opened;
+    }
+
+    if (codec.method() == ChunkCodec::Method::None) {
+        opened.plain = decrypted;
+        return opened;
+    }
+    PipelineTrace::Span span(PipelineTrace::Stage::Decompress, index);
+    timer.start();
+    const bool ok = codec.decode(decrypted, maxSize, &opened.plain);
+    opened.decompressUs = timer.nsecsElapsed() / 1000;
+    if (!ok) opened.failedStage = "decompress";
+    return opened;
+}
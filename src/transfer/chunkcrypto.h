@@ -0,0 +1,57 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+
+#include "crypto/crypto.h"
+#include "transfer/chunkcodec.h"
+
+class TransferStats;
+
+// A chunk read and sealed, ready to go out
+struct SealedChunk
+{
+    qint64 index = 0;
+    QByteArray data;
+    qint64 payloadBytes = 0;
+    QByteArray plainDigest;  // of the file bytes, when journaled
+    QByteArray sealedDigest; // of data, when journaled in counter mode
+    qint64 compressUs = -1;  // timed on the worker, -1 = not compressed
+    qint64 encryptUs = 0;
+
+    void recordTimes(TransferStats &stats) const;
+};
+
+// A chunk as downloaded, opened
+struct OpenedChunk
+{
+    QByteArray plain;
+    bool last = false;                     // counter nonces: sealed as the last chunk
+    const char *failedStage = nullptr;     // "decrypt" or "decompress"
+    qint64 decryptUs = 0;
+    qint64 decompressUs = -1;              // -1 = not decompressed
+
+    void recordTimes(TransferStats &stats) const;
+};
+
+// One transfer's key, cipher and codec, negotiated through the share link.
+// Every transfer has its own; a copy goes into each job for the crypto
+// workers (SessionManager::runCrypto), so a job never touches the transfer
+// that started it.
+struct ChunkCrypto
+{
+    QByteArray key;
+    Crypto::Cipher cipher = Crypto::Cipher::XChaCha20Poly1305;
+    Crypto::NonceMode nonceMode = Crypto::NonceMode::Random;
+    ChunkCodec codec;
+    bool digest = false;  // for the journal: of the plaintext, and in counter mode of the sealed chunk
+
+    // Bytes a chunk gains over its payload when stored as is
+    int overhead() const { return Crypto::overhead(cipher, nonceMode) + codec.overhead(); }
+
+    SealedChunk seal(const QByteArray &raw, qint64 index, bool last) const;
+    OpenedChunk open(const QByteArray &data, qint64 index, qint64 maxSize) const;
+};
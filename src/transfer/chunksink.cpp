@@ -0,0 +1,70 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "chunksink.h"
+
+#include <QFileDevice>
+#include <QIODevice>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+bool ChunkSink::accept(qint64 index, const QByteArray &data)
+{
+    if (contains(index)) return false;
+    m_accepted.insert(index);
+
+    if (index != m_nextIndex) {
+        m_pending.insert(index, data);
+        m_pendingBytes += data.size();
+        return true;
+    }
+
+    write(data);
+    m_nextIndex++;
+
+    // Drain buffered chunks that are now sequential
+    auto it = m_pending.begin();
+    while (it != m_pending.end() && it.key() == m_nextIndex) {
+        write(it.value());
+        m_pendingBytes -= it.value().size();
+        it = m_pending.erase(it);
+        m_nextIndex++;
+    }
+    return true;
+}
+
+void ChunkSink::reset()
+{
+    m_pending.clear();
+    m_accepted.clear();
+    m_nextIndex = 1;
+    m_firstIndex = 1;
+    m_pendingBytes = 0;
+}
+
+void ChunkSink::skipTo(qint64 nextIndex)
+{
+    m_nextIndex = nextIndex;
+    m_firstIndex = nextIndex;
+}
+
+bool ChunkSink::sync()
+{
+    auto *file = qobject_cast<QFileDevice *>(m_device);
+    if (!file || !file->isOpen() || !file->flush()) return false;
+#ifdef Q_OS_WIN
+    return ::_commit(file->handle()) == 0;
+#else
+    return ::fsync(file->handle()) == 0;
+#endif
+}
+
+void ChunkSink::write(const QByteArray &data)
+{
+    if (m_device && m_device->isOpen()) m_device->write(data);
+}
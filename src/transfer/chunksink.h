@@ -0,0 +1,52 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+
+class QIODevice;
+
+// Receiver-side reorder buffer: chunks arrive out of order from parallel
+// downloads and are written to the device strictly by index, starting at 1.
+// A chunk ahead of the next index waits in memory until the gap is filled.
+class ChunkSink
+{
+public:
+    // The device is not owned. Chunks are still accepted and tracked while
+    // no device is set or it is closed; they are just not written.
+    void setDevice(QIODevice *device) { m_device = device; }
+    QIODevice *device() const { return m_device; }
+
+    // Returns false for an index that was already accepted
+    bool accept(qint64 index, const QByteArray &data);
+    void reset();
+    // Chunks below nextIndex are on the device already (a transfer resumed
+    // after a restart): they count as accepted and are never written again.
+    // Call before the first accept().
+    void skipTo(qint64 nextIndex);
+    // Flushes the device and has the OS put it on the disk, so that what
+    // was written survives a power loss. False if the device is not a file
+    // or either step fails.
+    bool sync();
+
+    bool contains(qint64 index) const { return index < m_firstIndex || m_accepted.contains(index); }
+    bool isEmpty() const { return m_firstIndex == 1 && m_accepted.isEmpty(); }
+    qint64 acceptedCount() const { return m_firstIndex - 1 + m_accepted.size(); }
+    qint64 nextIndex() const { return m_nextIndex; }
+    int pendingCount() const { return m_pending.size(); }
+    qint64 pendingBytes() const { return m_pendingBytes; }
+
+private:
+    void write(const QByteArray &data);
+
+    QIODevice *m_device = nullptr;
+    QMap<qint64, QByteArray> m_pending;  // out-of-order chunks waiting for the gap
+    QSet<qint64> m_accepted;             // written or pending
+    qint64 m_nextIndex = 1;
+    qint64 m_firstIndex = 1;             // from skipTo()
+    qint64 m_pendingBytes = 0;
+};
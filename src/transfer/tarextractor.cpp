@@ -0,0 +1,306 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "tarextractor.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+namespace {
+
+constexpr qint64 BLOCK = 512;
+constexpr qint64 MAX_LONG_NAME = 64 * 1024;
+
+qint64 padding(qint64 size)
+{
+    return (BLOCK - size % BLOCK) % BLOCK;
+}
+
+QByteArray field(const char *h, int offset, int width)
+{
+    const QByteArray raw(h + offset, width);
+    const qsizetype end = raw.indexOf('\0');
+    return end < 0 ? raw : raw.left(end);
+}
+
+// Octal, optionally space-padded, or GNU base-256 when the top bit is set
+qint64 number(const char *h, int offset, int width, bool *ok)
+{
+    const auto *bytes = reinterpret_cast<const unsigned char *>(h + offset);
+    if (bytes[0] & 0x80) {
+        qint64 value = 0;
+        for (int i = 1; i < width; ++i) value = (value << 8) | bytes[i];
+        *ok = value >= 0;
+        return value;
+    }
+    const QByteArray digits = field(h, offset, width).trimmed();
+    if (digits.isEmpty()) {
+        *ok = true;
+        return 0;
+    }
+    return digits.toLongLong(ok, 8);
+}
+
+bool checksumMatches(const QByteArray &block)
+{
+    bool ok = false;
+    const qint64 stored = number(block.constData(), 148, 8, &ok);
+    if (!ok) return false;
+    qint64 sum = 0;
+    for (int i = 0; i < BLOCK; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(block.at(i));
+    }
+    return sum == stored;
+}
+
+} // namespace
+
+TarExtractor::TarExtractor(const QString &rootPath, QObject *parent)
+    : QIODevice(parent)
+    , m_root(rootPath)
+{
+}
+
+bool TarExtractor::open(OpenMode mode)
+{
+    if ((mode & ReadWrite) != WriteOnly) return false;
+    m_state = State::Header;
+    m_block.clear();
+    m_left = 0;
+    m_padLeft = 0;
+    m_zeroBlocks = 0;
+    m_longName.clear();
+    m_topLevel.clear();
+    m_topLevelSeen.clear();
+    return QIODevice::open(mode | Unbuffered);
+}
+
+void TarExtractor::close()
+{
+    // A file cut short by a failed or cancelled transfer stays partial; the
+    // caller owns the root and removes it
+    m_file.close();
+    QIODevice::close();
+}
+
+qint64 TarExtractor::readData(char *, qint64)
+{
+    return -1;
+}
+
+qint64 TarExtractor::writeData(const char *data, qint64 maxSize)
+{
+    qint64 pos = 0;
+    while (pos < maxSize) {
+        const qint64 available = maxSize - pos;
+        switch (m_state) {
+        case State::Header: {
+            const qint64 n = qMin(available, BLOCK - m_block.size());
+            m_block.append(data + pos, n);
+            pos += n;
+            if (m_block.size() == BLOCK) processHeader();
+            break;
+        }
+        case State::LongName:
+        case State::Data:
+        case State::Skip:
+            if (m_left > 0) {
+                const qint64 n = qMin(available, m_left);
+                if (m_state == State::LongName) {
+                    m_block.append(data + pos, n);
+                } else if (m_state == State::Data && m_file.write(data + pos, n) != n) {
+                    fail(QStringLiteral("Cannot write %1: %2").arg(m_file.fileName(), m_file.errorString()));
+                    return -1;
+                }
+                m_left -= n;
+                pos += n;
+            } else {
+                const qint64 n = qMin(available, m_padLeft);
+                m_padLeft -= n;
+                pos += n;
+            }
+            if (m_left == 0 && m_padLeft == 0) {
+                if (m_state == State::Data) finishEntry();
+                if (m_state == State::LongName) {
+                    const qsizetype end = m_block.indexOf('\0');
+                    m_longName = QString::fromUtf8(end < 0 ? m_block : m_block.left(end));
+                    m_block.clear();
+                }
+                m_state = State::Header;
+            }
+            break;
+        case State::Done:
+            // Trailing zero records up to the sender's block boundary
+            return maxSize;
+        case State::Failed:
+            return -1;
+        }
+        if (m_state == State::Failed) return -1;
+    }
+    return maxSize;
+}
+
+void TarExtractor::processHeader()
+{
+    const QByteArray block = m_block;
+    m_block.clear();
+
+    if (block.count('\0') == BLOCK) {
+        if (++m_zeroBlocks == 2) m_state = State::Done;
+        return;
+    }
+    m_zeroBlocks = 0;
+
+    if (!checksumMatches(block)) {
+        fail(QStringLiteral("Corrupt archive header"));
+        return;
+    }
+
+    const char *h = block.constData();
+    bool sizeOk = false;
+    bool mtimeOk = false;
+    bool modeOk = false;
+    const qint64 size = number(h, 124, 12, &sizeOk);
+    const qint64 mtime = number(h, 136, 12, &mtimeOk);
+    const int mode = static_cast<int>(number(h, 100, 8, &modeOk));
+    if (!sizeOk || size < 0) {
+        fail(QStringLiteral("Corrupt archive header"));
+        return;
+    }
+    const char type = h[156];
+
+    if (type == 'L') {
+        if (size > MAX_LONG_NAME) {
+            fail(QStringLiteral("Archive name too long"));
+            return;
+        }
+        m_state = State::LongName;
+        m_left = size;
+        m_padLeft = padding(size);
+        return;
+    }
+
+    QString name;
+    if (!m_longName.isEmpty()) {
+        name = m_longName;
+        m_longName.clear();
+    } else {
+        name = QString::fromUtf8(field(h, 0, 100));
+        // POSIX ustar keeps the leading part of long names in the prefix field
+        const QByteArray prefix = field(h, 345, 155);
+        if (field(h, 257, 6) == "ustar" && !prefix.isEmpty()) name = QString::fromUtf8(prefix) + '/' + name;
+    }
+
+    startEntry(name, type, size, mtimeOk ? mtime : 0, modeOk ? mode : 0);
+}
+
+void TarExtractor::startEntry(const QString &name, char type, qint64 size, qint64 mtime, int mode)
+{
+    m_left = size;
+    m_padLeft = padding(size);
+
+    const bool isFile = type == '0' || type == '\0' || type == '7';
+    const bool isDir = type == '5';
+    if (!isFile && !isDir) {
+        // pax headers, links, devices: nothing to create
+        qWarning() << "TarExtractor: skipping entry of type" << type << name;
+        m_state = State::Skip;
+        return;
+    }
+
+    const QString path = safePath(name);
+    if (path.isEmpty()) {
+        fail(QStringLiteral("Unsafe path in archive: %1").arg(name));
+        return;
+    }
+
+    const QString top = m_root.relativeFilePath(path).section('/', 0, 0);
+    if (!m_topLevelSeen.contains(top)) {
+        m_topLevelSeen.insert(top);
+        m_topLevel << top;
+    }
+
+    if (isDir) {
+        if (!m_root.mkpath(path)) {
+            fail(QStringLiteral("Cannot create folder %1").arg(path));
+            return;
+        }
+        m_state = State::Skip;
+        return;
+    }
+
+    m_root.mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fail(QStringLiteral("Cannot create %1: %2").arg(path, m_file.errorString()));
+        return;
+    }
+    m_fileMtime = mtime;
+    m_fileMode = mode;
+    m_state = State::Data;
+    if (size == 0) {
+        finishEntry();
+        m_state = State::Header;
+    }
+}
+
+void TarExtractor::finishEntry()
+{
+    if (m_fileMtime > 0) {
+        m_file.setFileTime(QDateTime::fromSecsSinceEpoch(m_fileMtime), QFileDevice::FileModificationTime);
+    }
+    m_file.close();
+    if (m_fileMode & 0111) {
+        m_file.setPermissions(m_file.permissions() | QFileDevice::ExeOwner | QFileDevice::ExeGroup
+                              | QFileDevice::ExeOther);
+    }
+}
+
+QString TarExtractor::safePath(const QString &name) const
+{
+    // Absolute, or a drive on Windows ("C:", "C:foo" is relative to that
+    // drive's current folder). Colons elsewhere are ordinary characters.
+    static const QRegularExpression drive(QStringLiteral("^[A-Za-z]:"));
+    if (name.startsWith('/') || drive.match(name).hasMatch()) return {};
+
+    QStringList parts;
+    for (const QString &part : name.split('/', Qt::SkipEmptyParts)) {
+        if (part == "..") return {};
+        if (part != ".") parts << localName(part);
+    }
+    if (parts.isEmpty()) return {};
+
+    const QString root = m_root.absolutePath();
+    const QString path = QDir::cleanPath(root + '/' + parts.join('/'));
+    return path.startsWith(root + '/') ? path : QString();
+}
+
+QString TarExtractor::localName(const QString &part)
+{
+#ifdef Q_OS_WIN
+    // Characters Windows does not allow in a name, the separator among
+    // them, become '_' rather than failing an archive packed elsewhere.
+    // Reserved device names and trailing dots or spaces are changed too.
+    static const QRegularExpression reserved(QStringLiteral("[<>:\"|?*\\\\\\x00-\\x1f]"));
+    static const QRegularExpression device(QStringLiteral("^(CON|PRN|AUX|NUL|COM[1-9]|LPT[1-9])(\\..*)?$"),
+                                           QRegularExpression::CaseInsensitiveOption);
+    QString local = part;
+    local.replace(reserved, QStringLiteral("_"));
+    while (local.endsWith('.') || local.endsWith(' ')) local.chop(1);
+    if (local.isEmpty() || device.match(local).hasMatch()) local.prepend('_');
+    return local;
+#else
+    return part;
+#endif
+}
+
+void TarExtractor::fail(const QString &reason)
+{
+    qWarning().noquote() << "TarExtractor:" << reason;
+    setErrorString(reason);
+    m_file.close();
+    m_state = State::Failed;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QIODevice>
+#include <QSet>
+#include <QStringList>
+
+// Write-only device that unpacks a tar stream into a directory as it
+// arrives, so a received archive never exists on disk as a whole. Reads
+// what TarSource writes plus plain POSIX ustar (prefix field); pax headers,
+// links and special files are skipped. Names that would land outside the
+// root (absolute, "..", drive letters) fail the stream; on Windows,
+// characters it does not allow in names are replaced.
+class TarExtractor : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit TarExtractor(const QString &rootPath, QObject *parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return true; }
+
+    // The end-of-archive marker was seen
+    bool isFinished() const { return m_state == State::Done; }
+    bool hasFailed() const { return m_state == State::Failed; }
+
+    // First path components in archive order, e.g. {"photos", "notes.txt"}
+    QStringList topLevelEntries() const { return m_topLevel; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    enum class State { Header, LongName, Data, Skip, Done, Failed };
+
+    void processHeader();
+    void startEntry(const QString &name, char type, qint64 size, qint64 mtime, int mode);
+    void finishEntry();
+    QString safePath(const QString &name) const;
+    static QString localName(const QString &part);
+    void fail(const QString &reason);
+
+    QDir m_root;
+    State m_state = State::Header;
+    QByteArray m_block;       // partial header or long name
+    qint64 m_left = 0;        // data bytes left in the current entry
+    qint64 m_padLeft = 0;     // padding after the data
+    int m_zeroBlocks = 0;
+    QString m_longName;       // from a preceding ././@LongLink entry
+    QFile m_file;
+    qint64 m_fileMtime = 0;
+    int m_fileMode = 0;
+    QStringList m_topLevel;
+    QSet<QString> m_topLevelSeen;
+};
@@ -0,0 +1,252 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "tarsource.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+
+#include <cstring>
+
+namespace {
+
+constexpr qint64 BLOCK = 512;
+constexpr qsizetype NAME_FIELD = 100;
+
+qint64 padding(qint64 size)
+{
+    return (BLOCK - size % BLOCK) % BLOCK;
+}
+
+void putOctal(char *field, int width, qint64 value)
+{
+    const QByteArray digits = QByteArray::number(value, 8).rightJustified(width - 1, '0');
+    std::memcpy(field, digits.constData(), width - 1);
+    field[width - 1] = '\0';
+}
+
+// Octal when it fits, GNU base-256 (big-endian, top bit set) when not
+void putNumber(char *field, int width, qint64 value)
+{
+    if (value < (qint64(1) << (3 * (width - 1)))) {
+        putOctal(field, width, value);
+        return;
+    }
+    field[0] = static_cast<char>(0x80);
+    for (int i = width - 1; i > 0; --i) {
+        field[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+}
+
+QByteArray header(const QByteArray &name, qint64 size, qint64 mtime, char type, int mode)
+{
+    QByteArray block(BLOCK, '\0');
+    char *h = block.data();
+    std::memcpy(h, name.constData(), qMin(name.size(), NAME_FIELD));
+    putOctal(h + 100, 8, mode);
+    putOctal(h + 108, 8, 0);                 // uid
+    putOctal(h + 116, 8, 0);                 // gid
+    putNumber(h + 124, 12, size);
+    putNumber(h + 136, 12, mtime);
+    std::memset(h + 148, ' ', 8);            // checksum counts as spaces
+    h[156] = type;
+    std::memcpy(h + 257, "ustar  ", 8);      // GNU magic and version
+
+    unsigned int sum = 0;
+    for (const char c : block) sum += static_cast<unsigned char>(c);
+    putOctal(h + 148, 7, sum);
+    h[155] = ' ';
+    return block;
+}
+
+QByteArray archiveName(const TarSource::Entry &entry)
+{
+    return (entry.isDir ? entry.name + '/' : entry.name).toUtf8();
+}
+
+qint64 headerSize(const TarSource::Entry &entry)
+{
+    const qint64 nameBytes = archiveName(entry).size();
+    const qint64 longLink = nameBytes > NAME_FIELD ? BLOCK + nameBytes + 1 + padding(nameBytes + 1) : 0;
+    return longLink + BLOCK;
+}
+
+void collectInto(const QFileInfo &info, const QDir &base, QList<TarSource::Entry> &entries)
+{
+    if (info.isSymLink()) return;
+
+    TarSource::Entry entry;
+    entry.path = info.absoluteFilePath();
+    entry.name = base.relativeFilePath(entry.path);
+    entry.mtime = qMax<qint64>(0, info.lastModified().toSecsSinceEpoch());
+
+    if (info.isDir()) {
+        entry.isDir = true;
+        entries << entry;
+        const QFileInfoList children = QDir(entry.path).entryInfoList(
+            QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks, QDir::Name);
+        for (const QFileInfo &child : children) collectInto(child, base, entries);
+    } else if (info.isFile()) {
+        entry.size = info.size();
+        entry.executable = info.isExecutable();
+        entries << entry;
+    }
+}
+
+// "name (2).ext", "name (3).ext"... for the first one not taken yet.
+// Compared without case: the receiver's file system may not tell them apart.
+QString uniqueName(const QString &name, bool isDir, const QSet<QString> &taken)
+{
+    if (!taken.contains(name.toLower())) return name;
+    const QFileInfo info(name);
+    const bool split = !isDir && !info.suffix().isEmpty() && !info.completeBaseName().isEmpty();
+    for (int n = 2;; ++n) {
+        const QString candidate = split
+            ? QStringLiteral("%1 (%2).%3").arg(info.completeBaseName()).arg(n).arg(info.suffix())
+            : QStringLiteral("%1 (%2)").arg(name).arg(n);
+        if (!taken.contains(candidate.toLower())) return candidate;
+    }
+}
+
+} // namespace
+
+QList<TarSource::Entry> TarSource::collect(const QStringList &roots)
+{
+    QList<Entry> entries;
+    QSet<QString> paths;
+    QSet<QString> taken;
+    for (const QString &root : roots) {
+        const QFileInfo info(root);
+        if (paths.contains(info.absoluteFilePath())) continue;
+        paths.insert(info.absoluteFilePath());
+
+        const qsizetype first = entries.size();
+        collectInto(info, info.absoluteDir(), entries);
+        if (entries.size() == first) continue;
+
+        // Names are relative to each root's own folder, so two roots from
+        // different folders can share one and would overwrite each other
+        // when unpacked
+        const QString name = info.fileName();
+        const QString unique = uniqueName(name, info.isDir(), taken);
+        taken.insert(unique.toLower());
+        if (unique == name) continue;
+        for (qsizetype i = first; i < entries.size(); ++i) {
+            entries[i].name = unique + entries[i].name.mid(name.size());
+        }
+    }
+    return entries;
+}
+
+qint64 TarSource::archiveSize(const QList<Entry> &entries)
+{
+    qint64 total = 2 * BLOCK;  // end-of-archive marker
+    for (const Entry &entry : entries) total += headerSize(entry) + entry.size + padding(entry.size);
+    return total;
+}
+
+TarSource::TarSource(const QList<Entry> &entries, QObject *parent)
+    : QIODevice(parent)
+    , m_entries(entries)
+    , m_totalSize(archiveSize(entries))
+{
+}
+
+bool TarSource::open(OpenMode mode)
+{
+    if ((mode & ReadWrite) != ReadOnly) return false;
+    m_produced = 0;
+    m_nextEntry = 0;
+    m_block.clear();
+    m_blockPos = 0;
+    m_dataLeft = 0;
+    m_padLeft = 0;
+    m_trailerQueued = false;
+    return QIODevice::open(mode | Unbuffered);
+}
+
+void TarSource::close()
+{
+    m_file.close();
+    QIODevice::close();
+}
+
+qint64 TarSource::bytesAvailable() const
+{
+    return m_totalSize - m_produced + QIODevice::bytesAvailable();
+}
+
+void TarSource::startEntry(const Entry &entry)
+{
+    const QByteArray name = archiveName(entry);
+    const int mode = entry.isDir || entry.executable ? 0755 : 0644;
+
+    m_block.clear();
+    m_blockPos = 0;
+    if (name.size() > NAME_FIELD) {
+        m_block += header("././@LongLink", name.size() + 1, 0, 'L', 0644);
+        m_block += name;
+        m_block += QByteArray(1 + padding(name.size() + 1), '\0');
+    }
+    m_block += header(name, entry.size, entry.mtime, entry.isDir ? '5' : '0', mode);
+
+    m_dataLeft = entry.size;
+    m_padLeft = padding(entry.size);
+    if (!entry.isDir) {
+        m_file.setFileName(entry.path);
+        if (!m_file.open(QIODevice::ReadOnly)) qWarning() << "TarSource: cannot read" << entry.path;
+    }
+}
+
+qint64 TarSource::readData(char *data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize) {
+        if (m_blockPos < m_block.size()) {
+            const qint64 n = qMin<qint64>(maxSize - done, m_block.size() - m_blockPos);
+            std::memcpy(data + done, m_block.constData() + m_blockPos, n);
+            m_blockPos += n;
+            done += n;
+        } else if (m_dataLeft > 0) {
+            const qint64 n = qMin(maxSize - done, m_dataLeft);
+            qint64 got = m_file.isOpen() ? m_file.read(data + done, n) : -1;
+            if (got <= 0) {
+                // The header already promised the size: a file that shrank or
+                // failed to open is zero-filled, one that grew is cut
+                if (m_file.isOpen()) qWarning() << "TarSource: short read from" << m_file.fileName();
+                m_file.close();
+                std::memset(data + done, 0, n);
+                got = n;
+            }
+            m_dataLeft -= got;
+            done += got;
+        } else if (m_padLeft > 0) {
+            const qint64 n = qMin(maxSize - done, m_padLeft);
+            std::memset(data + done, 0, n);
+            m_padLeft -= n;
+            done += n;
+        } else if (m_nextEntry < m_entries.size()) {
+            m_file.close();
+            startEntry(m_entries[m_nextEntry++]);
+        } else if (!m_trailerQueued) {
+            m_file.close();
+            m_block = QByteArray(2 * BLOCK, '\0');
+            m_blockPos = 0;
+            m_trailerQueued = true;
+        } else {
+            break;
+        }
+    }
+    m_produced += done;
+    return done;
+}
+
+qint64 TarSource::writeData(const char *, qint64)
+{
+    return -1;
+}
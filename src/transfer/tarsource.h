@@ -0,0 +1,66 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QFile>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+// Read-only device that produces a tar archive (GNU format: ustar headers,
+// ././@LongLink for names over 100 bytes, base-256 for sizes over 8 GiB)
+// of a list of files and directories on the fly. Nothing is staged on
+// disk; each file is opened when its data is reached. The total size is
+// known up front, so it can stand in for a regular file in the upload.
+class TarSource : public QIODevice
+{
+    Q_OBJECT
+public:
+    struct Entry
+    {
+        QString path;        // on disk
+        QString name;        // in the archive, '/'-separated
+        qint64 size = 0;
+        qint64 mtime = 0;    // seconds since the epoch
+        bool isDir = false;
+        bool executable = false;
+    };
+
+    // Walks the roots (files or directories) depth-first, sorted by name.
+    // Names are relative to each root's parent, so a folder "photos" is
+    // archived as "photos/...". Roots sharing a name get " (2)", " (3)"...
+    // and a root given twice is walked once. Symlinks and special files
+    // are skipped.
+    static QList<Entry> collect(const QStringList &roots);
+    static qint64 archiveSize(const QList<Entry> &entries);
+
+    explicit TarSource(const QList<Entry> &entries, QObject *parent = nullptr);
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override { return true; }
+    qint64 size() const override { return m_totalSize; }
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    void startEntry(const Entry &entry);
+
+    QList<Entry> m_entries;
+    qint64 m_totalSize = 0;
+    qint64 m_produced = 0;
+
+    int m_nextEntry = 0;
+    QByteArray m_block;           // headers, or the end-of-archive blocks
+    qsizetype m_blockPos = 0;
+    QFile m_file;                 // data of the current entry
+    qint64 m_dataLeft = 0;
+    qint64 m_padLeft = 0;
+    bool m_trailerQueued = false;
+};
@@ -0,0 +1,130 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "transferjournal.h"
+#include "crypto/crypto.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr auto KEY_SETTING = "transfer/journal_key";
+constexpr auto FILE_NAME = "transfer.journal";
+}
+
+TransferJournal::TransferJournal(QSettings &settings)
+    : m_settings(settings)
+    , m_path(QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(FILE_NAME))
+{
+}
+
+QByteArray TransferJournal::digest(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Blake2b_256);
+}
+
+QByteArray TransferJournal::chainDigest(const QByteArray &chain, const QByteArray &chunkDigest)
+{
+    return digest(chain + chunkDigest);
+}
+
+TransferJournal::Entry TransferJournal::load() const
+{
+    const QByteArray key = Crypto::base64UrlToKey(m_settings.value(KEY_SETTING).toString());
+    if (key.isEmpty()) return {};
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    const QByteArray plain = Crypto::decrypt(file.readAll(), key);
+    if (plain.isEmpty()) {
+        qWarning() << "TransferJournal: cannot open" << m_path << "- ignoring it";
+        return {};
+    }
+    const QJsonObject json = QJsonDocument::fromJson(plain).object();
+
+    Entry entry;
+    entry.server = json["server"].toString();
+    entry.sessionId = json["session_id"].toString();
+    entry.sender = json["sender"].toBool();
+    entry.clientId = json["client_id"].toString();
+    for (const QJsonValue &raw : json["cookies"].toArray()) {
+        entry.cookies += QNetworkCookie::parseCookies(raw.toString().toUtf8());
+    }
+    entry.key = Crypto::base64UrlToKey(json["key"].toString());
+    entry.cipher = json["cipher"].toInt();
+    entry.nonceMode = json["nonce_mode"].toInt();
+    entry.compression = json["compression"].toInt();
+    entry.compressionLevel = json["compression_level"].toInt();
+    entry.fileName = json["file_name"].toString();
+    entry.fileSize = json["file_size"].toInteger();
+    entry.chunkPayload = json["chunk_payload"].toInteger();
+    entry.filePath = json["file_path"].toString();
+    entry.fileMtime = json["file_mtime"].toInteger();
+    entry.tmpPath = json["tmp_path"].toString();
+    entry.sentChunks = json["sent_chunks"].toInteger();
+    entry.sentDigest = QByteArray::fromBase64(json["sent_digest"].toString().toLatin1());
+    entry.sealedDigest = QByteArray::fromBase64(json["sealed_digest"].toString().toLatin1());
+    return entry;
+}
+
+bool TransferJournal::store(const Entry &entry)
+{
+    QByteArray key = Crypto::base64UrlToKey(m_settings.value(KEY_SETTING).toString());
+    if (key.isEmpty()) {
+        key = Crypto::generateKey();
+        m_settings.setValue(KEY_SETTING, Crypto::keyToBase64Url(key));
+    }
+
+    QJsonArray cookies;
+    for (const QNetworkCookie &cookie : entry.cookies) {
+        cookies.append(QString::fromUtf8(cookie.toRawForm(QNetworkCookie::Full)));
+    }
+    const QJsonObject json{
+        {"server", entry.server},
+        {"session_id", entry.sessionId},
+        {"sender", entry.sender},
+        {"client_id", entry.clientId},
+        {"cookies", cookies},
+        {"key", Crypto::keyToBase64Url(entry.key)},
+        {"cipher", entry.cipher},
+        {"nonce_mode", entry.nonceMode},
+        {"compression", entry.compression},
+        {"compression_level", entry.compressionLevel},
+        {"file_name", entry.fileName},
+        {"file_size", entry.fileSize},
+        {"chunk_payload", entry.chunkPayload},
+        {"file_path", entry.filePath},
+        {"file_mtime", entry.fileMtime},
+        {"tmp_path", entry.tmpPath},
+        {"sent_chunks", entry.sentChunks},
+        {"sent_digest", QString::fromLatin1(entry.sentDigest.toBase64())},
+        {"sealed_digest", QString::fromLatin1(entry.sealedDigest.toBase64())},
+    };
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "TransferJournal: cannot write" << m_path;
+        return false;
+    }
+    file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    file.write(Crypto::encrypt(QJsonDocument(json).toJson(QJsonDocument::Compact), key));
+    if (!file.commit()) {
+        qWarning() << "TransferJournal: cannot write" << m_path;
+        return false;
+    }
+    return true;
+}
+
+void TransferJournal::remove()
+{
+    QFile::remove(m_path);
+}
@@ -0,0 +1,76 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QNetworkCookie>
+#include <QSettings>
+#include <QString>
+
+// What it takes to pick up the transfer in progress after a crash or a
+// restart: the session and the identity that is in it, the key, and where
+// the data lives. Written when the transfer starts and removed when it
+// ends. A sender writes it again as chunks go out, with a digest of
+// everything sent so far and, in counter mode, of the last sealed chunk: a
+// resume checks the file against them. In counter mode it is written before
+// each chunk, so a resume never seals different bytes under a nonce that
+// was used; random nonces let it trail behind. The receiver's progress is
+// the length of its temporary file, so it cannot lag behind the data.
+// Sealed like IdentityCache, under its own key in QSettings.
+class TransferJournal
+{
+public:
+    struct Entry
+    {
+        QString server;
+        QString sessionId;
+        bool sender = false;
+        QString clientId;
+        QList<QNetworkCookie> cookies;
+
+        QByteArray key;
+        int cipher = 0;       // Crypto::Cipher
+        int nonceMode = 0;    // Crypto::NonceMode
+        int compression = 0;  // ChunkCodec::Method
+        int compressionLevel = 0;
+
+        QString fileName;
+        qint64 fileSize = 0;
+        qint64 chunkPayload = 0;  // plaintext per full chunk, from start_init
+        QString filePath;         // sender: the file being sent
+        qint64 fileMtime = 0;     // sender: ms since the epoch
+        QString tmpPath;          // receiver: chunks written so far, in order
+
+        // Sender: chunks 1..sentChunks went out. sentDigest chains the
+        // digests of their plaintext; sealedDigest is of the last one as sent
+        // (counter mode only).
+        qint64 sentChunks = 0;
+        QByteArray sentDigest;
+        QByteArray sealedDigest;
+
+        bool isValid() const
+        {
+            return !server.isEmpty() && !sessionId.isEmpty() && !clientId.isEmpty()
+                && !cookies.isEmpty() && !key.isEmpty() && chunkPayload > 0;
+        }
+    };
+
+    explicit TransferJournal(QSettings &settings);
+
+    // The digests: one per chunk, chained so that a single value covers
+    // every chunk sent
+    static QByteArray digest(const QByteArray &data);
+    static QByteArray chainDigest(const QByteArray &chain, const QByteArray &chunkDigest);
+
+    Entry load() const;
+    bool store(const Entry &entry);
+    void remove();
+
+private:
+    QSettings &m_settings;
+    QString m_path;
+};
@@ -0,0 +1,148 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "benchcommon.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTimer>
+
+#include <algorithm>
+#include <memory>
+
+#include "appcontroller.h"
+#include "client/session/sessionmanager.h"
+
+QByteArray Bench::fileDigest(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return {};
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&file);
+    return hash.result();
+}
+
+bool Bench::writeRandomFile(const QString &path, qint64 size)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray block(MIB, Qt::Uninitialized);
+    for (qint64 left = size; left > 0; left -= block.size()) {
+        QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(block.data()), block.size() / 4);
+        file.write(block.constData(), qMin<qint64>(left, block.size()));
+    }
+    return true;
+}
+
+void Bench::isolateSettings()
+{
+    static QTemporaryDir dir;
+    QStandardPaths::setTestModeEnabled(true);
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, dir.path());
+    QSettings::setPath(QSettings::IniFormat, QSettings::SystemScope, dir.path());
+}
+
+double Bench::megabytesPerSec(qint64 bytes, qint64 ms)
+{
+    return ms > 0 ? bytes / 1e6 / (ms / 1000.0) : 0.0;
+}
+
+bool Bench::TransferResult::ok() const
+{
+    if (timedOut) return false;
+    return std::all_of(receivers.begin(), receivers.end(), [](const ReceiverResult &r) {
+        return r.status == "ok" && r.intact;
+    });
+}
+
+Bench::TransferResult Bench::runTransfer(const QString &serverUrl, const QString &inputPath,
+                                         const QByteArray &digest, const QString &workDir,
+                                         int receiverCount, int timeoutSecs)
+{
+    TransferResult result;
+    result.receivers.resize(receiverCount);
+
+    QEventLoop loop;
+    QElapsedTimer clock;
+    int finished = 0;
+    bool freezeDropped = false;
+
+    // All controllers share one settings file; a cached identity would
+    // have the receivers join as the sender
+    QSettings().setValue("identity/remember", false);
+    // Likewise one journal: the controllers would overwrite each other's
+    QSettings().setValue("transfer/journal", false);
+    // The receivers stand in for separate clients, so they must not share
+    // one download budget the way sessions of a single client do
+    SessionManager::instance().setMaxParallelDownloads(0);
+
+    AppController sender;
+    sender.saveSettings(serverUrl, QStringLiteral("bench-sender"), QStringLiteral("en"),
+                        QStringLiteral("none"), QString(), 0, false, false, false);
+
+    std::vector<std::unique_ptr<AppController>> receivers;
+    for (int i = 0; i < receiverCount; ++i) {
+        receivers.push_back(std::make_unique<AppController>());
+        AppController *receiver = receivers.back().get();
+        const QString outputPath = QStringLiteral("%1/received-%2.bin").arg(workDir).arg(i);
+
+        QObject::connect(receiver, &AppController::chunksConfirmedChanged, &loop, [&clock, &result, i, receiver]() {
+            ReceiverResult &outcome = result.receivers[i];
+            if (outcome.ttfbMs < 0 && receiver->chunksConfirmed() > 0) outcome.ttfbMs = clock.elapsed();
+        });
+        QObject::connect(receiver, &AppController::screenChanged, &loop,
+                         [&, i, receiver, outputPath]() {
+            ReceiverResult &outcome = result.receivers[i];
+            if (receiver->screen() != "complete" || outcome.doneMs >= 0) return;
+            outcome.doneMs = clock.elapsed();
+            outcome.status = receiver->completeStatus();
+            if (receiver->hasDownloadedFile()) {
+                receiver->saveReceivedFile(QUrl::fromLocalFile(outputPath));
+                outcome.intact = (fileDigest(outputPath) == digest);
+                QFile::remove(outputPath);
+            }
+            if (++finished == receiverCount) loop.quit();
+        });
+    }
+    // Receivers join once the link exists; the freeze is dropped by hand as
+    // soon as all of them are in, so nobody misses the first chunks.
+    QObject::connect(&sender, &AppController::shareLinkChanged, &loop, [&]() {
+        if (sender.shareLink().isEmpty() || clock.isValid()) return;
+        clock.start();
+        for (auto &receiver : receivers) receiver->startReceive(sender.shareLink());
+    });
+    QObject::connect(&sender, &AppController::receiversChanged, &loop, [&]() {
+        if (freezeDropped || sender.receivers().size() < receiverCount) return;
+        freezeDropped = true;
+        sender.dropFreeze();
+    });
+    QObject::connect(&sender, &AppController::errorMsgChanged, &loop, [&]() {
+        if (sender.errorMsg().isEmpty()) return;
+        qWarning().noquote() << "Sender error:" << sender.errorMsg();
+        loop.quit();
+    });
+
+    QTimer::singleShot(timeoutSecs * 1000, &loop, [&]() {
+        result.timedOut = true;
+        loop.quit();
+    });
+
+    sender.startSend();
+    sender.selectFile(QUrl::fromLocalFile(inputPath));
+    loop.exec();
+
+    for (const auto &receiver : result.receivers) {
+        result.elapsedMs = qMax(result.elapsedMs, receiver.doneMs);
+    }
+    return result;
+}
@@ -0,0 +1,51 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <vector>
+
+// Helpers shared by the benchmarks in tools/bench
+namespace Bench {
+
+constexpr qint64 MIB = 1024 * 1024;
+
+QByteArray fileDigest(const QString &path);
+bool writeRandomFile(const QString &path, qint64 size);
+double megabytesPerSec(qint64 bytes, qint64 ms);
+
+// Points QSettings (as an INI file) and QStandardPaths at a temporary
+// directory removed at exit, so a run neither reads nor rewrites the
+// user's config, whatever the platform's native format. Call it before
+// the first AppController or SessionManager::instance().
+void isolateSettings();
+
+struct ReceiverResult
+{
+    qint64 ttfbMs = -1;
+    qint64 doneMs = -1;
+    QString status;
+    bool intact = false;
+};
+
+struct TransferResult
+{
+    qint64 elapsedMs = 0;
+    std::vector<ReceiverResult> receivers;
+    bool timedOut = false;
+
+    bool ok() const;
+};
+
+// One sender and `receivers` receivers, each a real AppController, move
+// inputPath through serverUrl. The clock starts when the share link is
+// ready; the freeze is dropped once everyone has joined. Received files
+// are checked against digest and removed.
+TransferResult runTransfer(const QString &serverUrl, const QString &inputPath, const QByteArray &digest,
+                           const QString &workDir, int receivers, int timeoutSecs);
+
+} // namespace Bench
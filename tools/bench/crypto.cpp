@@ -0,0 +1,307 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+// Crypto microbenchmarks: key generation, nonce generation and chunk
+// encrypt/decrypt at sizes from 4 KiB to 16 MiB. Every variant is a row in
+// VARIANTS, so alternative APIs can be compared against the current one by
+// adding a row. The "-raw" rows call libsodium into preallocated buffers and
+// show what the QByteArray handling in Crypto:: costs. The "-aes" rows are
+// skipped on CPUs without AES instructions; "-ctr" is counter-nonce mode.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <sodium.h>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "procstats.h"
+
+namespace {
+
+constexpr qint64 KIB = 1024;
+
+using Body = std::function<void()>;
+
+// One benchmarked operation. prepare() runs untimed and returns the body
+// that is timed; sized variants are run once per --sizes entry. A variant
+// is skipped when its cipher is not available.
+struct Variant
+{
+    const char *name;
+    bool sized;
+    Crypto::Cipher cipher;
+    std::function<Body(qint64 size)> prepare;
+};
+
+constexpr auto XCHACHA = Crypto::Cipher::XChaCha20Poly1305;
+constexpr auto AES = Crypto::Cipher::Aes256Gcm;
+
+QByteArray randomBytes(qint64 size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    randombytes_buf(data.data(), static_cast<size_t>(data.size()));
+    return data;
+}
+
+const std::vector<Variant> VARIANTS = {
+    {"keygen", false, XCHACHA, [](qint64) -> Body {
+        return [] { Crypto::generateKey(); };
+    }},
+    {"nonce", false, XCHACHA, [](qint64) -> Body {
+        return [nonce = QByteArray(crypto_aead_xchacha20poly1305_ietf_NPUBBYTES, Qt::Uninitialized)]() mutable {
+            randombytes_buf(nonce.data(), static_cast<size_t>(nonce.size()));
+        };
+    }},
+    {"encrypt", true, XCHACHA, [](qint64 size) -> Body {
+        return [key = Crypto::generateKey(), plain = randomBytes(size)] {
+            Crypto::encrypt(plain, key, XCHACHA);
+        };
+    }},
+    {"decrypt", true, XCHACHA, [](qint64 size) -> Body {
+        const QByteArray key = Crypto::generateKey();
+        return [key, wire = Crypto::encrypt(randomBytes(size), key, XCHACHA)] {
+            if (Crypto::decrypt(wire, key, XCHACHA).isEmpty()) qFatal("decrypt failed");
+        };
+    }},
+    {"encrypt-aes", true, AES, [](qint64 size) -> Body {
+        return [key = Crypto::generateKey(), plain = randomBytes(size)] {
+            Crypto::encrypt(plain, key, AES);
+        };
+    }},
+    {"decrypt-aes", true, AES, [](qint64 size) -> Body {
+        const QByteArray key = Crypto::generateKey();
+        return [key, wire = Crypto::encrypt(randomBytes(size), key, AES)] {
+            if (Crypto::decrypt(wire, key, AES).isEmpty()) qFatal("decrypt failed");
+        };
+    }},
+    {"encrypt-ctr", true, XCHACHA, [](qint64 size) -> Body {
+        return [key = Crypto::generateKey(), plain = randomBytes(size), index = qint64(0)]() mutable {
+            Crypto::encryptChunk(plain, key, XCHACHA, ++index, false);
+        };
+    }},
+    {"decrypt-ctr", true, XCHACHA, [](qint64 size) -> Body {
+        const QByteArray key = Crypto::generateKey();
+        return [key, wire = Crypto::encryptChunk(randomBytes(size), key, XCHACHA, 1, false)] {
+            if (Crypto::decryptChunk(wire, key, XCHACHA, 1, false).isEmpty()) qFatal("decrypt failed");
+        };
+    }},
+    {"encrypt-raw", true, XCHACHA, [](qint64 size) -> Body {
+        auto key = Crypto::generateKey();
+        auto plain = randomBytes(size);
+        QByteArray out(size + crypto_aead_xchacha20poly1305_ietf_NPUBBYTES
+                       + crypto_aead_xchacha20poly1305_ietf_ABYTES, Qt::Uninitialized);
+        return [key, plain, out]() mutable {
+            auto *nonce = reinterpret_cast<unsigned char *>(out.data());
+            randombytes_buf(nonce, crypto_aead_xchacha20poly1305_ietf_NPUBBYTES);
+            crypto_aead_xchacha20poly1305_ietf_encrypt(
+                nonce + crypto_aead_xchacha20poly1305_ietf_NPUBBYTES, nullptr,
+                reinterpret_cast<const unsigned char *>(plain.constData()), plain.size(),
+                nullptr, 0, nullptr, nonce,
+                reinterpret_cast<const unsigned char *>(key.constData()));
+        };
+    }},
+    {"decrypt-raw", true, XCHACHA, [](qint64 size) -> Body {
+        const QByteArray key = Crypto::generateKey();
+        const QByteArray wire = Crypto::encrypt(randomBytes(size), key);
+        QByteArray out(size, Qt::Uninitialized);
+        return [key, wire, out]() mutable {
+            const auto *nonce = reinterpret_cast<const unsigned char *>(wire.constData());
+            const int ret = crypto_aead_xchacha20poly1305_ietf_decrypt(
+                reinterpret_cast<unsigned char *>(out.data()), nullptr, nullptr,
+                nonce + crypto_aead_xchacha20poly1305_ietf_NPUBBYTES,
+                wire.size() - crypto_aead_xchacha20poly1305_ietf_NPUBBYTES,
+                nullptr, 0, nonce,
+                reinterpret_cast<const unsigned char *>(key.constData()));
+            if (ret != 0) qFatal("decrypt failed");
+        };
+    }},
+};
+
+struct Options
+{
+    std::vector<qint64> sizes;
+    QString filter;
+    int threads = 1;
+    double minSecs = 0.5;
+    int repetitions = 3;
+    QString jsonPath;
+};
+
+struct Sample
+{
+    double wallSecs = 0;
+    double cpuSecs = -1;
+    quint64 allocations = 0;
+};
+
+// Runs iterations x body on every thread (each with its own prepared body)
+Sample measure(const Variant &variant, qint64 size, int threads, qint64 iterations)
+{
+    std::vector<Body> bodies;
+    for (int t = 0; t < threads; ++t) bodies.push_back(variant.prepare(size));
+    auto loop = [iterations](Body &body) {
+        for (qint64 i = 0; i < iterations; ++i) body();
+    };
+
+    Sample sample;
+    const quint64 allocationsBefore = ProcStats::allocationCount();
+    const double cpuBefore = ProcStats::cpuSeconds();
+    QElapsedTimer clock;
+    clock.start();
+    if (threads == 1) {
+        loop(bodies.front());
+    } else {
+        std::vector<std::thread> workers;
+        for (Body &body : bodies) workers.emplace_back(loop, std::ref(body));
+        for (auto &worker : workers) worker.join();
+    }
+    sample.wallSecs = clock.nsecsElapsed() / 1e9;
+    const double cpuAfter = ProcStats::cpuSeconds();
+    if (cpuBefore >= 0 && cpuAfter >= 0) sample.cpuSecs = cpuAfter - cpuBefore;
+    sample.allocations = ProcStats::allocationCount() - allocationsBefore;
+    return sample;
+}
+
+// Grows the iteration count until one sample takes about --min-time
+qint64 calibrate(const Variant &variant, qint64 size, const Options &options)
+{
+    qint64 iterations = 1;
+    for (;;) {
+        const double secs = measure(variant, size, 1, iterations).wallSecs;
+        if (secs >= options.minSecs / 10 || iterations >= (qint64(1) << 32)) {
+            return qMax<qint64>(1, static_cast<qint64>(iterations * options.minSecs / qMax(secs, 1e-9)));
+        }
+        iterations *= 10;
+    }
+}
+
+QString formatSize(qint64 size)
+{
+    if (size <= 0) return QStringLiteral("-");
+    if (size % (KIB * KIB) == 0) return QStringLiteral("%1M").arg(size / (KIB * KIB));
+    if (size % KIB == 0) return QStringLiteral("%1K").arg(size / KIB);
+    return QString::number(size);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-bench-crypto");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Crypto::encrypt/decrypt microbenchmarks.");
+    parser.addHelpOption();
+    const QCommandLineOption sizesOption("sizes", "Comma-separated payload sizes in KiB (default 4..16384, powers of 4).",
+                                         "kib", "4,16,64,256,1024,4096,16384");
+    const QCommandLineOption filterOption("filter", "Only run variants whose name contains <text>.", "text");
+    const QCommandLineOption threadsOption("threads", "Run every variant on N threads at once (default 1).", "count", "1");
+    const QCommandLineOption minTimeOption("min-time", "Target seconds per sample (default 0.5).", "secs", "0.5");
+    const QCommandLineOption repsOption("repetitions", "Samples per case; the median is reported (default 3).", "count", "3");
+    const QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({sizesOption, filterOption, threadsOption, minTimeOption, repsOption, jsonOption});
+    parser.process(app);
+
+    Options options;
+    for (const QString &item : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const qint64 size = static_cast<qint64>(item.trimmed().toDouble() * KIB);
+        if (size > 0) options.sizes.push_back(size);
+    }
+    options.filter = parser.value(filterOption);
+    options.threads = qMax(1, parser.value(threadsOption).toInt());
+    options.minSecs = qMax(0.01, parser.value(minTimeOption).toDouble());
+    options.repetitions = qMax(1, parser.value(repsOption).toInt());
+    options.jsonPath = parser.value(jsonOption);
+
+    if (!Crypto::init()) {
+        qWarning() << "Failed to initialize libsodium";
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    out << QStringLiteral("%1 threads, median of %2, libsodium %3, AES-GCM %4\n")
+               .arg(options.threads).arg(options.repetitions).arg(QString::fromLatin1(sodium_version_string()))
+               .arg(Crypto::isAvailable(AES) ? QStringLiteral("available") : QStringLiteral("not available"));
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+               .arg(QStringLiteral("variant"), -14).arg(QStringLiteral("size"), 6)
+               .arg(QStringLiteral("ns/op"), 12).arg(QStringLiteral("GB/s"), 8)
+               .arg(QStringLiteral("GB/s/core"), 10).arg(QStringLiteral("allocs/op"), 10);
+    out.flush();
+
+    QJsonArray resultsJson;
+    for (const Variant &variant : VARIANTS) {
+        if (!options.filter.isEmpty() && !QString::fromLatin1(variant.name).contains(options.filter)) continue;
+        if (!Crypto::isAvailable(variant.cipher)) continue;
+
+        const std::vector<qint64> sizes = variant.sized ? options.sizes : std::vector<qint64>{0};
+        for (const qint64 size : sizes) {
+            const qint64 iterations = calibrate(variant, size, options);
+            std::vector<Sample> samples;
+            for (int rep = 0; rep < options.repetitions; ++rep) {
+                samples.push_back(measure(variant, size, options.threads, iterations));
+            }
+            std::sort(samples.begin(), samples.end(), [](const Sample &a, const Sample &b) {
+                return a.wallSecs < b.wallSecs;
+            });
+            const Sample &median = samples[samples.size() / 2];
+
+            const double ops = double(iterations) * options.threads;
+            const double nsPerOp = median.wallSecs * 1e9 / iterations;
+            const double bytes = ops * size;
+            const double gbPerSec = median.wallSecs > 0 ? bytes / 1e9 / median.wallSecs : 0.0;
+            const double gbPerCore = median.cpuSecs > 0 ? bytes / 1e9 / median.cpuSecs : -1.0;
+            const double allocsPerOp = median.allocations / ops;
+
+            out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+                       .arg(QLatin1String(variant.name), -14).arg(formatSize(size), 6)
+                       .arg(nsPerOp, 12, 'f', 0)
+                       .arg(size ? QString::number(gbPerSec, 'f', 3) : QStringLiteral("-"), 8)
+                       .arg(size && gbPerCore >= 0 ? QString::number(gbPerCore, 'f', 3) : QStringLiteral("-"), 10)
+                       .arg(allocsPerOp, 10, 'f', 1);
+            out.flush();
+
+            resultsJson.append(QJsonObject{
+                {"variant", QString::fromLatin1(variant.name)},
+                {"size", size},
+                {"iterations", iterations},
+                {"ns_per_op", nsPerOp},
+                {"gb_per_sec", gbPerSec},
+                {"gb_per_sec_per_core", gbPerCore},
+                {"allocs_per_op", allocsPerOp},
+            });
+        }
+    }
+
+    if (!options.jsonPath.isEmpty()) {
+        QFile file(options.jsonPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QJsonObject root{
+                {"threads", options.threads},
+                {"repetitions", options.repetitions},
+                {"allocations_counted", ProcStats::allocationsCounted()},
+                {"libsodium", QString::fromLatin1(sodium_version_string())},
+                {"aes_available", Crypto::isAvailable(AES)},
+                {"results", resultsJson},
+            };
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        } else {
+            qWarning() << "Cannot write" << options.jsonPath;
+        }
+    }
+
+    return 0;
+}
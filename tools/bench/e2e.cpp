@@ -0,0 +1,170 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+// End-to-end throughput benchmark: one sender and N receivers, each a real
+// AppController, transfer a random file through the in-process mock server
+// (or --server) on loopback. Reports aggregate MB/s and per-receiver
+// time-to-first-byte, and verifies every received file.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchcommon.h"
+#include "diagnostics/pipelinetrace.h"
+#include "mockserver.h"
+
+namespace {
+
+struct Options
+{
+    int receivers = 1;
+    qint64 fileSize = 64 * Bench::MIB;
+    int runs = 1;
+    int timeoutSecs = 300;
+    QString serverUrl;
+    QString jsonPath;
+    QString tracePath;
+    MockLimits limits;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-bench-e2e");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("End-to-end sender -> server -> receivers throughput benchmark.");
+    parser.addHelpOption();
+    const QCommandLineOption receiversOption("receivers", "Number of receivers (default 1).", "count", "1");
+    const QCommandLineOption sizeOption("size", "File size in MiB (default 64).", "mib", "64");
+    const QCommandLineOption runsOption("runs", "Number of runs (default 1).", "count", "1");
+    const QCommandLineOption timeoutOption("timeout", "Per-run timeout in seconds (default 300).", "secs", "300");
+    const QCommandLineOption serverOption("server", "Use this server instead of the built-in mock.", "url");
+    const QCommandLineOption chunkSizeOption("max-chunk-size", "Mock server chunk size in bytes.", "bytes");
+    const QCommandLineOption chunkQueueOption("max-chunk-queue", "Mock server buffer size in chunks.", "count");
+    const QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    const QCommandLineOption traceOption("trace", "Write a Chrome trace of the last run to <file>.", "file");
+    parser.addOptions({receiversOption, sizeOption, runsOption, timeoutOption, serverOption,
+                       chunkSizeOption, chunkQueueOption, jsonOption, traceOption});
+    parser.process(app);
+
+    Options options;
+    options.receivers = qMax(1, parser.value(receiversOption).toInt());
+    options.fileSize = qMax<qint64>(1, parser.value(sizeOption).toDouble() * Bench::MIB);
+    options.runs = qMax(1, parser.value(runsOption).toInt());
+    options.timeoutSecs = qMax(1, parser.value(timeoutOption).toInt());
+    options.serverUrl = parser.value(serverOption);
+    options.jsonPath = parser.value(jsonOption);
+    options.tracePath = parser.value(traceOption);
+    options.limits.maxReceiverCount = qMax(options.limits.maxReceiverCount, options.receivers);
+    if (parser.isSet(chunkSizeOption)) options.limits.maxChunkSize = parser.value(chunkSizeOption).toLongLong();
+    if (parser.isSet(chunkQueueOption)) options.limits.maxChunkQueue = parser.value(chunkQueueOption).toLongLong();
+
+    // Keep the benchmark's QSettings writes away from the user's real config
+    Bench::isolateSettings();
+
+    QTextStream out(stdout);
+
+    // The mock server gets its own thread so its work is not billed to the clients
+    QThread serverThread;
+    QString serverUrl = options.serverUrl;
+    if (serverUrl.isEmpty()) {
+        auto *server = new MockServer(options.limits);
+        const quint16 port = server->listen();
+        if (port == 0) return 1;
+        server->moveToThread(&serverThread);
+        QObject::connect(&serverThread, &QThread::finished, server, &QObject::deleteLater);
+        serverThread.start();
+        serverUrl = QStringLiteral("http://127.0.0.1:%1").arg(port);
+    }
+
+    QTemporaryDir workDir;
+    const QString inputPath = workDir.filePath("input.bin");
+    if (!workDir.isValid() || !Bench::writeRandomFile(inputPath, options.fileSize)) {
+        qWarning() << "Cannot create the input file";
+        return 1;
+    }
+    const QByteArray digest = Bench::fileDigest(inputPath);
+
+    out << QStringLiteral("%1 MiB, %2 receiver(s), server %3\n")
+               .arg(options.fileSize / double(Bench::MIB), 0, 'f', 1).arg(options.receivers).arg(serverUrl);
+    out.flush();
+
+    QJsonArray runsJson;
+    bool allOk = true;
+    PipelineTrace::setEnabled(!options.tracePath.isEmpty());
+    for (int run = 1; run <= options.runs; ++run) {
+        PipelineTrace::clear();
+        const Bench::TransferResult result = Bench::runTransfer(serverUrl, inputPath, digest, workDir.path(),
+                                                                 options.receivers, options.timeoutSecs);
+        allOk = allOk && result.ok();
+
+        std::vector<qint64> ttfbs;
+        QJsonArray receiversJson;
+        for (const auto &receiver : result.receivers) {
+            if (receiver.ttfbMs >= 0) ttfbs.push_back(receiver.ttfbMs);
+            receiversJson.append(QJsonObject{
+                {"ttfb_ms", receiver.ttfbMs},
+                {"done_ms", receiver.doneMs},
+                {"mb_per_sec", Bench::megabytesPerSec(options.fileSize, receiver.doneMs)},
+                {"status", receiver.status},
+                {"intact", receiver.intact},
+            });
+        }
+        std::sort(ttfbs.begin(), ttfbs.end());
+        const qint64 ttfbMedian = ttfbs.empty() ? -1 : ttfbs[ttfbs.size() / 2];
+        const qint64 ttfbMax = ttfbs.empty() ? -1 : ttfbs.back();
+        const double aggregate = Bench::megabytesPerSec(options.fileSize * options.receivers, result.elapsedMs);
+
+        out << QStringLiteral("run %1: %2 ms, %3 MB/s aggregate, TTFB p50 %4 ms max %5 ms%6\n")
+                   .arg(run).arg(result.elapsedMs).arg(aggregate, 0, 'f', 1)
+                   .arg(ttfbMedian).arg(ttfbMax)
+                   .arg(result.timedOut ? QStringLiteral(" [timeout]")
+                                        : result.ok() ? QString() : QStringLiteral(" [FAILED]"));
+        out.flush();
+
+        runsJson.append(QJsonObject{
+            {"elapsed_ms", result.elapsedMs},
+            {"aggregate_mb_per_sec", aggregate},
+            {"ttfb_p50_ms", ttfbMedian},
+            {"ttfb_max_ms", ttfbMax},
+            {"ok", result.ok()},
+            {"receivers", receiversJson},
+        });
+    }
+
+    if (!options.tracePath.isEmpty()) PipelineTrace::writeChromeJson(options.tracePath);
+
+    if (!options.jsonPath.isEmpty()) {
+        QFile file(options.jsonPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QJsonObject root{
+                {"file_size", options.fileSize},
+                {"receivers", options.receivers},
+                {"server", serverUrl},
+                {"runs", runsJson},
+            };
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        } else {
+            qWarning() << "Cannot write" << options.jsonPath;
+        }
+    }
+
+    serverThread.quit();
+    serverThread.wait();
+    return allOk ? 0 : 2;
+}
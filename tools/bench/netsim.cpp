@@ -0,0 +1,195 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+// Network scenario suite: runs a full transfer (as putinqa-bench-e2e does)
+// through a NetSimProxy for every network profile and reports throughput,
+// TTFB, injected faults and how long the client took to reconnect after
+// each forced disconnect.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <vector>
+
+#include "benchcommon.h"
+#include "mockserver.h"
+#include "netsimproxy.h"
+
+namespace {
+
+struct Scenario
+{
+    NetProfile profile;
+    Bench::TransferResult transfer;
+    NetSimStats net;
+};
+
+qint64 percentile(QList<qint64> values, double p)
+{
+    if (values.isEmpty()) return -1;
+    std::sort(values.begin(), values.end());
+    return values[qMin<qsizetype>(values.size() - 1, static_cast<qsizetype>(p * values.size()))];
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-bench-netsim");
+
+    QStringList presetNames;
+    for (const NetProfile &profile : NetProfile::presets()) presetNames << profile.name;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Transfer throughput and recovery under simulated network conditions.");
+    parser.addHelpOption();
+    const QCommandLineOption profilesOption("profiles", "Comma-separated profiles (default all: " + presetNames.join(",") + ").",
+                                            "names", presetNames.join(","));
+    const QCommandLineOption receiversOption("receivers", "Number of receivers (default 1).", "count", "1");
+    const QCommandLineOption sizeOption("size", "File size in MiB (default 32).", "mib", "32");
+    const QCommandLineOption timeoutOption("timeout", "Per-scenario timeout in seconds (default 600).", "secs", "600");
+    const QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({profilesOption, receiversOption, sizeOption, timeoutOption, jsonOption});
+    parser.process(app);
+
+    std::vector<NetProfile> profiles;
+    for (const QString &name : parser.value(profilesOption).split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const NetProfile profile = NetProfile::preset(name.trimmed(), &ok);
+        if (!ok) {
+            qWarning().noquote() << "Unknown profile" << name;
+            return 1;
+        }
+        profiles.push_back(profile);
+    }
+    const int receivers = qMax(1, parser.value(receiversOption).toInt());
+    const qint64 fileSize = qMax<qint64>(1, parser.value(sizeOption).toDouble() * Bench::MIB);
+    const int timeoutSecs = qMax(1, parser.value(timeoutOption).toInt());
+
+    Bench::isolateSettings();
+    QTextStream out(stdout);
+
+    // Server and proxy each get a thread so client work does not skew the shaping
+    QThread serverThread;
+    QThread proxyThread;
+    MockLimits limits;
+    limits.maxReceiverCount = qMax(limits.maxReceiverCount, receivers);
+    auto *server = new MockServer(limits);
+    const quint16 serverPort = server->listen();
+    if (serverPort == 0) return 1;
+    server->moveToThread(&serverThread);
+    QObject::connect(&serverThread, &QThread::finished, server, &QObject::deleteLater);
+    serverThread.start();
+    proxyThread.start();
+
+    QTemporaryDir workDir;
+    const QString inputPath = workDir.filePath("input.bin");
+    if (!workDir.isValid() || !Bench::writeRandomFile(inputPath, fileSize)) {
+        qWarning() << "Cannot create the input file";
+        return 1;
+    }
+    const QByteArray digest = Bench::fileDigest(inputPath);
+
+    out << QStringLiteral("%1 MiB, %2 receiver(s)\n").arg(fileSize / double(Bench::MIB), 0, 'f', 1).arg(receivers);
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+               .arg(QStringLiteral("profile"), -10).arg(QStringLiteral("MB/s"), 8)
+               .arg(QStringLiteral("time s"), 8).arg(QStringLiteral("TTFB ms"), 8)
+               .arg(QStringLiteral("stalls"), 7).arg(QStringLiteral("cuts"), 5)
+               .arg(QStringLiteral("recovery p50/max ms"), 20).arg(QStringLiteral("result"), 7);
+    out.flush();
+
+    std::vector<Scenario> scenarios;
+    bool allOk = true;
+    for (const NetProfile &profile : profiles) {
+        // A fresh proxy per scenario, so outages and link state do not carry over
+        auto *proxy = new NetSimProxy(QHostAddress::LocalHost, serverPort, profile);
+        const quint16 proxyPort = proxy->listen();
+        if (proxyPort == 0) return 1;
+        proxy->moveToThread(&proxyThread);
+
+        Scenario scenario;
+        scenario.profile = profile;
+        scenario.transfer = Bench::runTransfer(QStringLiteral("http://127.0.0.1:%1").arg(proxyPort), inputPath,
+                                               digest, workDir.path(), receivers, timeoutSecs);
+        scenario.net = proxy->stats();
+        proxy->deleteLater();
+        allOk = allOk && scenario.transfer.ok();
+
+        qint64 ttfb = -1;
+        for (const auto &receiver : scenario.transfer.receivers) ttfb = qMax(ttfb, receiver.ttfbMs);
+        const QString result = scenario.transfer.timedOut ? QStringLiteral("timeout")
+                             : scenario.transfer.ok() ? QStringLiteral("ok") : QStringLiteral("FAILED");
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+                   .arg(profile.name, -10)
+                   .arg(Bench::megabytesPerSec(fileSize * receivers, scenario.transfer.elapsedMs), 8, 'f', 2)
+                   .arg(scenario.transfer.elapsedMs / 1000.0, 8, 'f', 1).arg(ttfb, 8)
+                   .arg(scenario.net.stalls, 7).arg(scenario.net.disconnects, 5)
+                   .arg(QStringLiteral("%1/%2").arg(percentile(scenario.net.recoveryMs, 0.5))
+                            .arg(percentile(scenario.net.recoveryMs, 1.0)), 20)
+                   .arg(result, 7);
+        out.flush();
+        scenarios.push_back(scenario);
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonArray scenariosJson;
+        for (const Scenario &scenario : scenarios) {
+            QJsonArray receiversJson;
+            for (const auto &receiver : scenario.transfer.receivers) {
+                receiversJson.append(QJsonObject{
+                    {"ttfb_ms", receiver.ttfbMs},
+                    {"done_ms", receiver.doneMs},
+                    {"status", receiver.status},
+                    {"intact", receiver.intact},
+                });
+            }
+            QJsonArray recoveryJson;
+            for (const qint64 ms : scenario.net.recoveryMs) recoveryJson.append(ms);
+            scenariosJson.append(QJsonObject{
+                {"profile", scenario.profile.name},
+                {"elapsed_ms", scenario.transfer.elapsedMs},
+                {"aggregate_mb_per_sec", Bench::megabytesPerSec(fileSize * receivers, scenario.transfer.elapsedMs)},
+                {"ok", scenario.transfer.ok()},
+                {"timed_out", scenario.transfer.timedOut},
+                {"connections", scenario.net.connections},
+                {"refused", scenario.net.refused},
+                {"bytes_up", scenario.net.bytesUp},
+                {"bytes_down", scenario.net.bytesDown},
+                {"stalls", scenario.net.stalls},
+                {"disconnects", scenario.net.disconnects},
+                {"recovery_ms", recoveryJson},
+                {"receivers", receiversJson},
+            });
+        }
+
+        QFile file(parser.value(jsonOption));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QJsonObject root{
+                {"file_size", fileSize},
+                {"receivers", receivers},
+                {"scenarios", scenariosJson},
+            };
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        } else {
+            qWarning() << "Cannot write" << parser.value(jsonOption);
+        }
+    }
+
+    proxyThread.quit();
+    proxyThread.wait();
+    serverThread.quit();
+    serverThread.wait();
+    return allOk ? 0 : 2;
+}
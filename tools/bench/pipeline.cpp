@@ -0,0 +1,338 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+// Loopback pipeline benchmark: the sender's read + Crypto::encrypt feeds the
+// receiver's Crypto::decrypt + ChunkSink directly, with no network and no
+// event loop. Chunks are delivered in configurable arrival orders to load
+// the reorder buffer the way parallel downloads do. Reports throughput, CPU
+// time per GB, allocations and peak RSS for every chunk size x file size x
+// order combination.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "crypto/crypto.h"
+#include "transfer/chunksink.h"
+#include "benchcommon.h"
+#include "procstats.h"
+
+namespace {
+
+constexpr qint64 KIB = 1024;
+using Bench::MIB;
+
+// How a window of chunks is handed to the receiver
+enum class Order { InOrder, Swap, Reverse, Random };
+
+struct OrderName
+{
+    Order order;
+    const char *name;
+};
+
+constexpr OrderName ORDERS[] = {
+    {Order::InOrder, "inorder"},
+    {Order::Swap, "swap"},
+    {Order::Reverse, "reverse"},
+    {Order::Random, "random"},
+};
+
+struct Options
+{
+    std::vector<qint64> chunkSizes;  // wire size, as the server's maxChunkSize
+    std::vector<qint64> fileSizes;
+    std::vector<Order> orders;
+    int window = 4;                  // ChunkDownload::DEFAULT_PARALLEL_DOWNLOADS
+    int runs = 1;
+    quint32 seed = 1;
+    Crypto::Cipher cipher = Crypto::Cipher::XChaCha20Poly1305;
+    QString jsonPath;
+};
+
+struct Result
+{
+    double wallSecs = 0;
+    double cpuSecs = -1;
+    quint64 allocations = 0;
+    quint64 allocatedBytes = 0;
+    qint64 peakRss = -1;
+    qint64 maxPendingBytes = 0;
+    qint64 chunks = 0;
+    bool intact = false;
+};
+
+const char *orderName(Order order)
+{
+    for (const auto &entry : ORDERS) {
+        if (entry.order == order) return entry.name;
+    }
+    return "?";
+}
+
+void arrange(std::vector<std::pair<qint64, QByteArray>> &window, Order order, std::mt19937 &rng)
+{
+    switch (order) {
+    case Order::InOrder:
+        break;
+    case Order::Swap:
+        for (size_t i = 0; i + 1 < window.size(); i += 2) std::swap(window[i], window[i + 1]);
+        break;
+    case Order::Reverse:
+        std::reverse(window.begin(), window.end());
+        break;
+    case Order::Random:
+        std::shuffle(window.begin(), window.end(), rng);
+        break;
+    }
+}
+
+// One pass over the file. Only the pipeline itself is measured; the digest
+// check runs afterwards.
+Result runPipeline(const QString &inputPath, const QString &outputPath, const QByteArray &digest,
+                   qint64 chunkSize, Order order, const Options &options, std::mt19937 &rng)
+{
+    Result result;
+    const QByteArray key = Crypto::generateKey();
+    const qint64 payloadSize = chunkSize - Crypto::overhead(options.cipher);
+
+    QFile input(inputPath);
+    QFile output(outputPath);
+    if (!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return result;
+    }
+
+    ChunkSink sink;
+    sink.setDevice(&output);
+    std::vector<std::pair<qint64, QByteArray>> window;
+    window.reserve(options.window);
+    bool decryptFailed = false;
+
+    ProcStats::resetPeakRss();
+    const quint64 allocationsBefore = ProcStats::allocationCount();
+    const quint64 bytesBefore = ProcStats::allocatedBytes();
+    const double cpuBefore = ProcStats::cpuSeconds();
+    QElapsedTimer clock;
+    clock.start();
+
+    qint64 index = 0;
+    while (!input.atEnd() && !decryptFailed) {
+        window.clear();
+        while (static_cast<int>(window.size()) < options.window && !input.atEnd()) {
+            const QByteArray raw = input.read(payloadSize);
+            window.emplace_back(++index, Crypto::encrypt(raw, key, options.cipher));
+        }
+        arrange(window, order, rng);
+
+        for (const auto &[chunkIndex, wire] : window) {
+            const QByteArray plain = Crypto::decrypt(wire, key, options.cipher);
+            if (plain.isEmpty()) {
+                decryptFailed = true;
+                break;
+            }
+            sink.accept(chunkIndex, plain);
+            result.maxPendingBytes = qMax(result.maxPendingBytes, sink.pendingBytes());
+        }
+    }
+    output.close();
+
+    result.wallSecs = clock.nsecsElapsed() / 1e9;
+    const double cpuAfter = ProcStats::cpuSeconds();
+    if (cpuBefore >= 0 && cpuAfter >= 0) result.cpuSecs = cpuAfter - cpuBefore;
+    result.allocations = ProcStats::allocationCount() - allocationsBefore;
+    result.allocatedBytes = ProcStats::allocatedBytes() - bytesBefore;
+    result.peakRss = ProcStats::peakRssBytes();
+    result.chunks = index;
+    result.intact = !decryptFailed && sink.pendingCount() == 0 && Bench::fileDigest(outputPath) == digest;
+    QFile::remove(outputPath);
+    return result;
+}
+
+template <typename T, typename Parse>
+std::vector<T> parseList(const QString &value, Parse parse)
+{
+    std::vector<T> items;
+    for (const QString &item : value.split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const T parsed = parse(item.trimmed(), &ok);
+        if (ok) items.push_back(parsed);
+    }
+    return items;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-bench-pipeline");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("In-process read -> encrypt -> decrypt -> write benchmark.");
+    parser.addHelpOption();
+    const QCommandLineOption chunkOption("chunk-sizes", "Comma-separated wire chunk sizes in KiB (default 256,1024,5120).",
+                                         "kib", "256,1024,5120");
+    const QCommandLineOption sizeOption("sizes", "Comma-separated file sizes in MiB (default 64,256).", "mib", "64,256");
+    const QCommandLineOption orderOption("orders", "Comma-separated arrival orders: inorder, swap, reverse, random (default all).",
+                                         "orders", "inorder,swap,reverse,random");
+    const QCommandLineOption windowOption("window", "Chunks in flight at once (default 4, like the receiver).", "count", "4");
+    const QCommandLineOption runsOption("runs", "Runs per combination; the fastest is reported (default 1).", "count", "1");
+    const QCommandLineOption seedOption("seed", "Seed for the random order (default 1).", "seed", "1");
+    const QCommandLineOption cipherOption("cipher", "xchacha20-poly1305 (default) or aes256-gcm.", "name",
+                                          "xchacha20-poly1305");
+    const QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({chunkOption, sizeOption, orderOption, windowOption, runsOption, seedOption, cipherOption,
+                       jsonOption});
+    parser.process(app);
+
+    Options options;
+    options.chunkSizes = parseList<qint64>(parser.value(chunkOption), [](const QString &s, bool *ok) {
+        return static_cast<qint64>(s.toDouble(ok) * KIB);
+    });
+    options.fileSizes = parseList<qint64>(parser.value(sizeOption), [](const QString &s, bool *ok) {
+        return static_cast<qint64>(s.toDouble(ok) * MIB);
+    });
+    options.orders = parseList<Order>(parser.value(orderOption), [](const QString &s, bool *ok) {
+        for (const auto &entry : ORDERS) {
+            if (s == QLatin1String(entry.name)) {
+                *ok = true;
+                return entry.order;
+            }
+        }
+        *ok = false;
+        return Order::InOrder;
+    });
+    options.window = qMax(1, parser.value(windowOption).toInt());
+    options.runs = qMax(1, parser.value(runsOption).toInt());
+    options.seed = parser.value(seedOption).toUInt();
+    options.jsonPath = parser.value(jsonOption);
+    bool knownCipher = false;
+    options.cipher = Crypto::cipherFromName(parser.value(cipherOption), &knownCipher);
+    if (!knownCipher) {
+        qWarning().noquote() << "Unknown cipher" << parser.value(cipherOption);
+        return 1;
+    }
+
+    const qint64 overhead = Crypto::overhead(options.cipher);
+    options.chunkSizes.erase(std::remove_if(options.chunkSizes.begin(), options.chunkSizes.end(),
+                                            [overhead](qint64 size) { return size <= overhead; }),
+                             options.chunkSizes.end());
+    options.fileSizes.erase(std::remove_if(options.fileSizes.begin(), options.fileSizes.end(),
+                                           [](qint64 size) { return size <= 0; }),
+                            options.fileSizes.end());
+    if (options.chunkSizes.empty() || options.fileSizes.empty() || options.orders.empty()) {
+        qWarning() << "Nothing to run, check --chunk-sizes, --sizes and --orders";
+        return 1;
+    }
+
+    if (!Crypto::init()) {
+        qWarning() << "Failed to initialize libsodium";
+        return 1;
+    }
+    if (!Crypto::isAvailable(options.cipher)) {
+        qWarning() << "This CPU has no AES instructions, aes256-gcm is not available";
+        return 1;
+    }
+
+    QTextStream out(stdout);
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        qWarning() << "Cannot create a temporary directory";
+        return 1;
+    }
+    const QString inputPath = workDir.filePath("input.bin");
+    const QString outputPath = workDir.filePath("output.bin");
+
+    out << QStringLiteral("cipher %1\n").arg(Crypto::cipherName(options.cipher));
+    if (!ProcStats::allocationsCounted()) out << "Allocation counting is not available on this platform\n";
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+               .arg(QStringLiteral("chunk KiB"), 9).arg(QStringLiteral("file MiB"), 8)
+               .arg(QStringLiteral("order"), 8).arg(QStringLiteral("MB/s"), 8)
+               .arg(QStringLiteral("CPU s/GB"), 9).arg(QStringLiteral("allocs/chunk"), 12)
+               .arg(QStringLiteral("alloc B/B"), 9).arg(QStringLiteral("reorder MiB"), 11)
+               .arg(QStringLiteral("peak RSS MiB"), 12);
+    out.flush();
+
+    QJsonArray resultsJson;
+    bool allOk = true;
+    std::mt19937 rng(options.seed);
+    for (const qint64 fileSize : options.fileSizes) {
+        if (!Bench::writeRandomFile(inputPath, fileSize)) {
+            qWarning() << "Cannot create the input file";
+            return 1;
+        }
+        const QByteArray digest = Bench::fileDigest(inputPath);
+
+        for (const qint64 chunkSize : options.chunkSizes) {
+            for (const Order order : options.orders) {
+                Result best;
+                for (int run = 0; run < options.runs; ++run) {
+                    const Result result = runPipeline(inputPath, outputPath, digest, chunkSize, order, options, rng);
+                    allOk = allOk && result.intact;
+                    if (run == 0 || result.wallSecs < best.wallSecs) best = result;
+                }
+
+                const double gigabytes = fileSize / 1e9;
+                const double mbPerSec = best.wallSecs > 0 ? fileSize / 1e6 / best.wallSecs : 0.0;
+                const double cpuPerGb = best.cpuSecs >= 0 ? best.cpuSecs / gigabytes : -1.0;
+                const double allocsPerChunk = best.chunks ? double(best.allocations) / best.chunks : 0.0;
+                const double allocAmplification = double(best.allocatedBytes) / fileSize;
+
+                out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8 %9%10\n")
+                           .arg(chunkSize / double(KIB), 9, 'f', 0).arg(fileSize / double(MIB), 8, 'f', 0)
+                           .arg(QLatin1String(orderName(order)), 8).arg(mbPerSec, 8, 'f', 1).arg(cpuPerGb, 9, 'f', 3)
+                           .arg(allocsPerChunk, 12, 'f', 1).arg(allocAmplification, 9, 'f', 2)
+                           .arg(best.maxPendingBytes / double(MIB), 11, 'f', 1)
+                           .arg(best.peakRss / double(MIB), 12, 'f', 1)
+                           .arg(best.intact ? QString() : QStringLiteral(" [FAILED]"));
+                out.flush();
+
+                resultsJson.append(QJsonObject{
+                    {"chunk_size", chunkSize},
+                    {"file_size", fileSize},
+                    {"order", QString::fromLatin1(orderName(order))},
+                    {"chunks", best.chunks},
+                    {"wall_secs", best.wallSecs},
+                    {"mb_per_sec", mbPerSec},
+                    {"cpu_secs_per_gb", cpuPerGb},
+                    {"allocations", static_cast<qint64>(best.allocations)},
+                    {"allocated_bytes", static_cast<qint64>(best.allocatedBytes)},
+                    {"max_reorder_bytes", best.maxPendingBytes},
+                    {"peak_rss_bytes", best.peakRss},
+                    {"intact", best.intact},
+                });
+            }
+        }
+    }
+
+    if (!options.jsonPath.isEmpty()) {
+        QFile file(options.jsonPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QJsonObject root{
+                {"window", options.window},
+                {"runs", options.runs},
+                {"cipher", Crypto::cipherName(options.cipher)},
+                {"allocations_counted", ProcStats::allocationsCounted()},
+                {"results", resultsJson},
+            };
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        } else {
+            qWarning() << "Cannot write" << options.jsonPath;
+        }
+    }
+
+    return allOk ? 0 : 2;
+}
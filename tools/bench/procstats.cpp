@@ -0,0 +1,141 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "procstats.h"
+
+#include <QFile>
+
+#include <atomic>
+#include <cstdlib>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+#define PUTINQA_COUNT_ALLOCATIONS
+#endif
+
+namespace {
+
+std::atomic<quint64> allocations{0};
+std::atomic<quint64> allocationBytes{0};
+
+#ifdef PUTINQA_COUNT_ALLOCATIONS
+void countAllocation(size_t bytes)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+#endif
+
+#ifdef Q_OS_LINUX
+// VmHWM / VmRSS from /proc/self/status, in bytes
+qint64 statusField(const QByteArray &name)
+{
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (!status.open(QIODevice::ReadOnly)) return -1;
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (!line.startsWith(name)) continue;
+        const QByteArray value = line.mid(name.size()).trimmed();
+        return value.left(value.indexOf(' ')).toLongLong() * 1024;
+    }
+    return -1;
+}
+#endif
+
+} // namespace
+
+#ifdef PUTINQA_COUNT_ALLOCATIONS
+// Interposes the C allocator for the whole process (Qt, libsodium and
+// operator new all end up here); the real work is done by glibc.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+}
+#endif
+
+double ProcStats::cpuSeconds()
+{
+#ifdef Q_OS_UNIX
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#else
+    return -1;
+#endif
+}
+
+qint64 ProcStats::peakRssBytes()
+{
+#if defined(Q_OS_LINUX)
+    return statusField("VmHWM:");
+#elif defined(Q_OS_UNIX)
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef Q_OS_MACOS
+    return usage.ru_maxrss;         // bytes on macOS
+#else
+    return usage.ru_maxrss * 1024;  // KiB on the BSDs
+#endif
+#else
+    return -1;
+#endif
+}
+
+bool ProcStats::resetPeakRss()
+{
+#ifdef Q_OS_LINUX
+    // "5" resets VmHWM to the current RSS (Linux 4.0+)
+    QFile clearRefs(QStringLiteral("/proc/self/clear_refs"));
+    return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+bool ProcStats::allocationsCounted()
+{
+#ifdef PUTINQA_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+quint64 ProcStats::allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+quint64 ProcStats::allocatedBytes()
+{
+    return allocationBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,27 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QtGlobal>
+
+// Process-wide resource counters for the benchmarks. Linking procstats.cpp
+// into a binary replaces malloc/calloc/realloc/free with counting wrappers
+// on glibc; elsewhere allocationsCounted() is false and the counts stay 0.
+namespace ProcStats {
+
+// User + system CPU time of the whole process, -1 if unavailable
+double cpuSeconds();
+
+// Peak resident set size in bytes, -1 if unavailable. resetPeakRss() lowers
+// the mark to the current RSS where the OS allows it (Linux); otherwise the
+// peak is for the process lifetime and the return value is false.
+qint64 peakRssBytes();
+bool resetPeakRss();
+
+bool allocationsCounted();
+quint64 allocationCount();  // malloc + calloc + realloc calls
+quint64 allocatedBytes();   // bytes requested by those calls
+
+} // namespace ProcStats
@@ -0,0 +1,205 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+// Replays a WebSocket event recording (putinqa --record-events) through an
+// offline Session and the real AppController handlers, or through a bare
+// SessionState with --state-only, and reports the time spent per event
+// type. Runs at full speed by default; --paced keeps the original timing.
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QTextStream>
+#include <QTimer>
+
+#include <memory>
+
+#include "appcontroller.h"
+#include "benchcommon.h"
+#include "diagnostics/eventrecorder.h"
+#include "diagnostics/transferstats.h"
+
+namespace {
+
+struct Totals
+{
+    Histogram all;                    // ns per event
+    QMap<QString, Histogram> byType;  // ns per event, by "event" field
+    qint64 wallMs = 0;
+};
+
+QString eventType(const QString &raw)
+{
+    return QJsonDocument::fromJson(raw.toUtf8()).object().value("event").toString();
+}
+
+// Feeds one pass of the recording; `handle` is the code under test
+template <typename Handler>
+void replay(const EventRecorder::Recording &recording, const QStringList &types, bool paced,
+            Totals &totals, Handler handle)
+{
+    QElapsedTimer wall;
+    wall.start();
+
+    auto feed = [&](int i) {
+        const QString &raw = recording.events[i].message;
+        QElapsedTimer timer;
+        timer.start();
+        handle(raw);
+        const qint64 ns = timer.nsecsElapsed();
+        totals.all.record(ns);
+        totals.byType[types[i]].record(ns);
+    };
+
+    if (!paced) {
+        for (int i = 0; i < recording.events.size(); ++i) {
+            feed(i);
+            // Let queued work (single-shot timers, deferred deletes) run between
+            // events as it would between WebSocket messages, outside the timing
+            QCoreApplication::processEvents();
+        }
+    } else {
+        QEventLoop loop;
+        int next = 0;
+        QTimer pacer;
+        pacer.setSingleShot(true);
+        pacer.setTimerType(Qt::PreciseTimer);
+        QObject::connect(&pacer, &QTimer::timeout, &loop, [&]() {
+            const qint64 nowUs = wall.nsecsElapsed() / 1000;
+            while (next < recording.events.size() && recording.events[next].offsetUs <= nowUs) feed(next++);
+            if (next == recording.events.size()) {
+                loop.quit();
+                return;
+            }
+            pacer.start(static_cast<int>(qMax<qint64>(0, (recording.events[next].offsetUs - nowUs) / 1000)));
+        });
+        pacer.start(0);
+        loop.exec();
+    }
+    totals.wallMs += wall.elapsed();
+}
+
+QJsonObject toMicroseconds(const Histogram &histogram)
+{
+    return QJsonObject{
+        {"count", static_cast<qint64>(histogram.count())},
+        {"mean_us", histogram.mean() / 1000.0},
+        {"p50_us", histogram.percentile(50) / 1000.0},
+        {"p99_us", histogram.percentile(99) / 1000.0},
+        {"max_us", histogram.max() / 1000.0},
+        {"total_ms", histogram.mean() * histogram.count() / 1e6},
+    };
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-replay");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays recorded WebSocket events and profiles the event handlers.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "File written with putinqa --record-events.");
+    const QCommandLineOption pacedOption("paced", "Keep the recorded timing instead of replaying at full speed.");
+    const QCommandLineOption stateOnlyOption("state-only", "Only SessionState::processEventJson, no Session/AppController.");
+    const QCommandLineOption repeatOption("repeat", "Replay the recording N times (default 1).", "count", "1");
+    const QCommandLineOption jsonOption("json", "Also write results as JSON to <file>.", "file");
+    parser.addOptions({pacedOption, stateOnlyOption, repeatOption, jsonOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) parser.showHelp(1);
+    const QString path = parser.positionalArguments().first();
+    const bool paced = parser.isSet(pacedOption);
+    const bool stateOnly = parser.isSet(stateOnlyOption);
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+
+    EventRecorder::Recording recording;
+    if (!EventRecorder::load(path, &recording) || recording.events.isEmpty()) {
+        qWarning().noquote() << "Not an event recording or empty:" << path;
+        return 1;
+    }
+
+    QStringList types;
+    types.reserve(recording.events.size());
+    for (const auto &event : recording.events) types << eventType(event.message);
+
+    // The AppController reads and writes QSettings; keep that away from the real config
+    Bench::isolateSettings();
+
+    Totals totals;
+    for (int pass = 0; pass < repeat; ++pass) {
+        if (stateOnly) {
+            SessionState state;
+            replay(recording, types, paced, totals, [&state](const QString &raw) {
+                state.processEventJson(QJsonDocument::fromJson(raw.toUtf8()).object());
+            });
+        } else {
+            // A fresh controller per pass so every replay starts from the same state
+            auto controller = std::make_unique<AppController>();
+            Session *session = controller->startOfflineSession(recording.role == "sender");
+            replay(recording, types, paced, totals, [session](const QString &raw) {
+                session->replayEvent(raw);
+            });
+            controller->restart();  // drops the receiver's tmp file
+        }
+    }
+
+    QTextStream out(stdout);
+    out << QStringLiteral("%1: %2 events, role %3, %4 pass(es), %5, %6\n")
+               .arg(path).arg(recording.events.size()).arg(recording.role).arg(repeat)
+               .arg(paced ? QStringLiteral("paced") : QStringLiteral("full speed"))
+               .arg(stateOnly ? QStringLiteral("SessionState only") : QStringLiteral("Session + AppController"));
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7\n")
+               .arg(QStringLiteral("event"), -26).arg(QStringLiteral("count"), 8)
+               .arg(QStringLiteral("mean us"), 9).arg(QStringLiteral("p50 us"), 9)
+               .arg(QStringLiteral("p99 us"), 9).arg(QStringLiteral("max us"), 9)
+               .arg(QStringLiteral("total ms"), 9);
+    auto printRow = [&out](const QString &name, const Histogram &h) {
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7\n")
+                   .arg(name, -26).arg(h.count(), 8)
+                   .arg(h.mean() / 1000.0, 9, 'f', 1).arg(h.percentile(50) / 1000.0, 9, 'f', 1)
+                   .arg(h.percentile(99) / 1000.0, 9, 'f', 1).arg(h.max() / 1000.0, 9, 'f', 1)
+                   .arg(h.mean() * h.count() / 1e6, 9, 'f', 2);
+    };
+    for (auto it = totals.byType.cbegin(); it != totals.byType.cend(); ++it) {
+        printRow(it.key().isEmpty() ? QStringLiteral("(no type)") : it.key(), it.value());
+    }
+    printRow(QStringLiteral("all"), totals.all);
+    out << QStringLiteral("wall %1 ms\n").arg(totals.wallMs);
+    out.flush();
+
+    if (parser.isSet(jsonOption)) {
+        QJsonObject byType;
+        for (auto it = totals.byType.cbegin(); it != totals.byType.cend(); ++it) {
+            byType.insert(it.key(), toMicroseconds(it.value()));
+        }
+        const QJsonObject root{
+            {"recording", path},
+            {"role", recording.role},
+            {"events", static_cast<qint64>(recording.events.size())},
+            {"passes", repeat},
+            {"paced", paced},
+            {"state_only", stateOnly},
+            {"wall_ms", totals.wallMs},
+            {"all", toMicroseconds(totals.all)},
+            {"by_type", byType},
+        };
+        QFile file(parser.value(jsonOption));
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        } else {
+            qWarning() << "Cannot write" << parser.value(jsonOption);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+#include "mockserver.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-mockserver");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("In-memory put-in-pipe stand-in for local testing and benchmarks.");
+    parser.addHelpOption();
+    const QCommandLineOption hostOption("host", "Address to listen on.", "address", "127.0.0.1");
+    const QCommandLineOption portOption("port", "Port to listen on.", "port", "8080");
+    const QCommandLineOption chunkSizeOption("max-chunk-size", "Largest accepted chunk in bytes.", "bytes");
+    const QCommandLineOption chunkQueueOption("max-chunk-queue", "Chunks buffered per session.", "count");
+    const QCommandLineOption receiversOption("max-receivers", "Receivers per session.", "count");
+    const QCommandLineOption freezeOption("freeze", "Initial freeze in seconds.", "secs");
+    parser.addOptions({hostOption, portOption, chunkSizeOption, chunkQueueOption, receiversOption, freezeOption});
+    parser.process(app);
+
+    MockLimits limits;
+    if (parser.isSet(chunkSizeOption)) limits.maxChunkSize = parser.value(chunkSizeOption).toLongLong();
+    if (parser.isSet(chunkQueueOption)) limits.maxChunkQueue = parser.value(chunkQueueOption).toLongLong();
+    if (parser.isSet(receiversOption)) limits.maxReceiverCount = parser.value(receiversOption).toInt();
+    if (parser.isSet(freezeOption)) limits.maxInitialFreezeSecs = parser.value(freezeOption).toInt();
+
+    MockServer server(limits);
+    const QHostAddress address(parser.value(hostOption));
+    const quint16 port = server.listen(address, static_cast<quint16>(parser.value(portOption).toUInt()));
+    if (port == 0) return 1;
+
+    qInfo().noquote() << QStringLiteral("Listening on http://%1:%2").arg(address.toString()).arg(port);
+    return app.exec();
+}
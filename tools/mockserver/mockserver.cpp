@@ -0,0 +1,736 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "mockserver.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QWebSocket>
+#include <QWebSocketServer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDateTime>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <QUrl>
+#include <QDebug>
+
+namespace {
+constexpr auto ACK_FALLBACK_MS = 2000;
+constexpr auto MAX_NAME_LENGTH = 20;
+constexpr auto MAX_HEADER_BYTES = 16 * 1024;
+const QByteArray COOKIE_NAME = "putin";
+
+QString randomId()
+{
+    return QString::number(QRandomGenerator::global()->generate64(), 16);
+}
+
+QByteArray reasonPhrase(int code)
+{
+    switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 503: return "Service Unavailable";
+    }
+    return "Unknown";
+}
+
+QString cookieToken(const QByteArray &cookieHeader)
+{
+    for (const auto &part : cookieHeader.split(';')) {
+        const auto pair = part.trimmed();
+        if (pair.startsWith(COOKIE_NAME + '=')) {
+            return QString::fromLatin1(pair.mid(COOKIE_NAME.size() + 1));
+        }
+    }
+    return {};
+}
+
+QByteArray headerValue(const QByteArray &head, const QByteArray &lowerName)
+{
+    for (const auto &line : head.split('\n')) {
+        const int colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().toLower() == lowerName) {
+            return line.mid(colon + 1).trimmed();
+        }
+    }
+    return {};
+}
+}
+
+MockServer::MockServer(const MockLimits &limits, QObject *parent)
+    : QObject{parent}
+    , m_limits(limits)
+    , m_tcpServer(new QTcpServer(this))
+    , m_wsServer(new QWebSocketServer(QStringLiteral("putinqa-mockserver"), QWebSocketServer::NonSecureMode, this))
+{
+    QObject::connect(m_tcpServer, &QTcpServer::newConnection, this, &MockServer::onNewTcpConnection);
+    QObject::connect(m_wsServer, &QWebSocketServer::newConnection, this, &MockServer::onNewWsConnection);
+}
+
+quint16 MockServer::listen(const QHostAddress &address, quint16 port)
+{
+    if (!m_tcpServer->listen(address, port)) {
+        qWarning() << "MockServer: cannot listen:" << m_tcpServer->errorString();
+        return 0;
+    }
+    return m_tcpServer->serverPort();
+}
+
+// --- HTTP ---
+
+void MockServer::onNewTcpConnection()
+{
+    while (auto *socket = m_tcpServer->nextPendingConnection()) {
+        m_httpBuffers.insert(socket, QByteArray());
+        QObject::connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onTcpReadyRead(socket); });
+        QObject::connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_httpBuffers.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void MockServer::onTcpReadyRead(QTcpSocket *socket)
+{
+    // A WebSocket handshake is left unread and handed to QWebSocketServer
+    if (m_httpBuffers.value(socket).isEmpty() && tryUpgrade(socket)) return;
+
+    m_httpBuffers[socket] += socket->readAll();
+
+    while (socket->state() == QAbstractSocket::ConnectedState) {
+        QByteArray &buffer = m_httpBuffers[socket];
+        const int headerEnd = buffer.indexOf("\r\n\r\n");
+        if (headerEnd < 0) {
+            if (buffer.size() > MAX_HEADER_BYTES) socket->abort();
+            return;
+        }
+
+        const QByteArray head = buffer.left(headerEnd);
+        const qint64 contentLength = headerValue(head, "content-length").toLongLong();
+        if (contentLength > m_limits.maxChunkSize * 2) {
+            respond(socket, 413, QByteArray());
+            socket->disconnectFromHost();
+            return;
+        }
+        if (buffer.size() < headerEnd + 4 + contentLength) return;
+
+        HttpRequest request;
+        const auto requestLine = head.left(head.indexOf("\r\n")).split(' ');
+        if (requestLine.size() < 2) {
+            socket->abort();
+            return;
+        }
+        request.method = requestLine[0];
+        const QUrl url(QString::fromLatin1(requestLine[1]));
+        request.path = url.path();
+        request.query = QUrlQuery(url);
+        request.token = cookieToken(headerValue(head, "cookie"));
+        request.headers.insert("if-none-match", headerValue(head, "if-none-match"));
+        request.body = buffer.mid(headerEnd + 4, contentLength);
+        buffer.remove(0, headerEnd + 4 + contentLength);
+
+        handleHttp(socket, request);
+    }
+}
+
+bool MockServer::tryUpgrade(QTcpSocket *socket)
+{
+    const QByteArray peeked = socket->peek(MAX_HEADER_BYTES);
+    if (!peeked.startsWith("GET /api/ws")) return false;
+
+    const int headerEnd = peeked.indexOf("\r\n\r\n");
+    if (headerEnd < 0) return true;  // wait for the rest of the handshake
+
+    m_pendingWsTokens.insert(socket->peerPort(), cookieToken(headerValue(peeked.left(headerEnd), "cookie")));
+    QObject::disconnect(socket, nullptr, this, nullptr);
+    m_httpBuffers.remove(socket);
+    m_wsServer->handleConnection(socket);
+    return true;
+}
+
+void MockServer::handleHttp(QTcpSocket *socket, const HttpRequest &request)
+{
+    if (request.path == "/api/statistics/current") {
+        const QByteArray body = QJsonDocument(QJsonObject{
+            {"max_session_count", m_limits.maxSessions},
+            {"max_user_count", m_limits.maxClients},
+            {"current_session_count", static_cast<qint64>(m_sessions.size())},
+            {"current_user_count", static_cast<qint64>(m_clients.size())},
+        }).toJson(QJsonDocument::Compact);
+        // The counters are the whole body, so they make a good validator
+        const QByteArray etag = '"' + QByteArray::number(qHash(body), 16) + '"';
+        if (request.headers.value("if-none-match") == etag) {
+            respond(socket, 304, QByteArray(), "application/json", "ETag: " + etag + "\r\n");
+        } else {
+            respond(socket, 200, body, "application/json", "ETag: " + etag + "\r\n");
+        }
+        return;
+    }
+
+    if (request.path == "/api/identity/request") {
+        onIdentityRequest(socket, request);
+        return;
+    }
+
+    if (request.path == "/api/identity/confirmation") {
+        // No captcha is ever issued, so there is nothing to confirm
+        respond(socket, 403, QByteArray());
+        return;
+    }
+
+    Client *client = clientByToken(request.token);
+    if (!client) {
+        respond(socket, 401, QByteArray());
+        return;
+    }
+
+    if (request.path == "/api/me/info") {
+        respondJson(socket, 200, {{"id", client->id}, {"name", client->name}});
+    } else if (request.path == "/api/me/leave" && request.method == "POST") {
+        removeClient(client->token);
+        respondJson(socket, 200, QJsonObject());
+    } else if (request.path == "/api/session/create" && request.method == "POST") {
+        onSessionCreate(socket, *client, request);
+    } else if (request.path == "/api/session/join") {
+        onSessionJoin(socket, *client, request);
+    } else if (request.path == "/api/session/chunk" && request.method == "GET") {
+        onChunkGet(socket, *client, request);
+    } else if (request.path == "/api/session/chunk" && request.method == "POST") {
+        onChunkPost(socket, *client, request);
+    } else {
+        respond(socket, 404, QByteArray());
+    }
+}
+
+void MockServer::respond(QTcpSocket *socket, int code, const QByteArray &body,
+                         const QByteArray &contentType, const QByteArray &extraHeaders)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(code) + ' ' + reasonPhrase(code) + "\r\n";
+    head += "Content-Type: " + contentType + "\r\n";
+    head += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    head += "Connection: keep-alive\r\n";
+    head += extraHeaders;
+    head += "\r\n";
+    socket->write(head);
+    socket->write(body);
+}
+
+void MockServer::respondJson(QTcpSocket *socket, int code, const QJsonObject &json, const QByteArray &extraHeaders)
+{
+    respond(socket, code, QJsonDocument(json).toJson(QJsonDocument::Compact), "application/json", extraHeaders);
+}
+
+void MockServer::onIdentityRequest(QTcpSocket *socket, const HttpRequest &request)
+{
+    // Same as the real server: an already identified client gets 400
+    if (clientByToken(request.token)) {
+        respond(socket, 400, QByteArray());
+        return;
+    }
+    if (m_clients.size() >= m_limits.maxClients) {
+        respond(socket, 503, QByteArray());
+        return;
+    }
+
+    Client client;
+    client.id = randomId();
+    client.token = randomId() + randomId();
+    client.name = request.query.queryItemValue("name", QUrl::FullyDecoded).left(MAX_NAME_LENGTH);
+    if (client.name.isEmpty()) client.name = QStringLiteral("Noname");
+
+    m_tokenById.insert(client.id, client.token);
+    m_clients.insert(client.token, client);
+
+    const QByteArray cookie = "Set-Cookie: " + COOKIE_NAME + '=' + client.token.toLatin1() + "; Path=/; HttpOnly\r\n";
+    respondJson(socket, 201, {{"id", client.id}, {"name", client.name}}, cookie);
+}
+
+void MockServer::onSessionCreate(QTcpSocket *socket, Client &client, const HttpRequest &request)
+{
+    if (!client.sessionId.isEmpty()) {
+        respond(socket, 409, QByteArray());
+        return;
+    }
+    if (m_sessions.size() >= m_limits.maxSessions) {
+        respond(socket, 503, QByteArray());
+        return;
+    }
+
+    Session session;
+    session.id = randomId();
+    session.senderId = client.id;
+    session.autoDropFreeze = QJsonDocument::fromJson(request.body).object().value("auto_drop_freeze").toBool();
+    session.expiresAt = QDateTime::currentSecsSinceEpoch() + m_limits.sessionLifetimeSecs;
+    session.context = new QObject(this);
+
+    const QString id = session.id;
+    QTimer::singleShot(m_limits.maxInitialFreezeSecs * 1000, session.context, [this, id]() {
+        auto it = m_sessions.find(id);
+        if (it != m_sessions.end()) dropFreeze(*it);
+    });
+    QTimer::singleShot(m_limits.sessionLifetimeSecs * 1000, session.context, [this, id]() {
+        completeSession(id, QStringLiteral("timeout"));
+    });
+
+    m_sessions.insert(id, session);
+    client.sessionId = id;
+    respondJson(socket, 201, {{"id", id}});
+}
+
+void MockServer::onSessionJoin(QTcpSocket *socket, Client &client, const HttpRequest &request)
+{
+    const QString id = request.query.queryItemValue("id");
+    auto it = m_sessions.find(id);
+    if (it == m_sessions.end()) {
+        respond(socket, 404, QByteArray());
+        return;
+    }
+    if (!client.sessionId.isEmpty()) {
+        respond(socket, client.sessionId == id ? 202 : 409, QByteArray());
+        return;
+    }
+    if (it->receivers.size() >= m_limits.maxReceiverCount) {
+        respond(socket, 403, QByteArray());
+        return;
+    }
+
+    it->receivers.append(client.id);
+    client.sessionId = id;
+    broadcast(*it, "new_receiver", {{"id", client.id}, {"name", client.name}}, client.id);
+    respondJson(socket, 202, {{"id", id}});
+}
+
+void MockServer::onChunkGet(QTcpSocket *socket, Client &client, const HttpRequest &request)
+{
+    auto it = m_sessions.find(client.sessionId);
+    if (it == m_sessions.end() || !it->receivers.contains(client.id)) {
+        respond(socket, 403, QByteArray());
+        return;
+    }
+
+    const qint64 index = request.query.queryItemValue("id").toLongLong();
+    const auto chunk = it->chunks.constFind(index);
+    if (chunk == it->chunks.constEnd()) {
+        respond(socket, 404, QByteArray());
+        return;
+    }
+
+    it->currentChunk[client.id] = index;
+    broadcast(*it, "chunk_download", {{"id", client.id}, {"index", index}, {"action", "started"}});
+    respond(socket, 200, chunk->data, "application/octet-stream");
+}
+
+void MockServer::onChunkPost(QTcpSocket *socket, Client &client, const HttpRequest &request)
+{
+    auto it = m_sessions.find(client.sessionId);
+    if (it == m_sessions.end() || it->senderId != client.id) {
+        respond(socket, 403, QByteArray());
+        return;
+    }
+    if (!acceptChunk(*it, request.body)) {
+        respond(socket, 403, QByteArray());
+        return;
+    }
+    respondJson(socket, 201, {{"index", it->lastIndex}});
+}
+
+// --- WebSocket ---
+
+void MockServer::onNewWsConnection()
+{
+    while (auto *ws = m_wsServer->nextPendingConnection()) {
+        const QString token = m_pendingWsTokens.take(ws->peerPort());
+        Client *client = clientByToken(token);
+        if (!client) {
+            ws->close(QWebSocketProtocol::CloseCodePolicyViolated, QStringLiteral("unauthorized"));
+            ws->deleteLater();
+            continue;
+        }
+
+        // Single WS per client: a reconnect drops the previous one
+        if (client->ws) {
+            m_wsTokens.remove(client->ws);
+            client->ws->close();
+            client->ws->deleteLater();
+        }
+        client->ws = ws;
+        m_wsTokens.insert(ws, token);
+        delete client->offlineTimer;
+        client->offlineTimer = nullptr;
+
+        QObject::connect(ws, &QWebSocket::textMessageReceived, this, [this, ws](const QString &message) {
+            onWsText(ws, message);
+        });
+        QObject::connect(ws, &QWebSocket::binaryMessageReceived, this, [this, ws](const QByteArray &data) {
+            onWsBinary(ws, data);
+        });
+        QObject::connect(ws, &QWebSocket::disconnected, this, [this, ws]() { onWsDisconnected(ws); });
+
+        auto it = m_sessions.find(client->sessionId);
+        if (it != m_sessions.end()) {
+            sendEvent(*client, "start_init", startInit(*it, *client));
+            broadcast(*it, "online", {{"id", client->id}, {"status", true}}, client->id);
+        }
+    }
+}
+
+void MockServer::onWsText(QWebSocket *ws, const QString &message)
+{
+    const auto json = QJsonDocument::fromJson(message.toUtf8()).object();
+    const auto action = json.value("action").toString();
+    const auto data = json.value("data").toObject();
+
+    if (action == "ack") {
+        const QString token = m_pendingAcks.take(data.value("id").toInteger());
+        if (!token.isEmpty()) removeClient(token);
+        return;
+    }
+
+    Client *client = clientByToken(m_wsTokens.value(ws));
+    if (!client) return;
+    auto it = m_sessions.find(client->sessionId);
+    if (it == m_sessions.end()) return;
+    Session &session = *it;
+    const bool isSender = (session.senderId == client->id);
+
+    if (action == "new_name") {
+        client->name = data.value("name").toString().left(MAX_NAME_LENGTH);
+        broadcast(session, "name_changed", {{"id", client->id}, {"name", client->name}}, client->id);
+    } else if (action == "confirm_chunk" && !isSender) {
+        confirmChunk(session, *client, data.value("index").toInteger());
+    } else if (action == "set_file_info" && isSender) {
+        session.fileName = data.value("name").toString();
+        session.fileSize = data.value("size").toInteger();
+        broadcast(session, "file_info", {{"name", session.fileName}, {"size", session.fileSize}}, client->id);
+    } else if (action == "upload_finished" && isSender) {
+        session.eof = true;
+        broadcast(session, "upload_finished", QJsonObject());
+        checkComplete(session);
+    } else if (action == "drop_freeze" && isSender) {
+        dropFreeze(session);
+    } else if (action == "kick_receiver" && isSender) {
+        removeReceiver(session, data.value("id").toString(), true);
+    } else if (action == "terminate_session" && isSender) {
+        completeSession(session.id, QStringLiteral("sender_is_gone"));
+    } else {
+        qWarning() << "MockServer: unexpected action" << action << "from" << client->id;
+    }
+}
+
+void MockServer::onWsBinary(QWebSocket *ws, const QByteArray &data)
+{
+    Client *client = clientByToken(m_wsTokens.value(ws));
+    if (!client) return;
+    auto it = m_sessions.find(client->sessionId);
+    if (it == m_sessions.end() || it->senderId != client->id) return;
+    acceptChunk(*it, data);
+}
+
+void MockServer::onWsDisconnected(QWebSocket *ws)
+{
+    const QString token = m_wsTokens.take(ws);
+    ws->deleteLater();
+
+    Client *client = clientByToken(token);
+    if (client && client->ws == ws) {
+        client->ws = nullptr;
+        onClientOffline(*client);
+    }
+}
+
+// --- Session logic ---
+
+MockServer::Client *MockServer::clientByToken(const QString &token)
+{
+    if (token.isEmpty()) return nullptr;
+    auto it = m_clients.find(token);
+    return it == m_clients.end() ? nullptr : &it.value();
+}
+
+MockServer::Client *MockServer::clientById(const QString &id)
+{
+    return clientByToken(m_tokenById.value(id));
+}
+
+void MockServer::sendEvent(const Client &client, const QString &event, const QJsonObject &data)
+{
+    if (!client.ws) return;
+    const QJsonObject json{{"event", event}, {"data", data}};
+    client.ws->sendTextMessage(QString::fromUtf8(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+}
+
+void MockServer::sendTerminalEvent(Client &client, const QString &event, const QJsonObject &data)
+{
+    // The client is dropped on ACK, or after the fallback for dead clients
+    const qint64 id = m_nextEventId++;
+    m_pendingAcks.insert(id, client.token);
+    QTimer::singleShot(ACK_FALLBACK_MS, this, [this, id]() {
+        const QString token = m_pendingAcks.take(id);
+        if (!token.isEmpty()) removeClient(token);
+    });
+
+    if (!client.ws) return;
+    const QJsonObject json{{"event", event}, {"id", id}, {"data", data}};
+    client.ws->sendTextMessage(QString::fromUtf8(QJsonDocument(json).toJson(QJsonDocument::Compact)));
+}
+
+void MockServer::broadcast(const Session &session, const QString &event, const QJsonObject &data,
+                           const QString &exceptId)
+{
+    if (session.senderId != exceptId) {
+        if (const auto *sender = clientById(session.senderId)) sendEvent(*sender, event, data);
+    }
+    for (const auto &id : session.receivers) {
+        if (id == exceptId) continue;
+        if (const auto *receiver = clientById(id)) sendEvent(*receiver, event, data);
+    }
+}
+
+QJsonObject MockServer::startInit(const Session &session, const Client &client)
+{
+    const auto *sender = clientById(session.senderId);
+    const QJsonObject senderJson{
+        {"id", session.senderId},
+        {"is_online", sender && sender->ws},
+        {"name", sender ? sender->name : QString()},
+    };
+
+    QJsonArray receivers;
+    for (const auto &id : session.receivers) {
+        const auto *receiver = clientById(id);
+        receivers.append(QJsonObject{
+            {"id", id},
+            {"current_chunk", session.currentChunk.value(id)},
+            {"is_online", receiver && receiver->ws},
+            {"name", receiver ? receiver->name : QString()},
+        });
+    }
+
+    QJsonArray chunks;
+    for (auto it = session.chunks.constBegin(); it != session.chunks.constEnd(); ++it) {
+        chunks.append(QJsonObject{{"index", it.key()}, {"size", static_cast<qint64>(it->data.size())}});
+    }
+
+    const QJsonObject state{
+        {"chunks", chunks},
+        {"current_chunk", session.lastIndex},
+        {"expiration_in", session.expiresAt - QDateTime::currentSecsSinceEpoch()},
+        {"initial_freeze", session.frozen},
+        {"some_chunk_was_removed", session.someChunkRemoved},
+        {"upload_finished", session.eof},
+        {"file", QJsonObject{{"name", session.fileName}, {"size", session.fileSize}}},
+    };
+
+    return {
+        {"session_id", session.id},
+        {"limits", QJsonObject{
+            {"max_chunk_queue", m_limits.maxChunkQueue},
+            {"max_chunk_size", m_limits.maxChunkSize},
+            {"max_initial_freeze", m_limits.maxInitialFreezeSecs},
+            {"max_receiver_count", m_limits.maxReceiverCount},
+        }},
+        {"members", QJsonObject{{"sender", senderJson}, {"receivers", receivers}}},
+        {"state", state},
+        {"transferred", QJsonObject{
+            {"global", QJsonObject{{"from_sender", session.fromSender}, {"to_receivers", session.toReceivers}}},
+            {"received_by_you", session.receivedBy.value(client.id)},
+        }},
+    };
+}
+
+bool MockServer::acceptChunk(Session &session, const QByteArray &data)
+{
+    if (session.eof || data.isEmpty() || data.size() > m_limits.maxChunkSize ||
+        session.chunks.size() >= m_limits.maxChunkQueue) {
+        qWarning() << "MockServer: rejected chunk of" << data.size() << "bytes in session" << session.id;
+        return false;
+    }
+
+    const qint64 index = ++session.lastIndex;
+    const qint64 size = data.size();
+    session.chunks.insert(index, Chunk{data, {}});
+    session.fromSender += size;
+
+    broadcast(session, "new_chunk", {{"index", index}, {"size", size}});
+    broadcast(session, "bytes_count", {{"value", session.fromSender}, {"direction", "from_sender"}});
+
+    if (session.chunks.size() >= m_limits.maxChunkQueue && session.newChunkAllowed) {
+        session.newChunkAllowed = false;
+        if (const auto *sender = clientById(session.senderId)) {
+            sendEvent(*sender, "new_chunk_allowed", {{"status", false}});
+        }
+    }
+    return true;
+}
+
+void MockServer::confirmChunk(Session &session, Client &client, qint64 index)
+{
+    auto it = session.chunks.find(index);
+    if (it == session.chunks.end() || it->confirmedBy.contains(client.id)) return;
+
+    it->confirmedBy.insert(client.id);
+    const qint64 size = it->data.size();
+    session.receivedBy[client.id] += size;
+    session.toReceivers += size;
+    session.currentChunk[client.id] = index;
+
+    sendEvent(client, "personal_received", {{"bytes", session.receivedBy.value(client.id)}});
+    broadcast(session, "chunk_download", {{"id", client.id}, {"index", index}, {"action", "finished"}});
+    broadcast(session, "bytes_count", {{"value", session.toReceivers}, {"direction", "to_receivers"}});
+
+    if (session.frozen) {
+        if (session.autoDropFreeze) dropFreeze(session);
+        return;
+    }
+    sanitize(session);
+    checkComplete(session);
+}
+
+void MockServer::dropFreeze(Session &session)
+{
+    if (!session.frozen) return;
+
+    session.frozen = false;
+    broadcast(session, "chunks_unfrozen", QJsonObject());
+    sanitize(session);
+    checkComplete(session);
+}
+
+void MockServer::sanitize(Session &session)
+{
+    if (session.receivers.isEmpty()) return;
+
+    QJsonArray removed;
+    for (auto it = session.chunks.begin(); it != session.chunks.end();) {
+        bool confirmedByAll = true;
+        for (const auto &id : session.receivers) {
+            if (!it->confirmedBy.contains(id)) {
+                confirmedByAll = false;
+                break;
+            }
+        }
+        if (confirmedByAll) {
+            removed.append(it.key());
+            it = session.chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (removed.isEmpty()) return;
+
+    session.someChunkRemoved = true;
+    broadcast(session, "chunk_removed", {{"id", removed}});
+
+    if (!session.newChunkAllowed && session.chunks.size() < m_limits.maxChunkQueue) {
+        session.newChunkAllowed = true;
+        if (const auto *sender = clientById(session.senderId)) {
+            sendEvent(*sender, "new_chunk_allowed", {{"status", true}});
+        }
+    }
+}
+
+void MockServer::checkComplete(Session &session)
+{
+    if (session.eof && !session.frozen && session.chunks.isEmpty()) {
+        completeSession(session.id, QStringLiteral("ok"));
+    }
+}
+
+void MockServer::completeSession(const QString &sessionId, const QString &status)
+{
+    auto it = m_sessions.find(sessionId);
+    if (it == m_sessions.end()) return;
+
+    // Take a copy first: sessionId may refer into the session being removed
+    const Session session = it.value();
+    m_sessions.erase(it);
+    delete session.context;
+
+    QStringList members = session.receivers;
+    members.prepend(session.senderId);
+    for (const auto &id : members) {
+        if (auto *client = clientById(id)) {
+            client->sessionId.clear();
+            sendTerminalEvent(*client, "complete", {{"status", status}});
+        }
+    }
+}
+
+void MockServer::removeReceiver(Session &session, const QString &id, bool kicked)
+{
+    if (!session.receivers.removeOne(id)) return;
+    session.currentChunk.remove(id);
+
+    if (auto *client = clientById(id)) {
+        client->sessionId.clear();
+        if (kicked) sendTerminalEvent(*client, "kicked", QJsonObject());
+    }
+    broadcast(session, "receiver_removed", {{"id", id}});
+
+    if (session.receivers.isEmpty() && !session.frozen) {
+        const bool delivered = session.eof && session.chunks.isEmpty();
+        completeSession(session.id, session.autoDropFreeze || delivered
+                                        ? QStringLiteral("ok") : QStringLiteral("no_receivers"));
+        return;
+    }
+
+    // The receiver that left may have been the last one holding chunks back
+    if (!session.frozen) {
+        sanitize(session);
+        checkComplete(session);
+    }
+}
+
+void MockServer::removeClient(const QString &token)
+{
+    auto it = m_clients.find(token);
+    if (it == m_clients.end()) return;
+
+    const Client client = it.value();
+    m_clients.erase(it);
+    m_tokenById.remove(client.id);
+    // May be called from that very timer, so no direct delete here
+    if (client.offlineTimer) client.offlineTimer->deleteLater();
+
+    if (client.ws) {
+        m_wsTokens.remove(client.ws);
+        client.ws->close();
+        client.ws->deleteLater();
+    }
+
+    auto session = m_sessions.find(client.sessionId);
+    if (session == m_sessions.end()) return;
+
+    if (session->senderId == client.id) {
+        // After upload_finished the receivers can still drain the buffer
+        if (!session->eof) completeSession(client.sessionId, QStringLiteral("sender_is_gone"));
+    } else {
+        removeReceiver(*session, client.id, false);
+    }
+}
+
+void MockServer::onClientOffline(Client &client)
+{
+    auto it = m_sessions.find(client.sessionId);
+    if (it != m_sessions.end()) {
+        broadcast(*it, "online", {{"id", client.id}, {"status", false}}, client.id);
+    }
+
+    delete client.offlineTimer;
+    client.offlineTimer = new QObject(this);
+    const QString token = client.token;
+    QTimer::singleShot(m_limits.clientTimeoutSecs * 1000, client.offlineTimer, [this, token]() {
+        removeClient(token);
+    });
+}
@@ -0,0 +1,147 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QUrlQuery>
+#include <QJsonObject>
+#include <QHostAddress>
+
+class QTcpServer;
+class QTcpSocket;
+class QWebSocket;
+class QWebSocketServer;
+
+struct MockLimits
+{
+    qint64 maxChunkSize = 5 * 1024 * 1024;
+    qint64 maxChunkQueue = 10;
+    int maxReceiverCount = 5;
+    int maxInitialFreezeSecs = 120;
+    int sessionLifetimeSecs = 7200;
+    int clientTimeoutSecs = 60;
+    int maxClients = 500;
+    int maxSessions = 100;
+};
+
+// Stand-in for a put-in-pipe v1.1.0 server (see vibecode/SERVER_PROTOCOL.md),
+// good enough to drive the real client end to end on loopback. No captcha,
+// no TLS, everything in memory, one thread.
+class MockServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MockServer(const MockLimits &limits = MockLimits(), QObject *parent = nullptr);
+
+    // Returns the bound port, 0 on failure. The server may be moved to
+    // another thread after this.
+    quint16 listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+
+private:
+    struct HttpRequest
+    {
+        QByteArray method;
+        QString path;
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers;  // lower-case names
+        QByteArray body;
+        QString token;
+    };
+
+    struct Client
+    {
+        QString id;
+        QString name;
+        QString token;
+        QString sessionId;
+        QWebSocket *ws = nullptr;
+        QObject *offlineTimer = nullptr;  // pending client timeout while WS is down
+    };
+
+    struct Chunk
+    {
+        QByteArray data;
+        QSet<QString> confirmedBy;
+    };
+
+    struct Session
+    {
+        QString id;
+        QString senderId;
+        QStringList receivers;
+        QMap<qint64, Chunk> chunks;
+        qint64 lastIndex = 0;
+        bool frozen = true;
+        bool autoDropFreeze = false;
+        bool eof = false;
+        bool newChunkAllowed = true;
+        bool someChunkRemoved = false;
+        QString fileName;
+        qint64 fileSize = 0;
+        qint64 fromSender = 0;
+        qint64 toReceivers = 0;
+        QHash<QString, qint64> receivedBy;
+        QHash<QString, qint64> currentChunk;
+        qint64 expiresAt = 0;
+        QObject *context = nullptr;  // owns the session timers
+    };
+
+    // HTTP
+    void onNewTcpConnection();
+    void onTcpReadyRead(QTcpSocket *socket);
+    bool tryUpgrade(QTcpSocket *socket);
+    void handleHttp(QTcpSocket *socket, const HttpRequest &request);
+    void respond(QTcpSocket *socket, int code, const QByteArray &body,
+                 const QByteArray &contentType = "application/json",
+                 const QByteArray &extraHeaders = QByteArray());
+    void respondJson(QTcpSocket *socket, int code, const QJsonObject &json,
+                     const QByteArray &extraHeaders = QByteArray());
+
+    void onIdentityRequest(QTcpSocket *socket, const HttpRequest &request);
+    void onSessionCreate(QTcpSocket *socket, Client &client, const HttpRequest &request);
+    void onSessionJoin(QTcpSocket *socket, Client &client, const HttpRequest &request);
+    void onChunkGet(QTcpSocket *socket, Client &client, const HttpRequest &request);
+    void onChunkPost(QTcpSocket *socket, Client &client, const HttpRequest &request);
+
+    // WebSocket
+    void onNewWsConnection();
+    void onWsText(QWebSocket *ws, const QString &message);
+    void onWsBinary(QWebSocket *ws, const QByteArray &data);
+    void onWsDisconnected(QWebSocket *ws);
+
+    // Session logic
+    Client *clientByToken(const QString &token);
+    Client *clientById(const QString &id);
+    void sendEvent(const Client &client, const QString &event, const QJsonObject &data);
+    void sendTerminalEvent(Client &client, const QString &event, const QJsonObject &data);
+    void broadcast(const Session &session, const QString &event, const QJsonObject &data,
+                   const QString &exceptId = QString());
+    QJsonObject startInit(const Session &session, const Client &client);
+    bool acceptChunk(Session &session, const QByteArray &data);
+    void confirmChunk(Session &session, Client &client, qint64 index);
+    void dropFreeze(Session &session);
+    void sanitize(Session &session);
+    void checkComplete(Session &session);
+    void completeSession(const QString &sessionId, const QString &status);
+    void removeReceiver(Session &session, const QString &id, bool kicked);
+    void removeClient(const QString &token);
+    void onClientOffline(Client &client);
+
+    const MockLimits m_limits;
+    QTcpServer *m_tcpServer = nullptr;
+    QWebSocketServer *m_wsServer = nullptr;
+
+    QHash<QTcpSocket *, QByteArray> m_httpBuffers;
+    QHash<quint16, QString> m_pendingWsTokens;  // peer port -> cookie token
+    QHash<QWebSocket *, QString> m_wsTokens;
+    QHash<QString, Client> m_clients;           // by token
+    QHash<QString, QString> m_tokenById;
+    QHash<QString, Session> m_sessions;
+    QHash<qint64, QString> m_pendingAcks;       // event id -> client token
+    qint64 m_nextEventId = 1;
+};
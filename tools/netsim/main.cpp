@@ -0,0 +1,66 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QStringList>
+
+#include "netsimproxy.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("putinqa-netsim");
+
+    QStringList presetNames;
+    for (const NetProfile &profile : NetProfile::presets()) presetNames << profile.name;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("TCP proxy that adds latency, jitter, bandwidth caps, stalls and disconnects.");
+    parser.addHelpOption();
+    const QCommandLineOption portOption("port", "Port to listen on.", "port", "8081");
+    const QCommandLineOption targetOption("target", "Server to forward to.", "host:port", "127.0.0.1:8080");
+    const QCommandLineOption profileOption("profile", "Preset: " + presetNames.join(", ") + ".", "name", "clean");
+    const QCommandLineOption latencyOption("latency", "One-way latency in ms.", "ms");
+    const QCommandLineOption jitterOption("jitter", "Jitter in ms.", "ms");
+    const QCommandLineOption bandwidthOption("bandwidth", "Bandwidth per direction in KiB/s (0 = unlimited).", "kibps");
+    const QCommandLineOption stallEveryOption("stall-every", "Mean ms between stalls (0 = never).", "ms");
+    const QCommandLineOption stallOption("stall", "Stall length in ms.", "ms");
+    const QCommandLineOption disconnectOption("disconnect-every", "Mean ms between forced disconnects (0 = never).", "ms");
+    const QCommandLineOption outageOption("outage", "Refuse connections this long after a disconnect, in ms.", "ms");
+    const QCommandLineOption allOption("disconnect-all", "Also cut HTTP connections, not only /api/ws.");
+    parser.addOptions({portOption, targetOption, profileOption, latencyOption, jitterOption, bandwidthOption,
+                       stallEveryOption, stallOption, disconnectOption, outageOption, allOption});
+    parser.process(app);
+
+    bool ok = false;
+    NetProfile profile = NetProfile::preset(parser.value(profileOption), &ok);
+    if (!ok) {
+        qWarning().noquote() << "Unknown profile" << parser.value(profileOption);
+        return 1;
+    }
+    if (parser.isSet(latencyOption)) profile.latencyMs = parser.value(latencyOption).toInt();
+    if (parser.isSet(jitterOption)) profile.jitterMs = parser.value(jitterOption).toInt();
+    if (parser.isSet(bandwidthOption)) profile.bandwidth = parser.value(bandwidthOption).toLongLong() * 1024;
+    if (parser.isSet(stallEveryOption)) profile.stallEveryMs = parser.value(stallEveryOption).toInt();
+    if (parser.isSet(stallOption)) profile.stallMs = parser.value(stallOption).toInt();
+    if (parser.isSet(disconnectOption)) profile.disconnectEveryMs = parser.value(disconnectOption).toInt();
+    if (parser.isSet(outageOption)) profile.outageMs = parser.value(outageOption).toInt();
+    if (parser.isSet(allOption)) profile.disconnectWsOnly = false;
+
+    const QStringList target = parser.value(targetOption).split(':');
+    if (target.size() != 2) {
+        qWarning() << "--target must be host:port";
+        return 1;
+    }
+
+    NetSimProxy proxy(QHostAddress(target[0]), static_cast<quint16>(target[1].toUInt()), profile);
+    const quint16 port = proxy.listen(QHostAddress::LocalHost, static_cast<quint16>(parser.value(portOption).toUInt()));
+    if (port == 0) return 1;
+
+    qInfo().noquote() << QStringLiteral("Forwarding http://127.0.0.1:%1 -> %2 (%3)")
+                             .arg(port).arg(parser.value(targetOption), profile.name);
+    return app.exec();
+}
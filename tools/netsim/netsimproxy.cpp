@@ -0,0 +1,346 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#include "netsimproxy.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <deque>
+
+namespace {
+
+constexpr qint64 SEGMENT_BYTES = 16 * 1024;     // shaping granularity
+constexpr qint64 MAX_QUEUED_BYTES = 256 * 1024; // per direction, then TCP backpressure
+constexpr qint64 SOCKET_READ_BUFFER = 64 * 1024;
+
+// Uniform in [mean / 2, mean * 3 / 2]
+int spread(int meanMs)
+{
+    return meanMs / 2 + static_cast<int>(QRandomGenerator::global()->bounded(meanMs + 1));
+}
+
+} // namespace
+
+QList<NetProfile> NetProfile::presets()
+{
+    QList<NetProfile> profiles;
+
+    NetProfile clean;
+    clean.name = "clean";
+    profiles << clean;
+
+    NetProfile broadband;
+    broadband.name = "broadband";
+    broadband.latencyMs = 15;
+    broadband.jitterMs = 3;
+    broadband.bandwidth = 12'500'000;  // 100 Mbit/s
+    profiles << broadband;
+
+    NetProfile mobile;
+    mobile.name = "mobile";
+    mobile.latencyMs = 60;
+    mobile.jitterMs = 30;
+    mobile.bandwidth = 2'500'000;      // 20 Mbit/s
+    mobile.stallEveryMs = 10'000;
+    mobile.stallMs = 800;
+    profiles << mobile;
+
+    NetProfile lossy;
+    lossy.name = "lossy";
+    lossy.latencyMs = 40;
+    lossy.jitterMs = 20;
+    lossy.bandwidth = 5'000'000;
+    lossy.stallEveryMs = 3'000;
+    lossy.stallMs = 1'500;
+    profiles << lossy;
+
+    NetProfile satellite;
+    satellite.name = "satellite";
+    satellite.latencyMs = 300;
+    satellite.jitterMs = 20;
+    satellite.bandwidth = 3'000'000;
+    profiles << satellite;
+
+    NetProfile flaky;
+    flaky.name = "flaky";
+    flaky.latencyMs = 30;
+    flaky.jitterMs = 10;
+    flaky.bandwidth = 5'000'000;
+    flaky.disconnectEveryMs = 15'000;
+    flaky.outageMs = 3'000;
+    profiles << flaky;
+
+    return profiles;
+}
+
+NetProfile NetProfile::preset(const QString &name, bool *ok)
+{
+    for (const NetProfile &profile : presets()) {
+        if (profile.name == name) {
+            if (ok) *ok = true;
+            return profile;
+        }
+    }
+    if (ok) *ok = false;
+    return NetProfile();
+}
+
+// One proxied client connection: two sockets and a delayed queue per
+// direction. Lives on the proxy's thread and deletes itself when done.
+class ProxyConnection : public QObject
+{
+public:
+    ProxyConnection(NetSimProxy *proxy, QTcpSocket *client)
+        : QObject(proxy)
+        , m_proxy(proxy)
+        , m_client(client)
+        , m_server(new QTcpSocket(this))
+        , m_pump(new QTimer(this))
+    {
+        m_client->setParent(this);
+        m_client->setReadBufferSize(SOCKET_READ_BUFFER);
+        m_server->setReadBufferSize(SOCKET_READ_BUFFER);
+        m_pump->setSingleShot(true);
+        m_pump->setTimerType(Qt::PreciseTimer);
+
+        m_pipes[NetSimProxy::Up] = {m_client, m_server};
+        m_pipes[NetSimProxy::Down] = {m_server, m_client};
+
+        connect(m_pump, &QTimer::timeout, this, &ProxyConnection::pump);
+        for (QTcpSocket *socket : {m_client, m_server}) {
+            connect(socket, &QTcpSocket::readyRead, this, &ProxyConnection::pump);
+            connect(socket, &QTcpSocket::bytesWritten, this, &ProxyConnection::pump);
+            connect(socket, &QTcpSocket::disconnected, this, &ProxyConnection::onSocketClosed);
+            connect(socket, &QTcpSocket::errorOccurred, this, &ProxyConnection::onSocketClosed);
+        }
+        connect(m_server, &QTcpSocket::connected, this, &ProxyConnection::pump);
+
+        const NetProfile &profile = m_proxy->m_profile;
+        if (profile.stallEveryMs > 0 && profile.stallMs > 0) {
+            auto *stallTimer = new QTimer(this);
+            stallTimer->setSingleShot(true);
+            connect(stallTimer, &QTimer::timeout, this, [this, stallTimer, profile]() {
+                m_stallUntil = m_proxy->nowMs() + profile.stallMs;
+                m_proxy->countStall();
+                stallTimer->start(spread(profile.stallEveryMs));
+            });
+            stallTimer->start(spread(profile.stallEveryMs));
+        }
+
+        m_server->connectToHost(m_proxy->m_targetAddress, m_proxy->m_targetPort);
+    }
+
+private:
+    struct Segment
+    {
+        qint64 dueMs;
+        QByteArray data;
+    };
+
+    struct Pipe
+    {
+        QTcpSocket *from = nullptr;
+        QTcpSocket *to = nullptr;
+        std::deque<Segment> queue;
+        qint64 queuedBytes = 0;
+        qint64 lastDueMs = 0;
+        bool eof = false;
+    };
+
+    void pump()
+    {
+        if (m_closing) return;
+        const qint64 now = m_proxy->nowMs();
+
+        for (int d = NetSimProxy::Up; d <= NetSimProxy::Down; ++d) {
+            Pipe &pipe = m_pipes[d];
+            const auto direction = static_cast<NetSimProxy::Direction>(d);
+
+            while (pipe.queuedBytes < MAX_QUEUED_BYTES && pipe.from->bytesAvailable() > 0) {
+                Segment segment;
+                segment.data = pipe.from->read(SEGMENT_BYTES);
+                if (direction == NetSimProxy::Up && !m_classified) classify(segment.data);
+                segment.dueMs = m_proxy->scheduleSegment(direction, segment.data.size(), pipe.lastDueMs);
+                pipe.lastDueMs = segment.dueMs;
+                pipe.queuedBytes += segment.data.size();
+                pipe.queue.push_back(std::move(segment));
+            }
+
+            const bool writable = pipe.to->state() == QAbstractSocket::ConnectedState;
+            while (writable && now >= m_stallUntil && !pipe.queue.empty()
+                   && pipe.queue.front().dueMs <= now && pipe.to->bytesToWrite() < MAX_QUEUED_BYTES) {
+                Segment &segment = pipe.queue.front();
+                pipe.to->write(segment.data);
+                pipe.queuedBytes -= segment.data.size();
+                m_proxy->countBytes(direction, segment.data.size());
+                pipe.queue.pop_front();
+            }
+
+            if (pipe.eof && pipe.queue.empty() && pipe.from->bytesAvailable() == 0 && writable) {
+                pipe.to->disconnectFromHost();
+            }
+        }
+        if (m_closing) return;
+
+        // Sleep until the earliest segment is due
+        qint64 next = -1;
+        for (const Pipe &pipe : m_pipes) {
+            if (pipe.queue.empty()) continue;
+            const qint64 due = qMax(pipe.queue.front().dueMs, m_stallUntil);
+            if (next < 0 || due < next) next = due;
+        }
+        if (next >= 0) m_pump->start(static_cast<int>(qMax<qint64>(0, next - now)));
+
+        // Done once both sides are closed and everything was delivered
+        if (m_client->state() == QAbstractSocket::UnconnectedState
+            && m_server->state() == QAbstractSocket::UnconnectedState) {
+            close();
+        }
+    }
+
+    void classify(const QByteArray &firstBytes)
+    {
+        m_classified = true;
+        m_isWs = firstBytes.startsWith("GET /api/ws");
+        if (m_isWs) m_proxy->noteWsRequest();
+
+        const NetProfile &profile = m_proxy->m_profile;
+        if (profile.disconnectEveryMs > 0 && (m_isWs || !profile.disconnectWsOnly)) {
+            QTimer::singleShot(spread(profile.disconnectEveryMs), this, [this]() {
+                if (m_closing) return;
+                m_proxy->injectDisconnect();
+                close();
+            });
+        }
+    }
+
+    void onSocketClosed()
+    {
+        for (Pipe &pipe : m_pipes) {
+            if (pipe.from->state() == QAbstractSocket::UnconnectedState) pipe.eof = true;
+        }
+        // Nothing can reach a side that is gone
+        for (Pipe &pipe : m_pipes) {
+            if (pipe.to->state() == QAbstractSocket::UnconnectedState && !pipe.queue.empty()) {
+                pipe.queue.clear();
+                pipe.queuedBytes = 0;
+                pipe.eof = true;
+            }
+        }
+        pump();
+    }
+
+    void close()
+    {
+        if (m_closing) return;
+        m_closing = true;
+        m_pump->stop();
+        m_client->abort();
+        m_server->abort();
+        deleteLater();
+    }
+
+    NetSimProxy *m_proxy;
+    QTcpSocket *m_client;
+    QTcpSocket *m_server;
+    QTimer *m_pump;
+    Pipe m_pipes[2];
+    qint64 m_stallUntil = 0;
+    bool m_classified = false;
+    bool m_isWs = false;
+    bool m_closing = false;
+};
+
+NetSimProxy::NetSimProxy(const QHostAddress &targetAddress, quint16 targetPort,
+                         const NetProfile &profile, QObject *parent)
+    : QObject(parent)
+    , m_targetAddress(targetAddress)
+    , m_targetPort(targetPort)
+    , m_profile(profile)
+    , m_server(new QTcpServer(this))
+{
+    m_clock.start();
+    connect(m_server, &QTcpServer::newConnection, this, &NetSimProxy::onNewConnection);
+}
+
+quint16 NetSimProxy::listen(const QHostAddress &address, quint16 port)
+{
+    if (!m_server->listen(address, port)) {
+        qWarning() << "NetSimProxy: cannot listen:" << m_server->errorString();
+        return 0;
+    }
+    return m_server->serverPort();
+}
+
+NetSimStats NetSimProxy::stats() const
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_stats;
+}
+
+void NetSimProxy::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        if (nowMs() < m_outageUntil) {
+            socket->abort();
+            socket->deleteLater();
+            QMutexLocker locker(&m_statsMutex);
+            m_stats.refused++;
+            continue;
+        }
+        new ProxyConnection(this, socket);
+        QMutexLocker locker(&m_statsMutex);
+        m_stats.connections++;
+    }
+}
+
+qint64 NetSimProxy::scheduleSegment(Direction direction, qint64 size, qint64 previousDueMs)
+{
+    const double now = static_cast<double>(nowMs());
+    double sentAt = now;
+    if (m_profile.bandwidth > 0) {
+        // One FIFO bottleneck per direction shared by every connection
+        const double start = qMax(now, m_linkBusyUntil[direction]);
+        sentAt = start + size * 1000.0 / m_profile.bandwidth;
+        m_linkBusyUntil[direction] = sentAt;
+    }
+    qint64 due = static_cast<qint64>(sentAt) + m_profile.latencyMs;
+    if (m_profile.jitterMs > 0) due += QRandomGenerator::global()->bounded(m_profile.jitterMs + 1);
+    return qMax(due, previousDueMs);
+}
+
+void NetSimProxy::injectDisconnect()
+{
+    const qint64 now = nowMs();
+    m_outageUntil = now + m_profile.outageMs;
+    if (m_lastDisconnectAt < 0) m_lastDisconnectAt = now;
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.disconnects++;
+}
+
+void NetSimProxy::noteWsRequest()
+{
+    if (m_lastDisconnectAt < 0) return;
+    const qint64 recovery = nowMs() - m_lastDisconnectAt;
+    m_lastDisconnectAt = -1;
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.recoveryMs << recovery;
+}
+
+void NetSimProxy::countBytes(Direction direction, qint64 bytes)
+{
+    QMutexLocker locker(&m_statsMutex);
+    (direction == Up ? m_stats.bytesUp : m_stats.bytesDown) += bytes;
+}
+
+void NetSimProxy::countStall()
+{
+    QMutexLocker locker(&m_statsMutex);
+    m_stats.stalls++;
+}
@@ -0,0 +1,90 @@
+// Copyright (C) 2026  Roman Lyubimov
+// SPDX-License-Identifier: GPL-3.0-or-later
+// For full license text, see <https://www.gnu.org/licenses/gpl-3.0.txt>
+
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+class QTcpServer;
+
+// What the proxy does to the traffic. All delays are per direction.
+struct NetProfile
+{
+    QString name;
+    int latencyMs = 0;             // one-way delay added to every segment
+    int jitterMs = 0;              // extra 0..jitterMs per segment, order preserved
+    qint64 bandwidth = 0;          // bytes/s per direction shared by all connections, 0 = unlimited
+    int stallEveryMs = 0;          // mean gap between per-connection stalls, 0 = never
+    int stallMs = 0;               // how long a stall holds back delivery
+    int disconnectEveryMs = 0;     // mean gap between forced disconnects, 0 = never
+    int outageMs = 0;              // new connections are refused this long after a disconnect
+    bool disconnectWsOnly = true;  // only cut /api/ws connections, leave HTTP alone
+
+    static QList<NetProfile> presets();
+    static NetProfile preset(const QString &name, bool *ok = nullptr);
+};
+
+struct NetSimStats
+{
+    qint64 connections = 0;
+    qint64 refused = 0;            // rejected during an outage
+    qint64 bytesUp = 0;            // client -> server
+    qint64 bytesDown = 0;
+    qint64 stalls = 0;
+    qint64 disconnects = 0;        // injected, not counting normal closes
+    QList<qint64> recoveryMs;      // disconnect -> next /api/ws request
+};
+
+// Transparent TCP proxy that shapes traffic between the client and a
+// server (normally the mock server) according to a NetProfile. TCP does
+// not lose data, so packet loss is modelled as stalls: delivery pauses for
+// roughly a retransmission timeout and then catches up in a burst.
+class NetSimProxy : public QObject
+{
+    Q_OBJECT
+public:
+    NetSimProxy(const QHostAddress &targetAddress, quint16 targetPort,
+                const NetProfile &profile = NetProfile(), QObject *parent = nullptr);
+
+    // Returns the bound port, 0 on failure. The proxy may be moved to
+    // another thread after this.
+    quint16 listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+
+    // Safe to call from any thread
+    NetSimStats stats() const;
+
+private:
+    friend class ProxyConnection;
+
+    enum Direction { Up, Down };
+
+    void onNewConnection();
+    qint64 nowMs() const { return m_clock.elapsed(); }
+
+    // Delivery time for size bytes entering the link now, given the
+    // connection's previous delivery time (segments never overtake)
+    qint64 scheduleSegment(Direction direction, qint64 size, qint64 previousDueMs);
+    void injectDisconnect();
+    void noteWsRequest();
+    void countBytes(Direction direction, qint64 bytes);
+    void countStall();
+
+    const QHostAddress m_targetAddress;
+    const quint16 m_targetPort;
+    const NetProfile m_profile;
+    QTcpServer *m_server = nullptr;
+    QElapsedTimer m_clock;
+
+    double m_linkBusyUntil[2] = {0, 0};
+    qint64 m_outageUntil = 0;
+    qint64 m_lastDisconnectAt = -1;  // waiting for the client to come back
+
+    mutable QMutex m_statsMutex;
+    NetSimStats m_stats;
+};